@@ -0,0 +1,62 @@
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <czmq.h>
+#include <g2logworker.hpp>
+#include <g2log.hpp>
+
+#include "Forwarder.h"
+
+/**
+ * Forward the shots from one Shotgun to many Aliens.
+ * 
+ * usage: ShotgunForwarder <upstream> <downstream> [cpu] [reportSeconds]
+ * 
+ * Shots, bytes, failed sends and subscriptions forwarded are reported every
+ * reportSeconds until interrupted. Shots the Aliens are too slow for are 
+ * dropped by zeromq at the high water mark without being counted.
+ */
+int main(int argc, char *argv[]) {
+   if (argc < 3) {
+      std::cerr << "usage: " << argv[0] << " <upstream> <downstream> [cpu] [reportSeconds]" << std::endl;
+      return 1;
+   }
+   const int cpu = (argc > 3) ? atoi(argv[3]) : -1;
+   const int reportSeconds = (argc > 4) ? std::max(1, atoi(argv[4])) : 10;
+
+   std::shared_ptr<g2LogWorker> logger(new g2LogWorker("ShotgunForwarder", "/tmp/"));
+   g2::initializeLogging(logger.get());
+
+   Forwarder forwarder(argv[1], argv[2]);
+   forwarder.SetCpu(cpu);
+   if (!forwarder.Start()) {
+      std::cerr << "could not forward " << argv[1] << " to " << argv[2] << std::endl;
+      g2::shutDownLogging();
+      return 1;
+   }
+   LOG(INFO) << "forwarding " << argv[1] << " to " << argv[2];
+   SocketStats::Snapshot last = forwarder.GetStats();
+   auto lastTime = std::chrono::steady_clock::now();
+   while (!zctx_interrupted) {
+      for (int i = 0; i < reportSeconds * 10 && !zctx_interrupted; i++) {
+         std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      }
+      const SocketStats::Snapshot stats = forwarder.GetStats();
+      const SocketStats::Snapshot subscriptions = forwarder.GetSubscriptionStats();
+      const auto now = std::chrono::steady_clock::now();
+      const double seconds = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastTime).count() / 1000.0;
+      std::cout << "shots/s: " << static_cast<uint64_t> ((stats.mMessages - last.mMessages) / seconds)
+         << " MB/s: " << (stats.mBytes - last.mBytes) / seconds / (1024 * 1024)
+         << " shots: " << stats.mMessages
+         << " failed sends: " << stats.mSendErrors
+         << " subscriptions: " << subscriptions.mMessages << std::endl;
+      last = stats;
+      lastTime = now;
+   }
+   forwarder.Stop();
+   g2::shutDownLogging();
+   return 0;
+}
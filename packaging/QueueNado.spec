@@ -35,6 +35,8 @@ cp *.so $RPM_BUILD_ROOT/usr/local/probe/lib
 rm $RPM_BUILD_ROOT/usr/local/probe/lib/libgtest_170_lib.so
 mkdir -p $RPM_BUILD_ROOT/usr/local/probe/include
 cp src/*.h $RPM_BUILD_ROOT/usr/local/probe/include
+mkdir -p $RPM_BUILD_ROOT/usr/local/probe/bin
+cp ShotgunForwarder $RPM_BUILD_ROOT/usr/local/probe/bin
 
 
 %post
@@ -47,3 +49,4 @@ cp src/*.h $RPM_BUILD_ROOT/usr/local/probe/include
 %defattr(-,dpi,dpi,-)
 /usr/local/probe/lib
 /usr/local/probe/include
+/usr/local/probe/bin/ShotgunForwarder
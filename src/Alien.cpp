@@ -1,19 +1,29 @@
 #include <memory>
+#include <chrono>
 #include "czmq.h"
 #include "boost/thread.hpp"
 #include "g2log.hpp"
 
 #include "Death.h"
 #include "Alien.h"
+#include "ContextRegistry.h"
+#include "CZMQToolkit.h"
+
+namespace {
+   // most shots a conflating GetShot takes off the socket in one go
+   const size_t kConflateBatch = 1024;
+}
 
 /**
  * Alien is a ZeroMQ Sub socket.
  */
-Alien::Alien() {
-   mCtx = zctx_new();
+Alien::Alien() : mFiltered(false), mEverything(false), mConflate(false), mSequencing(false) {
+   mCtx = ContextRegistry::Instance().Acquire(1);
    CHECK(mCtx);
    mBody = zsocket_new(mCtx, ZMQ_SUB);
    CHECK(mBody);
+   zmq_msg_init(&mTopicFrame);
+   zmq_msg_init(&mFrame);
 }
 
 /**
@@ -21,9 +31,11 @@ Alien::Alien() {
  * @param location
  */
 void Alien::PrepareToBeShot(const std::string& location) {
-   //Subscribe to everything
-   char dummy = '\0';
-   zsocket_set_subscribe(mBody, &dummy);
+   //Subscribe to everything, unless told what to subscribe to already
+   if (!mFiltered) {
+      zsocket_set_subscribe(mBody, "");
+      mEverything = true;
+   }
    zsocket_set_rcvhwm(mBody, 32 * 1024);
    zsocket_set_sndhwm(mBody, 32 * 1024);
    int rc = zsocket_connect(mBody, location.c_str());
@@ -36,6 +48,185 @@ void Alien::PrepareToBeShot(const std::string& location) {
 
 }
 
+/**
+ * Only keep the latest shot at each topic. Up to kConflateBatch queued shots
+ * are taken off the socket on each GetShot and stale shots at a topic are 
+ * replaced by newer ones, so a lagging Alien catches up in a few passes, 
+ * holds at most one shot per topic and a fast Shotgun can't keep GetShot 
+ * from returning. Shots held back aren't seen by a poll of the socket, see 
+ * HasHeld. Topics are handed out in the order they first came 
+ * in, keep calling GetShot until it comes back empty.
+ * 
+ * ZMQ_CONFLATE isn't used as it keeps a single message for the whole 
+ * socket, not one per topic, and can't carry more than one frame.
+ * @param conflate
+ */
+void Alien::SetConflate(const bool conflate) {
+   mConflate = conflate;
+   if (!conflate) {
+      mHeld.clear();
+      mHeldOrder.clear();
+   }
+}
+
+/**
+ * @return 
+ *   If only the latest shot at each topic is kept
+ */
+bool Alien::GetConflate() const {
+   return mConflate;
+}
+
+/**
+ * @return 
+ *   If conflated shots have been taken off the socket and not handed out 
+ * yet, GetShot returns them without the socket being readable
+ */
+bool Alien::HasHeld() const {
+   return !mHeldOrder.empty();
+}
+
+/**
+ * Expect every shot to carry a sequence number after the topic, from a 
+ * Shotgun that SetSequencing, and count gaps in them. Shots without one are
+ * thrown away as invalid, as are shots without bullets once their sequence
+ * number is counted.
+ * @param sequence
+ */
+void Alien::SetSequencing(const bool sequence) {
+   mSequencing = sequence;
+}
+
+/**
+ * @return 
+ *   If shots carry sequence numbers
+ */
+bool Alien::GetSequencing() const {
+   return mSequencing;
+}
+
+/**
+ * @return 
+ *   The gaps, drops, duplicates and reorders seen in the sequence numbers so
+ * far, safe to call from any thread
+ */
+SequenceTracker::Snapshot Alien::GetSequenceStats() const {
+   return mSequences.GetSnapshot();
+}
+
+/**
+ * Only be shot with topics starting with the prefix. The first subscription
+ * replaces the subscription to everything that PrepareToBeShot makes.
+ * 
+ * Subscriptions are forwarded to the Shotgun, which stops sending what no
+ * Alien wants. They take a moment to get there, shots fired in the meantime
+ * may be missed.
+ * @param prefix
+ *   Matched against the topic frame, empty matches everything
+ * @return 
+ *   If the subscription was made
+ */
+bool Alien::Subscribe(const std::string& prefix) {
+   mFiltered = true;
+   if (mEverything) {
+      zsocket_set_unsubscribe(mBody, "");
+      mEverything = false;
+   }
+   if (zmq_setsockopt(mBody, ZMQ_SUBSCRIBE, prefix.data(), prefix.size()) != 0) {
+      LOG(WARNING) << "Alien could not subscribe: " << zmq_strerror(zmq_errno());
+      return false;
+   }
+   return true;
+}
+
+/**
+ * Stop being shot with topics starting with the prefix. 
+ * @param prefix
+ *   As given to Subscribe
+ * @return 
+ *   If the subscription was removed
+ */
+bool Alien::Unsubscribe(const std::string& prefix) {
+   if (zmq_setsockopt(mBody, ZMQ_UNSUBSCRIBE, prefix.data(), prefix.size()) != 0) {
+      LOG(WARNING) << "Alien could not unsubscribe: " << zmq_strerror(zmq_errno());
+      return false;
+   }
+   return true;
+}
+
+/**
+ * Ask a Shotgun with a last value cache for the last shot at each topic 
+ * starting with the prefix, the Clone pattern. Subscribe and 
+ * PrepareToBeShot first, so nothing fired while the snapshot is on its way
+ * is missed; a shot in flight may then come in twice, once in the snapshot
+ * and once over the subscription.
+ * 
+ * When sequencing the snapshot's sequence numbers are tracked, so shots 
+ * already in the snapshot count as duplicates rather than a gap.
+ * @param location
+ *   The Shotgun's snapshot location, as given to SetLastValueCache
+ * @param prefix
+ *   Matched against the topics, empty asks for everything
+ * @param snapshot
+ *   The bullets of the last shot at each topic
+ * @param timeout
+ *   In milliseconds, for the whole snapshot
+ * @return 
+ *   If the whole snapshot came in before the timeout
+ */
+bool Alien::GetSnapshot(const std::string& location, const std::string& prefix,
+   std::map<std::string, std::vector<std::string> >& snapshot, const int timeout) {
+   snapshot.clear();
+   void* request = zsocket_new(mCtx, ZMQ_DEALER);
+   if (!request || zsocket_connect(request, location.c_str()) != 0 ||
+      zmq_send(request, prefix.data(), prefix.size(), 0) < 0) {
+      LOG(WARNING) << "Alien could not ask " << location << " for a snapshot: " 
+         << zmq_strerror(zmq_errno());
+      if (request) {
+         zsocket_destroy(mCtx, request);
+      }
+      return false;
+   }
+   const auto start = std::chrono::steady_clock::now();
+   bool complete = false;
+   while (!complete) {
+      const long remaining = timeout - static_cast<long> (std::chrono::duration_cast<std::chrono::milliseconds>(
+         std::chrono::steady_clock::now() - start).count());
+      if (remaining <= 0 || CZMQToolkit::PollIn(request, remaining) <= 0) {
+         break;
+      }
+      zmsg_t* msg = zmsg_recv(request);
+      if (!msg) {
+         break;
+      }
+      uint64_t sequence;
+      zframe_t* topic = zmsg_first(msg);
+      zframe_t* frame = zmsg_next(msg);
+      if (zmsg_size(msg) == 1) {
+         complete = true;
+      } else if (SequenceTracker::Decode(zframe_data(frame), zframe_size(frame), sequence)) {
+         const char* name = reinterpret_cast<char*> (zframe_data(topic));
+         if (mSequencing) {
+            mSequences.Track(name, zframe_size(topic), sequence);
+         }
+         std::vector<std::string>& bullets = snapshot[std::string(name, zframe_size(topic))];
+         bullets.clear();
+         for (frame = zmsg_next(msg); frame; frame = zmsg_next(msg)) {
+            bullets.push_back(std::string(reinterpret_cast<char*> (zframe_data(frame)), zframe_size(frame)));
+         }
+      } else {
+         LOG(WARNING) << "Got Invalid snapshot of size: " << zmsg_size(msg);
+         mStats.AddInvalidMessage();
+      }
+      zmsg_destroy(&msg);
+   }
+   zsocket_destroy(mCtx, request);
+   if (!complete) {
+      LOG(WARNING) << "Alien got no complete snapshot from " << location;
+   }
+   return complete;
+}
+
 /**
  * Blocking call that returns when the alien has been shot.
  * @return 
@@ -57,32 +248,123 @@ std::vector<std::string> Alien::GetShot() {
  * @return 
  */
 void Alien::GetShot(const unsigned int timeout, std::vector<std::string>& bullets) {
+   GetShot(timeout, mTopic, bullets);
+}
+
+/**
+ * Blocking call that returns when the alien has been shot.
+ * @param timeout
+ * @param topic
+ *   What the shot was fired at
+ * @param bullets
+ *   Empty if there was no shot before the timeout
+ */
+void Alien::GetShot(const unsigned int timeout, std::string& topic, std::vector<std::string>& bullets) {
+   if (!mConflate) {
+      Receive(timeout, topic, bullets);
+      return;
+   }
+   bullets.clear();
+   if (mHeldOrder.empty()) {
+      Receive(timeout, mHeldTopic, mHeldBullets);
+      if (mHeldBullets.empty()) {
+         return;
+      }
+      Hold(mHeldTopic, mHeldBullets);
+   }
+   for (size_t taken = 0; taken < kConflateBatch; taken++) {
+      Receive(0, mHeldTopic, mHeldBullets);
+      if (mHeldBullets.empty()) {
+         break;
+      }
+      Hold(mHeldTopic, mHeldBullets);
+   }
+   topic.swap(mHeldOrder.front());
+   mHeldOrder.pop_front();
+   auto held = mHeld.find(topic);
+   bullets.swap(held->second);
+   mHeld.erase(held);
+}
+
+/**
+ * Keep the latest shot at a topic, replacing any older one.
+ * @param topic
+ * @param bullets
+ *   Swapped into the held shot
+ */
+void Alien::Hold(const std::string& topic, std::vector<std::string>& bullets) {
+   auto held = mHeld.find(topic);
+   if (held == mHeld.end()) {
+      held = mHeld.insert(std::make_pair(topic, std::vector<std::string>())).first;
+      mHeldOrder.push_back(topic);
+   }
+   held->second.swap(bullets);
+}
+
+/**
+ * Track the sequence number of a shot, the frame after the topic.
+ * @param msg
+ * @return 
+ *   false if it isn't a sequence number
+ */
+bool Alien::Sequence(zmsg_t* msg) {
+   zframe_t* topic = zmsg_first(msg);
+   zframe_t* frame = zmsg_next(msg);
+   uint64_t sequence;
+   if (!SequenceTracker::Decode(zframe_data(frame), zframe_size(frame), sequence)) {
+      return false;
+   }
+   mSequences.Track(reinterpret_cast<char*> (zframe_data(topic)), zframe_size(topic), sequence);
+   return true;
+}
+
+/**
+ * Take a shot off the socket.
+ * @param timeout
+ * @param topic
+ * @param bullets
+ *   Empty if there was no shot before the timeout
+ */
+void Alien::Receive(const unsigned int timeout, std::string& topic, std::vector<std::string>& bullets) {
    bullets.clear();
    if (!mBody) {
       return;
    }
 
-   if (zsocket_poll(mBody, timeout)) {
+   const int ready = CZMQToolkit::PollIn(mBody, timeout);
+   if (ready < 0) {
+      mStats.AddPollError();
+   } else if (ready > 0) {
       zmsg_t* msg = zmsg_recv(mBody);
-      if (msg && zmsg_size(msg) >= 2) {
+      // a shot without bullets still counts towards the sequence
+      const bool sequenced = msg && mSequencing && zmsg_size(msg) >= 2 && Sequence(msg);
+      if (msg && zmsg_size(msg) >= (mSequencing ? 3 : 2) && (!mSequencing || sequenced)) {
          zframe_t* data = zmsg_pop(msg);
          if (data) {
-            //remove the first frame
+            topic.assign(reinterpret_cast<char*> (zframe_data(data)), zframe_size(data));
+            zframe_destroy(&data);
+         }
+         if (mSequencing) {
+            data = zmsg_pop(msg);
             zframe_destroy(&data);
          }
          int msgSize = zmsg_size(msg);
+         size_t bytes = 0;
          for (int i = 0; i < msgSize; i++) {
             data = zmsg_pop(msg);
             if (data) {
                std::string bullet;
                bullet.assign(reinterpret_cast<char*> (zframe_data(data)), zframe_size(data));
                bullets.push_back(bullet);
+               bytes += zframe_size(data);
                zframe_destroy(&data);
             }
          }
+         mStats.AddMessage(bytes);
       } else {
          if (msg) {
             LOG(WARNING) << "Got Invalid bullet of size: " << zmsg_size(msg);
+            mStats.AddInvalidMessage();
          }
       }
       if (msg) {
@@ -92,10 +374,122 @@ void Alien::GetShot(const unsigned int timeout, std::vector<std::string>& bullet
 
 }
 
+/**
+ * Get shot and visit each bullet in place, nothing is copied out of zeromq.
+ * @param timeout
+ * @param visitor
+ *   Called once per bullet with the topic, the views are only good for the 
+ * duration of the call
+ * @return 
+ *   If a shot was taken
+ */
+bool Alien::GetShot(const unsigned int timeout, const Visitor& visitor) {
+   if (!mBody) {
+      return false;
+   }
+   if (mConflate) {
+      // held shots are already copied, visit them from there
+      GetShot(timeout, mHeldTopic, mHeldBullets);
+      const View topic = {mHeldTopic.data(), mHeldTopic.size()};
+      for (auto it = mHeldBullets.begin(); it != mHeldBullets.end(); it++) {
+         const View bullet = {it->data(), it->size()};
+         visitor(topic, bullet);
+      }
+      return !mHeldBullets.empty();
+   }
+   if (zmq_msg_recv(&mTopicFrame, mBody, ZMQ_DONTWAIT) < 0) {
+      if (timeout == 0) {
+         return false;
+      }
+      const int ready = CZMQToolkit::PollIn(mBody, timeout);
+      if (ready < 0) {
+         mStats.AddPollError();
+      }
+      if (ready <= 0 || zmq_msg_recv(&mTopicFrame, mBody, ZMQ_DONTWAIT) < 0) {
+         return false;
+      }
+   }
+   if (!zmq_msg_more(&mTopicFrame)) {
+      LOG(WARNING) << "Got Invalid bullet of size: 1";
+      mStats.AddInvalidMessage();
+      return false;
+   }
+   const View topic = {static_cast<const char*> (zmq_msg_data(&mTopicFrame)), zmq_msg_size(&mTopicFrame)};
+   if (mSequencing) {
+      uint64_t sequence;
+      if (zmq_msg_recv(&mFrame, mBody, 0) < 0 ||
+         !SequenceTracker::Decode(zmq_msg_data(&mFrame), zmq_msg_size(&mFrame), sequence)) {
+         while (zmq_msg_more(&mFrame) && zmq_msg_recv(&mFrame, mBody, 0) >= 0) {
+         }
+         LOG(WARNING) << "Got Invalid sequence number";
+         mStats.AddInvalidMessage();
+         return false;
+      }
+      mSequences.Track(topic.mData, topic.mSize, sequence);
+      if (!zmq_msg_more(&mFrame)) {
+         LOG(WARNING) << "Got Invalid bullet of size: 2";
+         mStats.AddInvalidMessage();
+         return false;
+      }
+   }
+   size_t bytes = 0;
+   do {
+      if (zmq_msg_recv(&mFrame, mBody, 0) < 0) {
+         break;
+      }
+      const View bullet = {static_cast<const char*> (zmq_msg_data(&mFrame)), zmq_msg_size(&mFrame)};
+      visitor(topic, bullet);
+      bytes += bullet.mSize;
+   } while (zmq_msg_more(&mFrame));
+   mStats.AddMessage(bytes);
+   return true;
+}
+
+/**
+ * Get shot without waiting, for callers driving their own epoll loop on 
+ * GetReadFd.
+ * 
+ * The fd is edge triggered, once it fires keep calling this until it 
+ * returns false. A false return has checked ZMQ_EVENTS so the fd is armed
+ * again for the next shot.
+ * @param bullets
+ * @return 
+ *   If a shot was taken
+ */
+bool Alien::TryGetShot(std::vector<std::string>& bullets) {
+   // a shot thrown away as invalid doesn't mean the socket has been drained
+   for (GetShot(0, bullets); bullets.empty(); GetShot(0, bullets)) {
+      if (!CZMQToolkit::HasEvents(mBody, ZMQ_POLLIN)) {
+         return false;
+      }
+   }
+   return true;
+}
+
+/**
+ * Get a file descriptor to wait on for shots, with epoll or the like. It is
+ * edge triggered, see TryGetShot.
+ * @return 
+ *   The file descriptor, or -1 on failure
+ */
+int Alien::GetReadFd() {
+   return CZMQToolkit::GetFd(mBody);
+}
+
+/**
+ * @return 
+ *   What this Alien has been shot with so far, safe to call from any thread
+ */
+SocketStats::Snapshot Alien::GetStats() const {
+   return mStats.GetSnapshot();
+}
+
 /**
  * Destroy the body and context of the alien.
  */
 Alien::~Alien() {
+   zmq_msg_close(&mTopicFrame);
+   zmq_msg_close(&mFrame);
    zsocket_destroy(mCtx, mBody);
-   zctx_destroy(&mCtx);
+   ContextRegistry::Instance().Release(mCtx);
 }
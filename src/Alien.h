@@ -4,17 +4,66 @@
 #include <stdlib.h>
 #include <vector>
 #include <string>
+#include <functional>
+#include <map>
+#include <deque>
+#include <zmq.h>
+#include "SocketStats.h"
+#include "SequenceTracker.h"
 struct _zctx_t;
 typedef struct _zctx_t zctx_t;
+struct _zmsg_t;
+typedef struct _zmsg_t zmsg_t;
 class Alien {
 public:
+   /**
+    * Where a frame is, only valid during the call it is passed to.
+    */
+   struct View {
+      const char* mData;
+      size_t mSize;
+   };
+   typedef std::function<void (const View& topic, const View& bullet)> Visitor;
+
    Alien();
    void PrepareToBeShot(const std::string& location);
+   void SetConflate(const bool conflate);
+   bool GetConflate() const;
+   bool HasHeld() const;
+   void SetSequencing(const bool sequence);
+   bool GetSequencing() const;
+   bool Subscribe(const std::string& prefix);
+   bool Unsubscribe(const std::string& prefix);
+   bool GetSnapshot(const std::string& location, const std::string& prefix,
+      std::map<std::string, std::vector<std::string> >& snapshot, const int timeout);
    std::vector<std::string> GetShot();
    void GetShot(const unsigned int timeout, std::vector<std::string>& bullets);
+   void GetShot(const unsigned int timeout, std::string& topic, std::vector<std::string>& bullets);
+   bool GetShot(const unsigned int timeout, const Visitor& visitor);
+   bool TryGetShot(std::vector<std::string>& bullets);
+   int GetReadFd();
+   SocketStats::Snapshot GetStats() const;
+   SequenceTracker::Snapshot GetSequenceStats() const;
    virtual ~Alien();
     
 private:
+   friend class Reactor;
+   void Receive(const unsigned int timeout, std::string& topic, std::vector<std::string>& bullets);
+   void Hold(const std::string& topic, std::vector<std::string>& bullets);
+   bool Sequence(zmsg_t* msg);
    void *mBody;
    zctx_t *mCtx;
+   SocketStats mStats;
+   std::string mTopic;
+   bool mFiltered;
+   bool mEverything;
+   zmq_msg_t mTopicFrame;
+   zmq_msg_t mFrame;
+   bool mConflate;
+   std::map<std::string, std::vector<std::string> > mHeld;
+   std::deque<std::string> mHeldOrder;
+   std::string mHeldTopic;
+   std::vector<std::string> mHeldBullets;
+   bool mSequencing;
+   SequenceTracker mSequences;
 };
\ No newline at end of file
@@ -0,0 +1,191 @@
+#include <algorithm>
+
+#include "AlienDispatcher.h"
+#include "g2log.hpp"
+
+namespace {
+   const int kReceiveTimeout = 100;
+   const int kParkTimeout = 100;
+   const int kSpinsBeforeParking = 100;
+}
+
+/**
+ * Construct a dispatcher, nothing runs until Start.
+ * @param location
+ *   Where the Shotgun is
+ * @param workers
+ * @param handler
+ *   Called on a worker thread for every shot, the bullets may be swapped out
+ */
+AlienDispatcher::AlienDispatcher(const std::string& location, const size_t workers,
+   const Handler& handler) :
+mLocation(location),
+mWorkerCount(std::max<size_t>(1, workers)),
+mHandler(handler),
+mQueueSize(1024),
+mPrepared(false),
+mReceiving(false),
+mWorking(false) {
+}
+
+/**
+ * Stop, shots still queued are handled first.
+ */
+AlienDispatcher::~AlienDispatcher() {
+   Stop();
+}
+
+/**
+ * The Alien shots come from, to Subscribe, SetConflate or SetSequencing. 
+ * It belongs to the receiver thread once started, only touch it before Start.
+ * @return 
+ */
+Alien& AlienDispatcher::GetAlien() {
+   return mAlien;
+}
+
+/**
+ * Set how many shots each worker can have queued. This must be called 
+ * before Start.
+ * @param size
+ */
+void AlienDispatcher::SetQueueSize(const size_t size) {
+   mQueueSize = std::max<size_t>(1, size);
+}
+
+/**
+ * Connect the Alien and start the workers and the receiver.
+ * @return 
+ *   false if the Alien couldn't be prepared to be shot
+ */
+bool AlienDispatcher::Start() {
+   if (mWorking) {
+      return true;
+   }
+   if (!mPrepared) {
+      try {
+         mAlien.PrepareToBeShot(mLocation);
+      } catch (const std::string& error) {
+         LOG(WARNING) << "AlienDispatcher can't be shot at " << mLocation << ": " << error;
+         return false;
+      }
+      mPrepared = true;
+   }
+   mWorkers.clear();
+   for (size_t i = 0; i < mWorkerCount; i++) {
+      mWorkers.push_back(std::unique_ptr<Worker>(new Worker(mQueueSize)));
+   }
+   mWorking = true;
+   mReceiving = true;
+   for (size_t i = 0; i < mWorkerCount; i++) {
+      mWorkers[i]->mThread = std::thread(&AlienDispatcher::Work, this, i);
+   }
+   mReceiver = std::thread(&AlienDispatcher::Receive, this);
+   return true;
+}
+
+/**
+ * Stop the receiver, let the workers finish what is queued, then stop them.
+ * A shot the receiver is holding for a full ring is queued first, nothing 
+ * taken off the socket is dropped.
+ */
+void AlienDispatcher::Stop() {
+   mReceiving = false;
+   if (mReceiver.joinable()) {
+      mReceiver.join();
+   }
+   mWorking = false;
+   for (auto it = mWorkers.begin(); it != mWorkers.end(); it++) {
+      (*it)->mBell.Ring();
+      if ((*it)->mThread.joinable()) {
+         (*it)->mThread.join();
+      }
+   }
+}
+
+/**
+ * @return 
+ *   How many workers there are
+ */
+size_t AlienDispatcher::GetWorkerCount() const {
+   return mWorkerCount;
+}
+
+/**
+ * @param topic
+ * @return 
+ *   The worker that handles shots at the topic
+ */
+size_t AlienDispatcher::GetWorker(const std::string& topic) const {
+   return std::hash<std::string>()(topic) % mWorkerCount;
+}
+
+/**
+ * @param worker
+ * @return 
+ *   What the worker has done since Start, safe to call from any thread
+ */
+AlienDispatcher::WorkerStats AlienDispatcher::GetWorkerStats(const size_t worker) const {
+   WorkerStats stats = {0, 0};
+   if (worker < mWorkers.size()) {
+      stats.mShots = mWorkers[worker]->mShots.load(std::memory_order_relaxed);
+      stats.mQueued = mWorkers[worker]->mRing.Size();
+   }
+   return stats;
+}
+
+/**
+ * The receiver thread.
+ */
+void AlienDispatcher::Receive() {
+   Shot shot;
+   while (mReceiving) {
+      mAlien.GetShot(kReceiveTimeout, shot.mTopic, shot.mBullets);
+      if (shot.mBullets.empty()) {
+         continue;
+      }
+      Worker& worker = *mWorkers[GetWorker(shot.mTopic)];
+      // a full ring is waited on, passing the shot to another worker would
+      // let it overtake shots at the same topic. The workers run until the 
+      // receiver is joined, so this ends even when stopping
+      while (!worker.mRing.Push(shot)) {
+         const uint32_t ticket = worker.mSpaceBell.Arm();
+         if (worker.mRing.Push(shot)) {
+            worker.mSpaceBell.Disarm();
+            break;
+         }
+         worker.mSpaceBell.Wait(ticket, kParkTimeout);
+      }
+      worker.mBell.Ring();
+   }
+}
+
+/**
+ * A worker thread, runs until stopped and its ring is empty.
+ * @param worker
+ */
+void AlienDispatcher::Work(const size_t worker) {
+   Worker& working = *mWorkers[worker];
+   Shot shot;
+   for (int spin = 0;; spin++) {
+      if (working.mRing.Pop(shot)) {
+         working.mSpaceBell.Ring();
+         mHandler(shot.mTopic, shot.mBullets, worker);
+         SocketStats::Bump(working.mShots, 1);
+         spin = 0;
+         continue;
+      }
+      if (!mWorking) {
+         return;
+      }
+      if (spin < kSpinsBeforeParking) {
+         continue;
+      }
+      const uint32_t ticket = working.mBell.Arm();
+      if (working.mRing.Size() > 0 || !mWorking) {
+         working.mBell.Disarm();
+         continue;
+      }
+      working.mBell.Wait(ticket, kParkTimeout);
+   }
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Alien.h"
+#include "SpscRing.h"
+#include "Doorbell.h"
+
+/**
+ * An Alien whose shots are handled on several worker threads, each topic 
+ * always on the same one.
+ * 
+ * One receiver thread takes the shots and hashes their topic to a worker, 
+ * passing them over a single producer single consumer ring per worker. Shots
+ * at a topic are handled in the order they were fired while different 
+ * topics are handled in parallel. When a worker's ring is full the receiver
+ * parks until the worker makes space rather than reorder, and the Alien's 
+ * socket backs up. Idle workers park until there is work.
+ */
+class AlienDispatcher {
+public:
+   typedef std::function<void (const std::string& topic, std::vector<std::string>& bullets,
+   const size_t worker) > Handler;
+
+   struct WorkerStats {
+      uint64_t mShots;
+      size_t mQueued;
+   };
+
+   AlienDispatcher(const std::string& location, const size_t workers, const Handler& handler);
+   virtual ~AlienDispatcher();
+
+   Alien& GetAlien();
+   void SetQueueSize(const size_t size);
+   bool Start();
+   void Stop();
+   size_t GetWorkerCount() const;
+   size_t GetWorker(const std::string& topic) const;
+   WorkerStats GetWorkerStats(const size_t worker) const;
+private:
+   struct Shot {
+      std::string mTopic;
+      std::vector<std::string> mBullets;
+   };
+   struct Worker {
+      explicit Worker(const size_t queueSize) : mRing(queueSize), mShots(0) {
+      }
+      SpscRing<Shot> mRing;
+      // rung by the receiver after a push
+      Doorbell mBell;
+      // rung by the worker after a pop
+      Doorbell mSpaceBell;
+      std::atomic<uint64_t> mShots;
+      std::thread mThread;
+   };
+   AlienDispatcher(const AlienDispatcher&) = delete;
+   AlienDispatcher& operator=(const AlienDispatcher&) = delete;
+   void Receive();
+   void Work(const size_t worker);
+
+   const std::string mLocation;
+   const size_t mWorkerCount;
+   const Handler mHandler;
+   size_t mQueueSize;
+   Alien mAlien;
+   bool mPrepared;
+   std::vector<std::unique_ptr<Worker> > mWorkers;
+   std::thread mReceiver;
+   std::atomic<bool> mReceiving;
+   std::atomic<bool> mWorking;
+};
@@ -0,0 +1,327 @@
+#include <vector>
+
+#include "AwaitLoop.h"
+#include "Vampire.h"
+#include "Crowbar.h"
+#include "BoomStick.h"
+#include "g2log.hpp"
+
+/**
+ * @param loop
+ * @param owner
+ *   The wrapper being waited on
+ * @param timeout
+ *   In milliseconds, -1 waits for ever
+ */
+AwaitLoop::Awaiter::Awaiter(AwaitLoop& loop, const void* owner, const int timeout) :
+mLoop(loop),
+mOwner(owner),
+mTimeout(timeout),
+mTimer(0),
+mResult(false) {
+}
+
+AwaitLoop::Awaiter::~Awaiter() {
+}
+
+/**
+ * Start the operation and finish it straight away if we can.
+ * @return 
+ *   If the coroutine doesn't need to be suspended
+ */
+bool AwaitLoop::Awaiter::await_ready() {
+   if (!Start()) {
+      return true;
+   }
+   mResult = TryComplete();
+   return (mResult || mTimeout == 0);
+}
+
+/**
+ * @param handle
+ * @return 
+ *   false to carry on straight away when the wrapper can't be waited on
+ */
+bool AwaitLoop::Awaiter::await_suspend(std::coroutine_handle<> handle) {
+   mHandle = handle;
+   return mLoop.Suspend(*this);
+}
+
+/**
+ * @return 
+ *   What the blocking call would have returned
+ */
+bool AwaitLoop::Awaiter::await_resume() {
+   return mResult;
+}
+
+/**
+ * Kick off whatever is being waited for, e.g. send a request.
+ * @return 
+ *   false if it failed and there is nothing to wait for
+ */
+bool AwaitLoop::Awaiter::Start() {
+   return true;
+}
+
+AwaitLoop::ShotAwaiter::ShotAwaiter(AwaitLoop& loop, Vampire& vampire, std::string& wound,
+   const int timeout) : Awaiter(loop, &vampire, timeout),
+mVampire(vampire),
+mWound(wound) {
+}
+
+bool AwaitLoop::ShotAwaiter::TryComplete() {
+   return mVampire.TryGetShot(mWound);
+}
+
+bool AwaitLoop::ShotAwaiter::Watch(Reactor& reactor, const std::function<void ()>& wake) {
+   return reactor.Add(mVampire, [wake](Vampire&) {
+      wake();
+   });
+}
+
+void AwaitLoop::ShotAwaiter::Unwatch(Reactor& reactor) {
+   reactor.Remove(mVampire);
+}
+
+AwaitLoop::KillAwaiter::KillAwaiter(AwaitLoop& loop, Crowbar& crowbar, const std::string& hit,
+   std::string& guts, const int timeout) : Awaiter(loop, &crowbar, timeout),
+mCrowbar(crowbar),
+mHit(hit),
+mGuts(guts) {
+}
+
+bool AwaitLoop::KillAwaiter::Start() {
+   return mCrowbar.Swing(mHit);
+}
+
+bool AwaitLoop::KillAwaiter::TryComplete() {
+   return mCrowbar.WaitForKill(mGuts, 0);
+}
+
+bool AwaitLoop::KillAwaiter::Watch(Reactor& reactor, const std::function<void ()>& wake) {
+   return reactor.Add(mCrowbar, [wake](Crowbar&) {
+      wake();
+   });
+}
+
+void AwaitLoop::KillAwaiter::Unwatch(Reactor& reactor) {
+   reactor.Remove(mCrowbar);
+}
+
+AwaitLoop::ReplyAwaiter::ReplyAwaiter(AwaitLoop& loop, BoomStick& boomStick,
+   const std::string& command, std::string& reply, const int timeout) :
+Awaiter(loop, &boomStick, timeout),
+mBoomStick(boomStick),
+mCommand(command),
+mReply(reply) {
+}
+
+bool AwaitLoop::ReplyAwaiter::Start() {
+   mUuid = mBoomStick.GetUuid();
+   if (!mBoomStick.SendAsync(mUuid, mCommand)) {
+      mReply = "Failed to send request";
+      return false;
+   }
+   return true;
+}
+
+bool AwaitLoop::ReplyAwaiter::TryComplete() {
+   return mBoomStick.GetAsyncReply(mUuid, 0, mReply);
+}
+
+bool AwaitLoop::ReplyAwaiter::Watch(Reactor& reactor, const std::function<void ()>& wake) {
+   return reactor.Add(mBoomStick, [wake](BoomStick&) {
+      wake();
+   });
+}
+
+void AwaitLoop::ReplyAwaiter::Unwatch(Reactor& reactor) {
+   reactor.Remove(mBoomStick);
+}
+
+/**
+ * Construct a loop with nothing waiting.
+ */
+AwaitLoop::AwaitLoop() {
+}
+
+/**
+ * Destroy the coroutines that are still waiting.
+ */
+AwaitLoop::~AwaitLoop() {
+   std::vector<std::coroutine_handle<> > waiting;
+   for (auto it = mWaiting.begin(); it != mWaiting.end(); it++) {
+      for (auto jt = it->second.begin(); jt != it->second.end(); jt++) {
+         waiting.push_back((*jt)->mHandle);
+      }
+   }
+   mWaiting.clear();
+   for (auto it = waiting.begin(); it != waiting.end(); it++) {
+      it->destroy();
+   }
+}
+
+/**
+ * Wait for a shot, like Vampire::GetShot.
+ * @param vampire
+ * @param wound
+ * @param timeout
+ *   In milliseconds, -1 waits for ever
+ * @return 
+ *   co_await gives if the Vampire was shot
+ */
+AwaitLoop::ShotAwaiter AwaitLoop::Shot(Vampire& vampire, std::string& wound, const int timeout) {
+   return ShotAwaiter(*this, vampire, wound, timeout);
+}
+
+/**
+ * Swing and wait for the kill, like Crowbar::Swing then WaitForKill.
+ * @param crowbar
+ * @param hit
+ * @param guts
+ * @param timeout
+ *   In milliseconds, -1 waits for ever
+ * @return 
+ *   co_await gives if the swing got a kill back
+ */
+AwaitLoop::KillAwaiter AwaitLoop::Swing(Crowbar& crowbar, const std::string& hit,
+   std::string& guts, const int timeout) {
+   return KillAwaiter(*this, crowbar, hit, guts, timeout);
+}
+
+/**
+ * Send a command and wait for its reply, like BoomStick::SendAsync then 
+ * GetAsyncReply.
+ * @param boomStick
+ * @param command
+ * @param reply
+ *   The reply, or an error message
+ * @param timeout
+ *   In milliseconds, -1 waits for ever
+ * @return 
+ *   co_await gives if the reply came back
+ */
+AwaitLoop::ReplyAwaiter AwaitLoop::Request(BoomStick& boomStick, const std::string& command,
+   std::string& reply, const int timeout) {
+   return ReplyAwaiter(*this, boomStick, command, reply, timeout);
+}
+
+/**
+ * Park an awaiter until its wrapper wakes it or it times out.
+ * @param awaiter
+ * @return 
+ *   false if its wrapper can't be waited on
+ */
+bool AwaitLoop::Suspend(Awaiter& awaiter) {
+   std::list<Awaiter*>& waiting = mWaiting[awaiter.mOwner];
+   if (waiting.empty()) {
+      const void* owner = awaiter.mOwner;
+      if (!awaiter.Watch(mReactor, [this, owner]() {
+            Wake(owner);
+         })) {
+         mWaiting.erase(owner);
+         return false;
+      }
+   }
+   waiting.push_back(&awaiter);
+   if (awaiter.mTimeout > 0) {
+      Awaiter* pending = &awaiter;
+      awaiter.mTimer = mReactor.AddTimer(awaiter.mTimeout, [this, pending]() {
+         TimeOut(pending);
+      }, false);
+   }
+   return true;
+}
+
+/**
+ * A wrapper has something, resume the coroutines it was for.
+ * @param owner
+ */
+void AwaitLoop::Wake(const void* owner) {
+   auto found = mWaiting.find(owner);
+   if (found == mWaiting.end()) {
+      return;
+   }
+   std::list<Awaiter*>& waiting = found->second;
+   std::vector<Awaiter*> done;
+   // one awaiter's read can cache another's reply, so go round until nothing
+   // more completes
+   bool progress = true;
+   while (progress) {
+      progress = false;
+      for (auto it = waiting.begin(); it != waiting.end();) {
+         if ((*it)->TryComplete()) {
+            (*it)->mResult = true;
+            mReactor.CancelTimer((*it)->mTimer);
+            done.push_back(*it);
+            it = waiting.erase(it);
+            progress = true;
+         } else {
+            it++;
+         }
+      }
+   }
+   if (waiting.empty() && !done.empty()) {
+      done.back()->Unwatch(mReactor);
+      mWaiting.erase(found);
+   }
+   for (auto it = done.begin(); it != done.end(); it++) {
+      (*it)->mHandle.resume();
+   }
+}
+
+/**
+ * An awaiter ran out of time, resume its coroutine empty handed.
+ * @param awaiter
+ */
+void AwaitLoop::TimeOut(Awaiter* awaiter) {
+   auto found = mWaiting.find(awaiter->mOwner);
+   if (found == mWaiting.end()) {
+      return;
+   }
+   found->second.remove(awaiter);
+   if (found->second.empty()) {
+      awaiter->Unwatch(mReactor);
+      mWaiting.erase(found);
+   }
+   awaiter->mResult = false;
+   awaiter->mHandle.resume();
+}
+
+/**
+ * Wait once for sockets and timers and resume the coroutines that are done.
+ * @param timeout
+ *   The longest to wait in milliseconds, -1 waits until something is ready
+ * @return 
+ *   How many wake ups there were, -1 if polling failed
+ */
+int AwaitLoop::Poll(const int timeout) {
+   return mReactor.Poll(timeout);
+}
+
+/**
+ * Resume coroutines as they are done until Stop is called.
+ */
+void AwaitLoop::Run() {
+   mReactor.Run();
+}
+
+/**
+ * Make Run return, safe to call from any thread.
+ */
+void AwaitLoop::Stop() {
+   mReactor.Stop();
+}
+
+/**
+ * @return 
+ *   How many coroutines are waiting
+ */
+size_t AwaitLoop::GetWaitingCount() const {
+   size_t count = 0;
+   for (auto it = mWaiting.begin(); it != mWaiting.end(); it++) {
+      count += it->second.size();
+   }
+   return count;
+}
@@ -0,0 +1,161 @@
+#pragma once
+#if !defined(__cpp_impl_coroutine)
+#error "AwaitLoop needs C++20 coroutines, it is only built when the compiler has them"
+#endif
+#include <stddef.h>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <list>
+#include <map>
+#include <string>
+#include "Reactor.h"
+
+class Vampire;
+class Crowbar;
+class BoomStick;
+
+/**
+ * The return type for a coroutine that is started and then left to run on an
+ * AwaitLoop, nobody waits for it to finish.
+ */
+class Task {
+public:
+
+   struct promise_type {
+
+      Task get_return_object() {
+         return Task();
+      }
+
+      std::suspend_never initial_suspend() noexcept {
+         return {};
+      }
+
+      std::suspend_never final_suspend() noexcept {
+         return {};
+      }
+
+      void return_void() {
+      }
+
+      void unhandled_exception() {
+         std::terminate();
+      }
+   };
+};
+
+/**
+ * Lets coroutines wait on sockets without holding a thread each.
+ * 
+ * co_await loop.Shot(vampire, wound, timeout) and friends suspend the 
+ * coroutine until the wrapper has something for it or the timeout in 
+ * milliseconds runs out, -1 waits for ever. They give back what the blocking
+ * call would have returned. The loop waits on all of its sockets with one 
+ * Reactor, so thousands of waits can share the thread that calls Run. 
+ * Coroutines are resumed on that thread, and must only use the loop and 
+ * their wrappers from it.
+ * 
+ * A wrapper can be waited on by many coroutines at once, a BoomStick can 
+ * have many requests in flight. Vampires shot over the native inproc:// or 
+ * shm:// transports can't be waited on, only taken from when a shot is 
+ * already there. Coroutines still waiting when the loop is destroyed are 
+ * destroyed with it.
+ */
+class AwaitLoop {
+public:
+
+   /**
+    * What a coroutine co_awaits, it lives in the coroutine while it waits.
+    */
+   class Awaiter {
+   public:
+      Awaiter(AwaitLoop& loop, const void* owner, const int timeout);
+      virtual ~Awaiter();
+      bool await_ready();
+      bool await_suspend(std::coroutine_handle<> handle);
+      bool await_resume();
+   protected:
+      virtual bool Start();
+      virtual bool TryComplete() = 0;
+      virtual bool Watch(Reactor& reactor, const std::function<void ()>& wake) = 0;
+      virtual void Unwatch(Reactor& reactor) = 0;
+   private:
+      friend class AwaitLoop;
+      Awaiter(const Awaiter&) = delete;
+      Awaiter& operator=(const Awaiter&) = delete;
+
+      AwaitLoop& mLoop;
+      const void* mOwner;
+      const int mTimeout;
+      std::coroutine_handle<> mHandle;
+      int mTimer;
+      bool mResult;
+   };
+
+   class ShotAwaiter : public Awaiter {
+   public:
+      ShotAwaiter(AwaitLoop& loop, Vampire& vampire, std::string& wound, const int timeout);
+   protected:
+      bool TryComplete() override;
+      bool Watch(Reactor& reactor, const std::function<void ()>& wake) override;
+      void Unwatch(Reactor& reactor) override;
+   private:
+      Vampire& mVampire;
+      std::string& mWound;
+   };
+
+   class KillAwaiter : public Awaiter {
+   public:
+      KillAwaiter(AwaitLoop& loop, Crowbar& crowbar, const std::string& hit,
+         std::string& guts, const int timeout);
+   protected:
+      bool Start() override;
+      bool TryComplete() override;
+      bool Watch(Reactor& reactor, const std::function<void ()>& wake) override;
+      void Unwatch(Reactor& reactor) override;
+   private:
+      Crowbar& mCrowbar;
+      const std::string mHit;
+      std::string& mGuts;
+   };
+
+   class ReplyAwaiter : public Awaiter {
+   public:
+      ReplyAwaiter(AwaitLoop& loop, BoomStick& boomStick, const std::string& command,
+         std::string& reply, const int timeout);
+   protected:
+      bool Start() override;
+      bool TryComplete() override;
+      bool Watch(Reactor& reactor, const std::function<void ()>& wake) override;
+      void Unwatch(Reactor& reactor) override;
+   private:
+      BoomStick& mBoomStick;
+      const std::string mCommand;
+      std::string& mReply;
+      std::string mUuid;
+   };
+
+   AwaitLoop();
+   virtual ~AwaitLoop();
+
+   ShotAwaiter Shot(Vampire& vampire, std::string& wound, const int timeout = -1);
+   KillAwaiter Swing(Crowbar& crowbar, const std::string& hit, std::string& guts,
+      const int timeout = -1);
+   ReplyAwaiter Request(BoomStick& boomStick, const std::string& command,
+      std::string& reply, const int timeout = -1);
+
+   int Poll(const int timeout);
+   void Run();
+   void Stop();
+   size_t GetWaitingCount() const;
+private:
+   AwaitLoop(const AwaitLoop&) = delete;
+   AwaitLoop& operator=(const AwaitLoop&) = delete;
+   bool Suspend(Awaiter& awaiter);
+   void Wake(const void* owner);
+   void TimeOut(Awaiter* awaiter);
+
+   Reactor mReactor;
+   std::map<const void*, std::list<Awaiter*> > mWaiting;
+};
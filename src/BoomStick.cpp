@@ -14,6 +14,7 @@
 
 #include "BoomStick.h"
 #include "Death.h"
+#include "ContextRegistry.h"
 namespace {
 
    void ShrinkToFit(std::map<std::string, std::string>& map) {
@@ -44,7 +45,7 @@ mUnreadAlert(false), mPendingAlert(false), mUtilizedThread(0) {
  */
 BoomStick::~BoomStick() {
    if (mCtx != nullptr) {
-      zctx_destroy(&mCtx);
+      ContextRegistry::Instance().Release(mCtx);
    }
    if (!mPendingReplies.empty()) {
       LOG(WARNING) << "Pending replies never emptied " << mPendingReplies.size();
@@ -133,7 +134,7 @@ BoomStick::BoomStick(BoomStick&& other) {
 BoomStick& BoomStick::operator=(BoomStick&& other) {
    if (this != &other) {
       if (nullptr != mCtx) {
-         zctx_destroy(&mCtx);
+         ContextRegistry::Instance().Release(mCtx);
       }
       Swap(other);
    }
@@ -146,7 +147,7 @@ BoomStick& BoomStick::operator=(BoomStick&& other) {
  *   A pointer to the context
  */
 zctx_t* BoomStick::GetNewContext() {
-   zctx_t* context = zctx_new();
+   zctx_t* context = ContextRegistry::Instance().Acquire(1);
    return context;
 }
 
@@ -198,7 +199,7 @@ bool BoomStick::ConnectToBinding(void* socket, const std::string& binding) {
  */
 void BoomStick::SetBinding(const std::string& binding) {
    if (nullptr != mCtx) {
-      zctx_destroy(&mCtx);
+      ContextRegistry::Instance().Release(mCtx);
       mCtx = nullptr;
       mChamber = nullptr;
    }
@@ -223,13 +224,13 @@ bool BoomStick::Initialize() {
    // The memory in this pointer is managed by the context and should not be deleted
    if (nullptr == mChamber) {
       LOG(WARNING) << "queue error " << zmq_strerror(zmq_errno());
-      zctx_destroy(&mCtx);
+      ContextRegistry::Instance().Release(mCtx);
       mCtx = nullptr;
       return false;
    }
    if (!ConnectToBinding(mChamber, mBinding)) {
 
-      zctx_destroy(&mCtx);
+      ContextRegistry::Instance().Release(mCtx);
       mChamber = nullptr;
       mCtx = nullptr;
       return false;
@@ -41,6 +41,7 @@ protected:
    std::map<std::string, std::string> mUnreadReplies;
    time_t mLastGCTime;
 private:
+   friend class Reactor;
    std::map<std::string, time_t> mPendingReplies;
    std::string mBinding;
    void *mChamber;
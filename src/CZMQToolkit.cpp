@@ -46,6 +46,71 @@ void CZMQToolkit::PrintCurrentHighWater(void* socket, const std::string& name) {
 
 }
 
+/**
+ * Get the file descriptor zeromq signals on when the socket's events may 
+ * have changed.
+ * 
+ * It is edge triggered and says nothing about which events, after it fires
+ * the socket must be read (or written) until it would block, and HasEvents 
+ * checked before waiting on it again.
+ * @param socket
+ * @return 
+ *   The file descriptor, or -1 if the socket has none
+ */
+int CZMQToolkit::GetFd(void* socket) {
+   if (! socket) {
+      return -1;
+   }
+   int fd = -1;
+   size_t size = sizeof (fd);
+   if (zmq_getsockopt(socket, ZMQ_FD, &fd, &size) != 0) {
+      LOG(WARNING) << "Can't get socket file descriptor: " << zmq_strerror(zmq_errno());
+      return -1;
+   }
+   return fd;
+}
+
+/**
+ * Check ZMQ_EVENTS, this also rearms the socket's file descriptor.
+ * @param socket
+ * @param events
+ *   ZMQ_POLLIN and/or ZMQ_POLLOUT
+ * @return 
+ *   If any of the events are ready
+ */
+bool CZMQToolkit::HasEvents(void* socket, const int events) {
+   if (! socket) {
+      return false;
+   }
+   int ready = 0;
+   size_t size = sizeof (ready);
+   if (zmq_getsockopt(socket, ZMQ_EVENTS, &ready, &size) != 0) {
+      LOG(WARNING) << "Can't get socket events: " << zmq_strerror(zmq_errno());
+      return false;
+   }
+   return ((ready & events) != 0);
+}
+
+/**
+ * Wait for something to read, like zsocket_poll but without hiding errors.
+ * @param socket
+ * @param timeout
+ *   In milliseconds, -1 to wait forever
+ * @return 
+ *   1 if there is something to read, 0 on timeout, -1 if the poll failed
+ */
+int CZMQToolkit::PollIn(void* socket, const int timeout) {
+   zmq_pollitem_t items [] = {
+      { socket, 0, ZMQ_POLLIN, 0}
+   };
+   const int pollResult = zmq_poll(items, 1, timeout);
+   if (pollResult < 0) {
+      LOG(WARNING) << "Error polling zmq socket: " << zmq_strerror(zmq_errno());
+      return -1;
+   }
+   return ((pollResult > 0 && (items[0].revents & ZMQ_POLLIN)) ? 1 : 0);
+}
+
 /**
  * Validates a message, if invalid the caller should wind down and exit
  * 
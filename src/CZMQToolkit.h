@@ -40,6 +40,9 @@ public:
    static void FreeString(std::string *data, void *hint);
    static void setHWMAndBuffer(void* socket, const int size);
    static void PrintCurrentHighWater(void* socket, const std::string& name);
+   static int GetFd(void* socket);
+   static bool HasEvents(void* socket, const int events);
+   static int PollIn(void* socket, const int timeout);
    static bool GetSizeTFromSocket(void* socket, size_t& value);
    static bool SendBlankMessage(void* socket);
    static bool SocketFIFO(void* socket);
@@ -0,0 +1,60 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+/**
+ * Compresses bullets for Rifles and Vampires that opt in to it.
+ * 
+ * Every frame starts with a flag byte saying if the rest is compressed. Only
+ * bullets over the size threshold are compressed. The ratio achieved is 
+ * measured over a window of bullets, and when it doesn't reach the minimum 
+ * compression is switched off for a while before it is tried again, so 
+ * traffic that doesn't compress only pays for the flag byte. Both ends can 
+ * share a preset dictionary, typically trained from sample traffic with 
+ * TrainDictionary, which helps most with small bullets. The size carried in
+ * a compressed frame is checked against a maximum before anything is 
+ * allocated for it.
+ */
+class Compressor {
+public:
+   static const size_t kDefaultThreshold = 256;
+   static constexpr double kDefaultMinimumRatio = 1.2;
+   static const size_t kDefaultMaxSize = 64 * 1024 * 1024;
+
+   explicit Compressor(const size_t threshold = kDefaultThreshold,
+      const double minimumRatio = kDefaultMinimumRatio, const int level = Z_BEST_SPEED,
+      const size_t maxSize = kDefaultMaxSize);
+   ~Compressor();
+
+   static std::string TrainDictionary(const std::vector<std::string>& samples,
+      const size_t maxSize = 32 * 1024);
+   bool SetDictionary(const std::string& dictionary);
+   void Compress(const void* data, const size_t size, std::string& frame);
+   bool Decompress(const char* frame, const size_t size, std::string& data);
+   double GetRatio() const;
+   bool IsBackedOff() const;
+   size_t GetCompressedCount() const;
+private:
+   Compressor(const Compressor&) = delete;
+   Compressor& operator=(const Compressor&) = delete;
+   bool Deflate(const void* data, const size_t size, std::string& frame);
+   void Measure(const size_t in, const size_t out);
+
+   const size_t mThreshold;
+   const double mMinimumRatio;
+   const size_t mMaxSize;
+   const int mLevel;
+   z_stream mDeflate;
+   z_stream mPrimed;
+   z_stream mInflate;
+   std::string mDictionary;
+   uint64_t mWindowIn;
+   uint64_t mWindowOut;
+   size_t mWindowCount;
+   size_t mBackOff;
+   size_t mCompressed;
+   double mRatio;
+};
@@ -0,0 +1,206 @@
+#include <sched.h>
+#include <algorithm>
+#include <czmq.h>
+
+#include "ContextRegistry.h"
+#include "g2log.hpp"
+
+/**
+ * Get the process wide registry.
+ * @return 
+ */
+ContextRegistry& ContextRegistry::Instance() {
+   static ContextRegistry registry;
+   return registry;
+}
+
+/**
+ * Construct the registry, contexts are not shared until Share is called.
+ */
+ContextRegistry::ContextRegistry() : mIOThreads(1) {
+}
+
+/**
+ * Share one context between every wrapper created from now on.
+ * @param ioThreads
+ *   The number of IO threads for the shared context
+ * @return 
+ *   false if shared contexts are already in use and can't be reconfigured
+ */
+bool ContextRegistry::Share(const int ioThreads) {
+   return Share(ioThreads, std::vector<std::vector<int> >(1));
+}
+
+/**
+ * Share one context per cpu set between every wrapper created from now on.
+ * 
+ * A wrapper gets the context whose cpu set contains the cpu its thread is 
+ * running on when the context is acquired, or the first one if none do. 
+ * Where libzmq supports it the IO threads of each context are pinned to its 
+ * cpu set.
+ * @param ioThreads
+ *   The number of IO threads for each shared context
+ * @param cpusPerContext
+ *   One cpu set per shared context, typically the cpus of each NUMA node. An
+ *   empty set leaves the IO threads unpinned.
+ * @return 
+ *   false if shared contexts are already in use and can't be reconfigured
+ */
+bool ContextRegistry::Share(const int ioThreads, const std::vector<std::vector<int> >& cpusPerContext) {
+   std::lock_guard<std::mutex> lock(mMutex);
+   if (!mShadows.empty()) {
+      LOG(WARNING) << "Shared contexts are in use, cannot reconfigure them";
+      return false;
+   }
+   if (ioThreads < 1 || cpusPerContext.empty()) {
+      LOG(WARNING) << "Invalid shared context configuration";
+      return false;
+   }
+   mIOThreads = ioThreads;
+   mShared.clear();
+   mShared.resize(cpusPerContext.size());
+   for (size_t i = 0; i < cpusPerContext.size(); i++) {
+      mShared[i].mCpus = cpusPerContext[i];
+   }
+   return true;
+}
+
+/**
+ * Go back to giving every wrapper its own context.
+ * @return 
+ *   false if shared contexts are still in use
+ */
+bool ContextRegistry::StopSharing() {
+   std::lock_guard<std::mutex> lock(mMutex);
+   if (!mShadows.empty()) {
+      LOG(WARNING) << "Shared contexts are in use, cannot stop sharing them";
+      return false;
+   }
+   mShared.clear();
+   return true;
+}
+
+/**
+ * If wrappers are being given shared contexts.
+ * @return 
+ */
+bool ContextRegistry::IsShared() {
+   std::lock_guard<std::mutex> lock(mMutex);
+   return !mShared.empty();
+}
+
+/**
+ * The number of shadows of the shared contexts that are still in use.
+ * @return 
+ */
+size_t ContextRegistry::GetSharedReferences() {
+   std::lock_guard<std::mutex> lock(mMutex);
+   return mShadows.size();
+}
+
+/**
+ * Pick the shared context for the cpu the calling thread is running on.
+ * @return 
+ *   An index into mShared
+ */
+size_t ContextRegistry::PickSharedContext() const {
+   const int cpu = sched_getcpu();
+   for (size_t i = 0; cpu >= 0 && i < mShared.size(); i++) {
+      const std::vector<int>& cpus = mShared[i].mCpus;
+      if (std::find(cpus.begin(), cpus.end(), cpu) != cpus.end()) {
+         return i;
+      }
+   }
+   return 0;
+}
+
+/**
+ * Create the zeromq context behind a shared context.
+ * @param shared
+ * @return 
+ *   If the context was created
+ */
+bool ContextRegistry::StartSharedContext(SharedContext& shared) {
+   void* context = zmq_ctx_new();
+   if (!context) {
+      LOG(WARNING) << "Could not create shared context: " << zmq_strerror(zmq_errno());
+      return false;
+   }
+   zmq_ctx_set(context, ZMQ_IO_THREADS, mIOThreads);
+#ifdef ZMQ_THREAD_AFFINITY_CPU_ADD
+   for (auto cpu : shared.mCpus) {
+      zmq_ctx_set(context, ZMQ_THREAD_AFFINITY_CPU_ADD, cpu);
+   }
+#else
+   LOG_IF(WARNING, !shared.mCpus.empty()) << "This libzmq cannot pin IO threads, they will not be pinned";
+#endif
+   shared.mZmqContext = context;
+   return true;
+}
+
+/**
+ * Get a context for a wrapper.
+ * 
+ * When sharing this is a shadow of a shared context, otherwise a brand new 
+ * context. Either way it must be given back with Release.
+ * @param ioThreads
+ *   IO threads to use when the context isn't shared
+ * @return 
+ *   A context, or NULL on failure
+ */
+zctx_t* ContextRegistry::Acquire(const int ioThreads) {
+   std::lock_guard<std::mutex> lock(mMutex);
+   if (mShared.empty()) {
+      zctx_t* context = zctx_new();
+      if (context) {
+         zctx_set_iothreads(context, ioThreads);
+      }
+      return context;
+   }
+   const size_t index = PickSharedContext();
+   SharedContext& shared = mShared[index];
+   if (!shared.mZmqContext && !StartSharedContext(shared)) {
+      return NULL;
+   }
+   zctx_t* shadow = zctx_shadow_zmq_ctx(shared.mZmqContext);
+   if (!shadow) {
+      LOG(WARNING) << "Could not shadow shared context";
+      if (shared.mReferences == 0) {
+         zmq_ctx_term(shared.mZmqContext);
+         shared.mZmqContext = NULL;
+      }
+      return NULL;
+   }
+   shared.mReferences++;
+   mShadows[shadow] = index;
+   return shadow;
+}
+
+/**
+ * Give back a context from Acquire, destroying any sockets still open on it.
+ * 
+ * The shared context behind a shadow is terminated when its last shadow is
+ * released.
+ * @param context
+ *   Set to NULL
+ */
+void ContextRegistry::Release(zctx_t*& context) {
+   if (!context) {
+      return;
+   }
+   std::lock_guard<std::mutex> lock(mMutex);
+   auto shadow = mShadows.find(context);
+   if (shadow == mShadows.end()) {
+      zctx_destroy(&context);
+      context = NULL;
+      return;
+   }
+   SharedContext& shared = mShared[shadow->second];
+   mShadows.erase(shadow);
+   zctx_destroy(&context);
+   context = NULL;
+   if (--shared.mReferences == 0) {
+      zmq_ctx_term(shared.mZmqContext);
+      shared.mZmqContext = NULL;
+   }
+}
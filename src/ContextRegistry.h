@@ -0,0 +1,48 @@
+#pragma once
+#include <stddef.h>
+#include <map>
+#include <mutex>
+#include <vector>
+struct _zctx_t;
+typedef struct _zctx_t zctx_t;
+
+/**
+ * Hands out the contexts used by all the socket wrappers.
+ * 
+ * By default every wrapper gets its own context, as it always has. Once 
+ * Share is called the wrappers get a shadow of one shared context instead 
+ * (or of one context per cpu set, typically one per NUMA node), so the 
+ * process runs a fixed number of IO threads however many sockets it has.
+ * Contexts are reference counted, the shared context is terminated when the 
+ * last wrapper using it releases its shadow.
+ */
+class ContextRegistry {
+public:
+   static ContextRegistry& Instance();
+
+   bool Share(const int ioThreads);
+   bool Share(const int ioThreads, const std::vector<std::vector<int> >& cpusPerContext);
+   bool StopSharing();
+   bool IsShared();
+   zctx_t* Acquire(const int ioThreads);
+   void Release(zctx_t*& context);
+   size_t GetSharedReferences();
+private:
+   struct SharedContext {
+      SharedContext() : mZmqContext(NULL), mReferences(0) {
+      }
+      std::vector<int> mCpus;
+      void* mZmqContext;
+      size_t mReferences;
+   };
+   ContextRegistry();
+   ContextRegistry(const ContextRegistry&) = delete;
+   ContextRegistry& operator=(const ContextRegistry&) = delete;
+   size_t PickSharedContext() const;
+   bool StartSharedContext(SharedContext& shared);
+
+   std::mutex mMutex;
+   int mIOThreads;
+   std::vector<SharedContext> mShared;
+   std::map<zctx_t*, size_t> mShadows;
+};
@@ -0,0 +1,218 @@
+#include <chrono>
+
+#include "Coven.h"
+#include "CZMQToolkit.h"
+#include "czmq.h"
+#include "g2log.hpp"
+#include "Death.h"
+#include "ContextRegistry.h"
+#include "InprocJunction.h"
+#include "ShmRing.h"
+#include "SocketStats.h"
+
+/**
+ * Construct a coven with no sources.
+ */
+Coven::Coven() :
+mContext(NULL),
+mHwm(250),
+mIOThredCount(1),
+mCurrent(0),
+mServed(0) {
+   zmq_msg_init(&mBlood);
+}
+
+/**
+ * Get our high water mark.
+ * @return 
+ */
+int Coven::GetHighWater() {
+   return mHwm;
+}
+
+/**
+ * Set our highwatermark. This must be called before Connect.
+ * @param hwm
+ */
+void Coven::SetHighWater(const int hwm) {
+   mHwm = hwm;
+}
+
+/**
+ * Get IO thread count;
+ */
+int Coven::GetIOThreads() {
+   return mIOThredCount;
+}
+
+/**
+ * Set IO thread count. This must be called before the first Connect.
+ * @param count
+ */
+void Coven::SetIOThreads(const int count) {
+   mIOThredCount = count;
+}
+
+/**
+ * Add a source, a location owned by a Rifle.
+ * @param location
+ * @param weight
+ *   The most shots in a row taken from this source while others are waiting
+ * @return 
+ *   false if the location can't be connected to
+ */
+bool Coven::Connect(const std::string& location, const unsigned int weight) {
+   if (InprocJunction::IsInproc(location) || ShmRing::IsShm(location)) {
+      LOG(WARNING) << "Coven can't join a native transport: " << location;
+      return false;
+   }
+   if (!mContext) {
+      mContext = ContextRegistry::Instance().Acquire(GetIOThreads());
+      if (!mContext) {
+         LOG(WARNING) << "Coven can't get a context";
+         return false;
+      }
+      zctx_set_sndhwm(mContext, GetHighWater());
+      zctx_set_rcvhwm(mContext, GetHighWater());
+   }
+   void* socket = zsocket_new(mContext, ZMQ_PULL);
+   CZMQToolkit::setHWMAndBuffer(socket, GetHighWater());
+   int result = zsocket_connect(socket, location.c_str());
+   if (result < 0) {
+      zsocket_destroy(mContext, socket);
+      LOG(WARNING) << "Coven Can't connect : " << result;
+      return false;
+   }
+   Death::Instance().RegisterDeathEvent(&Death::DeleteIpcFiles, location);
+   mSources.push_back(std::unique_ptr<Source>(new Source(location, socket, (weight > 0) ? weight : 1)));
+   zmq_pollitem_t item = {socket, 0, ZMQ_POLLIN, 0};
+   mItems.push_back(item);
+   return true;
+}
+
+/**
+ * Move on to the next source's turn.
+ */
+void Coven::NextSource() {
+   mServed = 0;
+   mCurrent = (mCurrent + 1) % mSources.size();
+}
+
+/**
+ * Take a shot from whichever source's turn it is, without waiting.
+ * @param wound
+ * @param source
+ * @return 
+ *   false if none of the sources have a shot waiting
+ */
+bool Coven::Bite(std::string& wound, size_t& source) {
+   for (size_t tried = 0; tried < mSources.size(); tried++) {
+      Source& current = *mSources[mCurrent];
+      if (zmq_msg_recv(&mBlood, current.mSocket, ZMQ_DONTWAIT) < 0) {
+         NextSource();
+         continue;
+      }
+      source = mCurrent;
+      if (++mServed >= current.mWeight) {
+         NextSource();
+      }
+      if (zmq_msg_more(&mBlood)) {
+         size_t frames = 1;
+         while (zmq_msg_more(&mBlood) && zmq_msg_recv(&mBlood, current.mSocket, 0) >= 0) {
+            frames++;
+         }
+         LOG(WARNING) << "Received invalid sized message of size: " << frames;
+         continue;
+      }
+      SocketStats::Bump(current.mShots, 1);
+      wound.assign(reinterpret_cast<char*> (zmq_msg_data(&mBlood)), zmq_msg_size(&mBlood));
+      return true;
+   }
+   return false;
+}
+
+/**
+ * Get shot by any of the sources.
+ * @param wound
+ * @param timeout
+ *   In milliseconds
+ * @return 
+ */
+bool Coven::GetShot(std::string& wound, const int timeout) {
+   size_t source;
+   return GetShot(wound, source, timeout);
+}
+
+/**
+ * Get shot by any of the sources, saying which one.
+ * @param wound
+ * @param source
+ *   The index of the source, in the order they were connected
+ * @param timeout
+ *   In milliseconds, negative waits forever
+ * @return 
+ */
+bool Coven::GetShot(std::string& wound, size_t& source, const int timeout) {
+   if (mSources.empty()) {
+      LOG(WARNING) << "Coven has no sources!";
+      return false;
+   }
+   const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout > 0 ? timeout : 0);
+   for (;;) {
+      if (Bite(wound, source)) {
+         return true;
+      }
+      const long remaining = (timeout < 0) ? -1 : std::chrono::duration_cast<std::chrono::milliseconds>(
+         deadline - std::chrono::steady_clock::now()).count();
+      if (timeout >= 0 && remaining <= 0) {
+         return false;
+      }
+      int pollResult = zmq_poll(&mItems[0], mItems.size(), remaining);
+      if (pollResult < 0) {
+         LOG(WARNING) << "Error on zmq socket receiving in Coven: " << zmq_strerror(zmq_errno());
+         return false;
+      } else if (pollResult == 0) {
+         return false;
+      }
+   }
+}
+
+/**
+ * @return 
+ *   The number of sources connected
+ */
+size_t Coven::GetSourceCount() const {
+   return mSources.size();
+}
+
+/**
+ * @param source
+ * @return 
+ *   The location of a source, empty if there is no such source
+ */
+std::string Coven::GetSourceLocation(const size_t source) const {
+   return (source < mSources.size()) ? mSources[source]->mLocation : std::string();
+}
+
+/**
+ * @param source
+ * @return 
+ *   How many shots have been taken from a source, safe to call from any 
+ * thread once the sources are connected
+ */
+uint64_t Coven::GetShotCount(const size_t source) const {
+   return (source < mSources.size()) ? mSources[source]->mShots.load(std::memory_order_relaxed) : 0;
+}
+
+/**
+ * Destroy all the sockets.
+ */
+Coven::~Coven() {
+   if (mContext != NULL) {
+      for (auto it = mSources.begin(); it != mSources.end(); it++) {
+         zsocket_destroy(mContext, (*it)->mSocket);
+      }
+      ContextRegistry::Instance().Release(mContext);
+   }
+   zmq_msg_close(&mBlood);
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <zmq.h>
+struct _zctx_t;
+typedef struct _zctx_t zctx_t;
+
+/**
+ * A Vampire that feeds from many Rifles that each own their location.
+ * 
+ * Every location gets its own pull socket but they are all serviced from 
+ * one zmq_poll. Sources take turns, a source with weight n is given up to n
+ * shots in a row while it has them before the next source's turn, so a hot 
+ * Rifle can't starve the others. Shots are counted per source to show up 
+ * any imbalance. Only zeromq transports can be joined, not the native 
+ * inproc:// or shm:// ones.
+ */
+class Coven {
+public:
+   Coven();
+   virtual ~Coven();
+
+   bool Connect(const std::string& location, const unsigned int weight = 1);
+   bool GetShot(std::string& wound, const int timeout);
+   bool GetShot(std::string& wound, size_t& source, const int timeout);
+   size_t GetSourceCount() const;
+   std::string GetSourceLocation(const size_t source) const;
+   uint64_t GetShotCount(const size_t source) const;
+   int GetHighWater();
+   void SetHighWater(const int hwm);
+   int GetIOThreads();
+   void SetIOThreads(const int count);
+private:
+   struct Source {
+      Source(const std::string& location, void* socket, const unsigned int weight) :
+      mLocation(location), mSocket(socket), mWeight(weight), mShots(0) {
+      }
+      std::string mLocation;
+      void* mSocket;
+      unsigned int mWeight;
+      std::atomic<uint64_t> mShots;
+   };
+   Coven(const Coven&) = delete;
+   Coven& operator=(const Coven&) = delete;
+   bool Bite(std::string& wound, size_t& source);
+   void NextSource();
+
+   zctx_t* mContext;
+   int mHwm;
+   int mIOThredCount;
+   std::vector<std::unique_ptr<Source> > mSources;
+   std::vector<zmq_pollitem_t> mItems;
+   size_t mCurrent;
+   unsigned int mServed;
+   zmq_msg_t mBlood;
+};
@@ -7,6 +7,8 @@
 #include "boost/thread.hpp"
 #include "g2log.hpp"
 #include "Death.h"
+#include "ContextRegistry.h"
+#include "CZMQToolkit.h"
 
 /**
  * Construct a crowbar for beating things at the binding location
@@ -50,7 +52,7 @@ mBinding(binding), mTip(NULL), mOwnsContext(false) {
  */
 Crowbar::~Crowbar() {
    if (mOwnsContext && mContext != NULL) {
-      zctx_destroy(&mContext);
+      ContextRegistry::Instance().Release(mContext);
    }
 }
 
@@ -106,17 +108,18 @@ void* Crowbar::GetTip() {
 
 bool Crowbar::Wield() {
    if (!mContext) {
-      mContext = zctx_new();
+      mContext = ContextRegistry::Instance().Acquire(1);
+      if (!mContext) {
+         return false;
+      }
       zctx_set_linger(mContext, 0); // linger for a millisecond on close
       zctx_set_sndhwm(mContext, GetHighWater());
       zctx_set_rcvhwm(mContext, GetHighWater()); // HWM on internal thread communicaiton
-      zctx_set_iothreads(mContext, 1);
    }
    if (!mTip) {
       mTip = GetTip();
       if (!mTip && mOwnsContext) {
-         zctx_destroy(&mContext);
-         mContext = NULL;
+         ContextRegistry::Instance().Release(mContext);
       }
    }
    
@@ -144,6 +147,7 @@ bool Crowbar::PollForReady() {
    int returnVal = zmq_poll(&item, 1, 0);
    if (returnVal < 0) {
       LOG(WARNING) << "Socket error: " << zmq_strerror(zmq_errno());
+      mStats.AddPollError();
    }
 
    return (returnVal >= 1);
@@ -161,18 +165,23 @@ bool Crowbar::Flurry(std::vector<std::string>& hits) {
    }
    if (!PollForReady()) {
       LOG(WARNING) << "Cannot send, no listener ready";
+      mStats.AddSendTimeout();
       return false;
    }
    zmsg_t* message = zmsg_new();
+   size_t bytes = 0;
    for (auto it = hits.begin();
            it != hits.end(); it++) {
       zmsg_addmem(message, &((*it)[0]), it->size());
+      bytes += it->size();
    }
    bool success = true;
    //std::cout << "Sending message with " << zmsg_size(message) << " " << hits.size() << std::endl;
    if (zmsg_send(&message, mTip) != 0) {
       LOG(WARNING) << "zmsg_send returned non-zero exit " << zmq_strerror(zmq_errno());
       success = false;
+   } else {
+      mStats.AddMessage(bytes);
    }
    if (message) {
       zmsg_destroy(&message);
@@ -198,6 +207,7 @@ bool Crowbar::BlockForKill(std::vector<std::string>& guts) {
       return false;
    }
    guts.clear();
+   mStats.AddMessage(zmsg_content_size(message));
    int msgSize = zmsg_size(message);
    for (int i = 0; i < msgSize; i++) {
       zframe_t* frame = zmsg_pop(message);
@@ -226,7 +236,11 @@ bool Crowbar::WaitForKill(std::vector<std::string>& guts, const int timeout) {
    if (!mTip) {
       return false;
    }
-   if (zsocket_poll(mTip, timeout)) {
+   const int ready = CZMQToolkit::PollIn(mTip, timeout);
+   if (ready < 0) {
+      mStats.AddPollError();
+   }
+   if (ready > 0) {
       return BlockForKill(guts);
    }
    return false;
@@ -235,3 +249,12 @@ bool Crowbar::WaitForKill(std::vector<std::string>& guts, const int timeout) {
 zctx_t* Crowbar::GetContext() {
    return mContext;
 }
+
+/**
+ * @return 
+ *   The hits this Crowbar has swung and the kills it got back, safe to call
+ * from any thread
+ */
+SocketStats::Snapshot Crowbar::GetStats() const {
+   return mStats.GetSnapshot();
+}
@@ -12,6 +12,7 @@
 #include <vector>
 #include "global.h"
 #include "Headcrab.h"
+#include "SocketStats.h"
 struct _zctx_t;
 typedef struct _zctx_t zctx_t;
 class Crowbar {
@@ -31,7 +32,9 @@ public:
    void* GetTip();
    static int GetHighWater();
    zctx_t* GetContext();
+   SocketStats::Snapshot GetStats() const;
 private:
+   friend class Reactor;
    bool PollForReady();
    Crowbar(const Crowbar& that) : mContext(NULL), mTip(NULL) {
    }
@@ -40,4 +43,5 @@ private:
    std::string mBinding;
    void* mTip;
    bool mOwnsContext;
+   SocketStats mStats;
 };
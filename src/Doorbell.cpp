@@ -0,0 +1,68 @@
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <limits.h>
+#include <time.h>
+
+#include "Doorbell.h"
+
+/**
+ * Construct a doorbell that nobody is waiting on.
+ * @param shared
+ *   If the doorbell lives in memory shared between processes
+ */
+Doorbell::Doorbell(const bool shared) : mTicket(0), mWaiters(0),
+mWaitOperation(shared ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE),
+mWakeOperation(shared ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE) {
+}
+
+/**
+ * Announce that we are about to wait.
+ * @return 
+ *   The ticket to hand to Wait
+ */
+uint32_t Doorbell::Arm() {
+   const uint32_t ticket = mTicket.load(std::memory_order_acquire);
+   mWaiters.fetch_add(1, std::memory_order_seq_cst);
+   std::atomic_thread_fence(std::memory_order_seq_cst);
+   return ticket;
+}
+
+/**
+ * Take back an Arm, the condition was met without having to wait.
+ */
+void Doorbell::Disarm() {
+   mWaiters.fetch_sub(1, std::memory_order_relaxed);
+}
+
+/**
+ * Park until the bell rings or the timeout expires. Disarms when done.
+ * @param ticket
+ *   From Arm, if the bell rang since then this returns straight away
+ * @param timeout
+ *   In milliseconds, negative to wait forever
+ */
+void Doorbell::Wait(const uint32_t ticket, const int timeout) {
+   timespec relative;
+   timespec* wait = NULL;
+   if (timeout >= 0) {
+      relative.tv_sec = timeout / 1000;
+      relative.tv_nsec = (timeout % 1000) * 1000000L;
+      wait = &relative;
+   }
+   syscall(SYS_futex, reinterpret_cast<uint32_t*> (&mTicket), mWaitOperation,
+      ticket, wait, NULL, 0);
+   Disarm();
+}
+
+/**
+ * Wake everybody parked on the bell, if anybody is.
+ */
+void Doorbell::Ring() {
+   std::atomic_thread_fence(std::memory_order_seq_cst);
+   if (mWaiters.load(std::memory_order_relaxed) > 0) {
+      mTicket.fetch_add(1, std::memory_order_release);
+      syscall(SYS_futex, reinterpret_cast<uint32_t*> (&mTicket), mWakeOperation,
+         INT_MAX, NULL, NULL, 0);
+   }
+}
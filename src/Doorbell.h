@@ -0,0 +1,31 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * Lets a thread park on a futex until another thread rings.
+ * 
+ * Ringing is only a fence and a load unless someone is actually parked, so 
+ * it can be done after every push or pop. A waiter must Arm before its last
+ * check of whatever it's waiting for, then Wait (or Disarm if the check 
+ * succeeded), that way a ring between the check and the wait isn't lost.
+ * A shared doorbell can be placed in shared memory and rung across processes.
+ */
+class Doorbell {
+public:
+   explicit Doorbell(const bool shared = false);
+
+   uint32_t Arm();
+   void Disarm();
+   void Wait(const uint32_t ticket, const int timeout);
+   void Ring();
+private:
+   Doorbell(const Doorbell&) = delete;
+   Doorbell& operator=(const Doorbell&) = delete;
+
+   std::atomic<uint32_t> mTicket;
+   std::atomic<uint32_t> mWaiters;
+   const int mWaitOperation;
+   const int mWakeOperation;
+   char mPad[48];
+};
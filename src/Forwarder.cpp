@@ -0,0 +1,203 @@
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+
+#include "Forwarder.h"
+#include "czmq.h"
+#include "g2log.hpp"
+#include "Death.h"
+#include "ContextRegistry.h"
+
+namespace {
+   const int kPollTimeout = 100;
+   // messages forwarded in a row before checking the other direction
+   const int kBatchSize = 256;
+}
+
+/**
+ * Construct a forwarder, nothing is connected until Start.
+ * @param upstream
+ *   Where the Shotgun is aimed
+ * @param downstream
+ *   Where the Aliens will connect
+ */
+Forwarder::Forwarder(const std::string& upstream, const std::string& downstream) :
+mUpstream(upstream),
+mDownstream(downstream),
+mCpu(-1),
+mSubscriber(NULL),
+mPublisher(NULL),
+mRunning(false) {
+   mCtx = ContextRegistry::Instance().Acquire(1);
+   CHECK(mCtx);
+   zmq_msg_init(&mFrame);
+}
+
+/**
+ * Stop forwarding and close the sockets.
+ */
+Forwarder::~Forwarder() {
+   Stop();
+   Close();
+   zmq_msg_close(&mFrame);
+   ContextRegistry::Instance().Release(mCtx);
+}
+
+/**
+ * Pin the forwarding thread to a core. This must be called before Start.
+ * @param cpu
+ *   The core, or -1 to let it run anywhere
+ */
+void Forwarder::SetCpu(const int cpu) {
+   mCpu = cpu;
+}
+
+/**
+ * Bind downstream, connect upstream and start forwarding.
+ * @return 
+ *   false if either socket couldn't be set up, neither is kept and Start 
+ * tries again from scratch
+ */
+bool Forwarder::Start() {
+   if (mRunning) {
+      return true;
+   }
+   if (!mPublisher) {
+      mPublisher = zsocket_new(mCtx, ZMQ_XPUB);
+      mSubscriber = zsocket_new(mCtx, ZMQ_XSUB);
+      if (!mPublisher || !mSubscriber) {
+         LOG(WARNING) << "Forwarder could not create its sockets";
+         Close();
+         return false;
+      }
+      int verbose = 1;
+      zmq_setsockopt(mPublisher, ZMQ_XPUB_VERBOSE, &verbose, sizeof (verbose));
+      zsocket_set_sndhwm(mPublisher, 32 * 1024);
+      zsocket_set_rcvhwm(mPublisher, 32 * 1024);
+      zsocket_set_sndhwm(mSubscriber, 32 * 1024);
+      zsocket_set_rcvhwm(mSubscriber, 32 * 1024);
+      if (zsocket_bind(mPublisher, mDownstream.c_str()) == -1) {
+         LOG(WARNING) << "Forwarder could not bind " << mDownstream << ": " << zmq_strerror(zmq_errno());
+         Close();
+         return false;
+      }
+      Death::Instance().RegisterDeathEvent(&Death::DeleteIpcFiles, mDownstream);
+      if (zsocket_connect(mSubscriber, mUpstream.c_str()) == -1) {
+         LOG(WARNING) << "Forwarder could not connect " << mUpstream << ": " << zmq_strerror(zmq_errno());
+         Close();
+         return false;
+      }
+   }
+   mRunning = true;
+   mThread = std::thread(&Forwarder::Run, this);
+   return true;
+}
+
+/**
+ * Destroy whichever sockets there are, so a failed Start can be tried again
+ * from scratch.
+ */
+void Forwarder::Close() {
+   if (mSubscriber) {
+      zsocket_destroy(mCtx, mSubscriber);
+      mSubscriber = NULL;
+   }
+   if (mPublisher) {
+      zsocket_destroy(mCtx, mPublisher);
+      mPublisher = NULL;
+   }
+}
+
+/**
+ * Stop forwarding, the sockets stay open for another Start.
+ */
+void Forwarder::Stop() {
+   mRunning = false;
+   if (mThread.joinable()) {
+      mThread.join();
+   }
+}
+
+/**
+ * @return 
+ *   The shots forwarded to the Aliens so far, safe to call from any thread
+ */
+SocketStats::Snapshot Forwarder::GetStats() const {
+   return mStats.GetSnapshot();
+}
+
+/**
+ * @return 
+ *   The subscriptions forwarded to the Shotgun so far, safe to call from any
+ * thread
+ */
+SocketStats::Snapshot Forwarder::GetSubscriptionStats() const {
+   return mSubscriptionStats.GetSnapshot();
+}
+
+/**
+ * The forwarding thread.
+ */
+void Forwarder::Run() {
+   if (mCpu >= 0) {
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      CPU_SET(mCpu, &cpus);
+      if (pthread_setaffinity_np(pthread_self(), sizeof (cpus), &cpus) != 0) {
+         LOG(WARNING) << "Forwarder could not pin itself to cpu " << mCpu;
+      }
+   }
+   zmq_pollitem_t items [] = {
+      { mSubscriber, 0, ZMQ_POLLIN, 0},
+      { mPublisher, 0, ZMQ_POLLIN, 0}
+   };
+   while (mRunning) {
+      if (zmq_poll(items, 2, kPollTimeout) < 0) {
+         mStats.AddPollError();
+         if (zmq_errno() == ETERM) {
+            return;
+         }
+         continue;
+      }
+      if (items[1].revents & ZMQ_POLLIN) {
+         for (int i = 0; i < kBatchSize && Forward(mPublisher, mSubscriber, mSubscriptionStats); i++) {
+         }
+      }
+      if (items[0].revents & ZMQ_POLLIN) {
+         for (int i = 0; i < kBatchSize && Forward(mSubscriber, mPublisher, mStats); i++) {
+         }
+      }
+   }
+}
+
+/**
+ * Forward a message, frame by frame. Sending a frame hands its buffer over
+ * to the other socket, nothing is copied. A send that fails is counted as a
+ * send error; what the XPUB drops at its high water mark isn't seen here.
+ * @param from
+ * @param to
+ * @param stats
+ * @return 
+ *   false if there was nothing to forward
+ */
+bool Forwarder::Forward(void* from, void* to, SocketStats& stats) {
+   if (zmq_msg_recv(&mFrame, from, ZMQ_DONTWAIT) < 0) {
+      return false;
+   }
+   size_t bytes = 0;
+   bool sent = true;
+   for (;;) {
+      const bool more = zmq_msg_more(&mFrame);
+      bytes += zmq_msg_size(&mFrame);
+      sent = (zmq_msg_send(&mFrame, to, more ? ZMQ_SNDMORE : 0) >= 0) && sent;
+      if (!more || zmq_msg_recv(&mFrame, from, 0) < 0) {
+         break;
+      }
+   }
+   if (sent) {
+      stats.AddMessage(bytes);
+   } else {
+      stats.AddSendError();
+   }
+   return true;
+}
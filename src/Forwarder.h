@@ -0,0 +1,49 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <thread>
+#include <zmq.h>
+#include "SocketStats.h"
+struct _zctx_t;
+typedef struct _zctx_t zctx_t;
+
+/**
+ * Forwards a Shotgun's shots to its Aliens from a thread of its own, so the
+ * Shotgun sends each shot once however many Aliens there are.
+ * 
+ * An XSUB connects to where the Shotgun is aimed and an XPUB binds where the
+ * Aliens connect. Frames are handed from one to the other without copying,
+ * and subscriptions go back upstream so the Shotgun still filters by topic.
+ * Subscriptions are passed on verbosely, so every Alien's subscription is 
+ * counted. Snapshots of a last value cache don't go through the Forwarder,
+ * Aliens ask the Shotgun's own snapshot location for them.
+ */
+class Forwarder {
+public:
+   Forwarder(const std::string& upstream, const std::string& downstream);
+   virtual ~Forwarder();
+
+   void SetCpu(const int cpu);
+   bool Start();
+   void Stop();
+   SocketStats::Snapshot GetStats() const;
+   SocketStats::Snapshot GetSubscriptionStats() const;
+private:
+   Forwarder(const Forwarder&) = delete;
+   Forwarder& operator=(const Forwarder&) = delete;
+   void Close();
+   void Run();
+   bool Forward(void* from, void* to, SocketStats& stats);
+
+   const std::string mUpstream;
+   const std::string mDownstream;
+   int mCpu;
+   zctx_t* mCtx;
+   void* mSubscriber;
+   void* mPublisher;
+   zmq_msg_t mFrame;
+   std::thread mThread;
+   std::atomic<bool> mRunning;
+   SocketStats mStats;
+   SocketStats mSubscriptionStats;
+};
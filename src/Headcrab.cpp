@@ -8,6 +8,8 @@
 #include "boost/thread.hpp"
 #include "g2log.hpp"
 #include "Death.h"
+#include "ContextRegistry.h"
+#include "CZMQToolkit.h"
 
 
 /**
@@ -25,7 +27,7 @@ Headcrab::Headcrab(const std::string& binding) : mBinding(binding), mContext(NUL
  */
 Headcrab::~ Headcrab() {
    if (mContext) {
-      zctx_destroy(&mContext);
+      ContextRegistry::Instance().Release(mContext);
    }
 }
 
@@ -104,11 +106,13 @@ void Headcrab::setIpcFilePermissions() {
  */
 bool Headcrab::ComeToLife() {
    if (! mContext) {
-      mContext = zctx_new();
+      mContext = ContextRegistry::Instance().Acquire(1);
+      if (! mContext) {
+         return false;
+      }
       zctx_set_linger(mContext, 0); // linger for a millisecond on close
       zctx_set_sndhwm(mContext, GetHighWater());
       zctx_set_rcvhwm(mContext, GetHighWater()); // HWM on internal thread communication
-      zctx_set_iothreads(mContext, 1);
    }
    if (! mFace) {
       void* face = GetFace(mContext);
@@ -137,6 +141,15 @@ zctx_t* Headcrab::GetContext() const {
    return mContext;
 }
 
+/**
+ * @return 
+ *   The hits this Headcrab has taken and the splatter it sent back, safe to
+ * call from any thread
+ */
+SocketStats::Snapshot Headcrab::GetStats() const {
+   return mStats.GetSnapshot();
+}
+
 bool Headcrab::GetHitBlock(std::string& theHit) {
    std::vector<std::string> hits;
    if (GetHitBlock(hits) && ! hits.empty()) {
@@ -156,6 +169,7 @@ bool Headcrab::GetHitBlock(std::vector<std::string>& theHits) {
    }
    //std::cout << "Got message with " << zmsg_size(message) << " parts" << std::endl;
    theHits.clear();
+   mStats.AddMessage(zmsg_content_size(message));
    int msgSize = zmsg_size(message);
    for (int i = 0; i < msgSize; i ++) {
       zframe_t* frame = zmsg_pop(message);
@@ -185,12 +199,63 @@ bool Headcrab::GetHitWait(std::vector<std::string>& theHits, const int timeout)
    if (! mFace) {
       return false;
    }
-   if (zsocket_poll(mFace, timeout)) {
+   const int ready = CZMQToolkit::PollIn(mFace, timeout);
+   if (ready < 0) {
+      mStats.AddPollError();
+   }
+   if (ready > 0) {
       return GetHitBlock(theHits);
    }
    return false;
 }
 
+/**
+ * Get hit without waiting, for callers driving their own epoll loop on 
+ * GetReadFd.
+ * 
+ * The fd is edge triggered, once it fires keep calling this until it 
+ * returns false, replying to each hit. A false return has checked 
+ * ZMQ_EVENTS so the fd is armed again for the next hit.
+ * @param theHits
+ * @return 
+ *   If a hit was taken
+ */
+bool Headcrab::TryGetHit(std::vector<std::string>& theHits) {
+   if (GetHitWait(theHits, 0)) {
+      return true;
+   }
+   return (CZMQToolkit::HasEvents(mFace, ZMQ_POLLIN) && GetHitWait(theHits, 0));
+}
+
+bool Headcrab::TryGetHit(std::string& theHit) {
+   std::vector<std::string> hits;
+   if (TryGetHit(hits) && ! hits.empty()) {
+      theHit = hits[0];
+      return true;
+   }
+   return false;
+}
+
+/**
+ * Get a file descriptor to wait on for hits, with epoll or the like. It is
+ * edge triggered, see TryGetHit.
+ * @return 
+ *   The file descriptor, or -1 if we haven't come to life
+ */
+int Headcrab::GetReadFd() {
+   return CZMQToolkit::GetFd(mFace);
+}
+
+/**
+ * Get a file descriptor to wait on for room to send splatter. zeromq signals
+ * reads and writes on the same descriptor, check ZMQ_EVENTS after it fires.
+ * @return 
+ *   The file descriptor, or -1 if we haven't come to life
+ */
+int Headcrab::GetWriteFd() {
+   return CZMQToolkit::GetFd(mFace);
+}
+
 bool Headcrab::SendSplatter(const std::string& feedback) {
    std::vector<std::string> allReplies;
    allReplies.push_back(feedback);
@@ -206,9 +271,12 @@ bool Headcrab::SendSplatter(std::vector<std::string>& feedback) {
            it != feedback.end(); it ++) {
       zmsg_addmem(message, &((*it)[0]), it->size());
    }
+   const size_t bytes = zmsg_content_size(message);
    bool success = true;
    if (zmsg_send(&message, mFace) != 0) {
       success = false;
+   } else {
+      mStats.AddMessage(bytes);
    }
    if (message) {
       zmsg_destroy(&message);
@@ -10,6 +10,7 @@
 #include <string>
 #include <vector>
 #include "global.h"
+#include "SocketStats.h"
 struct _zctx_t;
 typedef struct _zctx_t zctx_t;
 class Headcrab {
@@ -26,9 +27,15 @@ public:
    bool SendSplatter(std::vector<std::string>& feedback);
    bool GetHitBlock(std::string& theHit);
    bool GetHitWait(std::string& theHit,const int timeout);
+   bool TryGetHit(std::vector<std::string>& theHits);
+   bool TryGetHit(std::string& theHit);
+   int GetReadFd();
+   int GetWriteFd();
    bool SendSplatter(const std::string& feedback);
    static int GetHighWater();
+   SocketStats::Snapshot GetStats() const;
 private:
+   friend class Reactor;
 
    void setIpcFilePermissions();
    Headcrab(const Headcrab& that) : mContext(NULL), mFace(NULL) {
@@ -37,5 +44,6 @@ private:
    std::string mBinding;
    zctx_t* mContext;
    void* mFace;
+   SocketStats mStats;
 };
 
@@ -0,0 +1,195 @@
+#include <string.h>
+#include <chrono>
+
+#include "InprocEndpoint.h"
+
+namespace {
+   // Spins before parking, enough to ride out a peer that is mid push or pop
+   const int kSpinsBeforeParking = 64;
+
+   /**
+    * Milliseconds left before the deadline, never negative.
+    */
+   int Remaining(const std::chrono::steady_clock::time_point& deadline) {
+      const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+         deadline - std::chrono::steady_clock::now()).count();
+      return (left > 0) ? static_cast<int> (left) : 0;
+   }
+}
+
+/**
+ * Construct an endpoint with no peers.
+ * @param hwm
+ *   How many messages this end is willing to queue
+ */
+InprocEndpoint::InprocEndpoint(const int hwm) : mHwm(hwm),
+mBell(std::make_shared<Doorbell>()),
+mVersion(0),
+mSnapshotVersion(0),
+mNext(0) {
+}
+
+/**
+ * @return 
+ *   The high water mark this end was created with
+ */
+int InprocEndpoint::GetHighWater() const {
+   return mHwm;
+}
+
+/**
+ * Replace the pipes to our peers. Called by the junction with its lock held.
+ * @param pipes
+ */
+void InprocEndpoint::SetPipes(const std::vector<std::shared_ptr<InprocPipe> >& pipes) {
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mPipes = pipes;
+      mVersion.fetch_add(1, std::memory_order_release);
+   }
+   mBell->Ring();
+}
+
+/**
+ * Pick up the latest pipes if they have changed since we last looked.
+ */
+void InprocEndpoint::Refresh() {
+   if (mVersion.load(std::memory_order_acquire) == mSnapshotVersion) {
+      return;
+   }
+   std::lock_guard<std::mutex> lock(mMutex);
+   mSnapshot = mPipes;
+   mSnapshotVersion = mVersion.load(std::memory_order_relaxed);
+   if (mNext >= mSnapshot.size()) {
+      mNext = 0;
+   }
+}
+
+/**
+ * Push into the next pipe with room, round robin.
+ * @param bullet
+ * @return 
+ */
+bool InprocEndpoint::TryFire(std::string& bullet) {
+   const size_t pipes = mSnapshot.size();
+   for (size_t i = 0; i < pipes; i++) {
+      const size_t index = (mNext + i) % pipes;
+      InprocPipe& pipe = *mSnapshot[index];
+      if (pipe.mRing.Push(bullet)) {
+         mNext = (index + 1) % pipes;
+         pipe.mVampireBell->Ring();
+         return true;
+      }
+   }
+   return false;
+}
+
+/**
+ * Pop from the next pipe with a shot waiting, fair queued.
+ * @param wound
+ * @return 
+ */
+bool InprocEndpoint::TryGetShot(std::string& wound) {
+   const size_t pipes = mSnapshot.size();
+   for (size_t i = 0; i < pipes; i++) {
+      const size_t index = (mNext + i) % pipes;
+      InprocPipe& pipe = *mSnapshot[index];
+      if (pipe.mRing.Pop(wound)) {
+         mNext = (index + 1) % pipes;
+         pipe.mRifleBell->Ring();
+         return true;
+      }
+   }
+   return false;
+}
+
+/**
+ * Queue a bullet for one of the Vampires, parking until there is room.
+ * @param bullet
+ *   Swapped into the pipe, on success it is left holding a recycled buffer
+ * @param waitToFire
+ *   In milliseconds, negative waits forever
+ * @return 
+ *   If the bullet was queued
+ */
+bool InprocEndpoint::Fire(std::string& bullet, const int waitToFire) {
+   const auto deadline = std::chrono::steady_clock::now() +
+      std::chrono::milliseconds(waitToFire > 0 ? waitToFire : 0);
+   for (int spin = 0;; spin++) {
+      Refresh();
+      if (TryFire(bullet)) {
+         return true;
+      }
+      if (waitToFire == 0) {
+         return false;
+      }
+      if (spin < kSpinsBeforeParking) {
+         continue;
+      }
+      const uint32_t ticket = mBell->Arm();
+      Refresh();
+      if (TryFire(bullet)) {
+         mBell->Disarm();
+         return true;
+      }
+      const int remaining = (waitToFire < 0) ? -1 : Remaining(deadline);
+      if (remaining == 0) {
+         mBell->Disarm();
+         return false;
+      }
+      mBell->Wait(ticket, remaining);
+   }
+}
+
+/**
+ * Queue a copy of some memory for one of the Vampires.
+ * 
+ * The copy goes through a scratch string that trades buffers with the pipe,
+ * so once the pipe is warm this doesn't allocate.
+ * @param data
+ * @param size
+ * @param waitToFire
+ * @return 
+ */
+bool InprocEndpoint::FireCopy(const void* data, const size_t size, const int waitToFire) {
+   mScratch.assign(reinterpret_cast<const char*> (data), size);
+   return Fire(mScratch, waitToFire);
+}
+
+/**
+ * Take the next bullet from any of the Rifles, parking until one arrives.
+ * @param wound
+ *   Swapped out of the pipe, its old buffer goes back for reuse
+ * @param timeout
+ *   In milliseconds, negative waits forever
+ * @return 
+ *   If a bullet was received
+ */
+bool InprocEndpoint::GetShot(std::string& wound, const int timeout) {
+   const auto deadline = std::chrono::steady_clock::now() +
+      std::chrono::milliseconds(timeout > 0 ? timeout : 0);
+   for (int spin = 0;; spin++) {
+      Refresh();
+      if (TryGetShot(wound)) {
+         return true;
+      }
+      if (timeout == 0) {
+         return false;
+      }
+      if (spin < kSpinsBeforeParking) {
+         continue;
+      }
+      const uint32_t ticket = mBell->Arm();
+      Refresh();
+      if (TryGetShot(wound)) {
+         mBell->Disarm();
+         return true;
+      }
+      const int remaining = (timeout < 0) ? -1 : Remaining(deadline);
+      if (remaining == 0) {
+         mBell->Disarm();
+         return false;
+      }
+      mBell->Wait(ticket, remaining);
+   }
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "SpscRing.h"
+#include "Doorbell.h"
+
+/**
+ * The pipe between one Rifle and one Vampire sharing an inproc location.
+ */
+struct InprocPipe {
+   InprocPipe(const size_t capacity, const std::shared_ptr<Doorbell>& rifleBell,
+      const std::shared_ptr<Doorbell>& vampireBell) : mRing(capacity),
+   mRifleBell(rifleBell), mVampireBell(vampireBell) {
+   }
+   SpscRing<std::string> mRing;
+   std::shared_ptr<Doorbell> mRifleBell; // rung when a shot makes room
+   std::shared_ptr<Doorbell> mVampireBell; // rung when a bullet is queued
+};
+
+/**
+ * One Rifle's or one Vampire's end of an inproc location.
+ * 
+ * Like a zeromq PUSH / PULL pair every Rifle has its own pipe to every 
+ * Vampire, so each pipe has exactly one producer and one consumer and needs 
+ * no compare and swap. Rifles round robin over the pipes that have room, 
+ * Vampires fair queue over the pipes that have shots. Only the thread using
+ * the Rifle or Vampire calls Fire / GetShot, the InprocJunction swaps in a 
+ * new set of pipes when peers come and go.
+ */
+class InprocEndpoint {
+public:
+   explicit InprocEndpoint(const int hwm);
+
+   bool Fire(std::string& bullet, const int waitToFire);
+   bool FireCopy(const void* data, const size_t size, const int waitToFire);
+   bool GetShot(std::string& wound, const int timeout);
+   int GetHighWater() const;
+private:
+   friend class InprocJunction;
+   InprocEndpoint(const InprocEndpoint&) = delete;
+   InprocEndpoint& operator=(const InprocEndpoint&) = delete;
+
+   void Refresh();
+   bool TryFire(std::string& bullet);
+   bool TryGetShot(std::string& wound);
+   void SetPipes(const std::vector<std::shared_ptr<InprocPipe> >& pipes);
+
+   const int mHwm;
+   std::shared_ptr<Doorbell> mBell;
+   std::mutex mMutex;
+   std::vector<std::shared_ptr<InprocPipe> > mPipes;
+   std::atomic<unsigned int> mVersion;
+   std::vector<std::shared_ptr<InprocPipe> > mSnapshot;
+   unsigned int mSnapshotVersion;
+   size_t mNext;
+   std::string mScratch;
+};
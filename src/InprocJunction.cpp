@@ -0,0 +1,131 @@
+#include <algorithm>
+
+#include "InprocJunction.h"
+#include "g2log.hpp"
+
+/**
+ * Get the process wide junction.
+ * @return 
+ */
+InprocJunction& InprocJunction::Instance() {
+   static InprocJunction junction;
+   return junction;
+}
+
+/**
+ * @param location
+ * @return 
+ *   If the location is an inproc:// one that we handle natively
+ */
+bool InprocJunction::IsInproc(const std::string& location) {
+   return (location.compare(0, 9, "inproc://") == 0);
+}
+
+/**
+ * Attach a new Rifle or Vampire end to a location, creating pipes to all the
+ * peers already there.
+ * @param location
+ * @param isRifle
+ *   true for a Rifle, false for a Vampire
+ * @param bind
+ *   If this end owns the location
+ * @param hwm
+ * @return 
+ *   The new end, or nothing if the location is already bound
+ */
+std::shared_ptr<InprocEndpoint> InprocJunction::Attach(const std::string& location,
+   const bool isRifle, const bool bind, const int hwm) {
+   std::lock_guard<std::mutex> lock(mMutex);
+   Location& junction = mLocations[location];
+   if (bind && junction.mBinder) {
+      LOG(WARNING) << "Inproc location already bound: " << location;
+      return std::shared_ptr<InprocEndpoint>();
+   }
+   std::shared_ptr<InprocEndpoint> endpoint = std::make_shared<InprocEndpoint>(hwm);
+   std::vector<std::shared_ptr<InprocEndpoint> >& peers = isRifle ? junction.mVampires : junction.mRifles;
+   std::vector<std::shared_ptr<InprocPipe> > pipes;
+   for (auto it = peers.begin(); it != peers.end(); it++) {
+      InprocEndpoint& peer = **it;
+      const size_t capacity = std::max(1, hwm + peer.GetHighWater());
+      std::shared_ptr<InprocPipe> pipe = isRifle ?
+         std::make_shared<InprocPipe>(capacity, endpoint->mBell, peer.mBell) :
+         std::make_shared<InprocPipe>(capacity, peer.mBell, endpoint->mBell);
+      pipes.push_back(pipe);
+      std::vector<std::shared_ptr<InprocPipe> > peerPipes = peer.mPipes;
+      peerPipes.push_back(pipe);
+      peer.SetPipes(peerPipes);
+   }
+   endpoint->SetPipes(pipes);
+   (isRifle ? junction.mRifles : junction.mVampires).push_back(endpoint);
+   if (bind) {
+      junction.mBinder = endpoint.get();
+   }
+   return endpoint;
+}
+
+/**
+ * Take a pipe shared with the leaving end away from its peer.
+ * @param leaving
+ * @param peer
+ */
+void InprocJunction::RemovePipesOf(InprocEndpoint& leaving, InprocEndpoint& peer) {
+   std::vector<std::shared_ptr<InprocPipe> > peerPipes = peer.mPipes;
+   auto shared = std::remove_if(peerPipes.begin(), peerPipes.end(),
+      [&leaving](const std::shared_ptr<InprocPipe>& pipe) {
+         return (std::find(leaving.mPipes.begin(), leaving.mPipes.end(), pipe) != leaving.mPipes.end());
+      });
+   if (shared != peerPipes.end()) {
+      peerPipes.erase(shared, peerPipes.end());
+      peer.SetPipes(peerPipes);
+   }
+}
+
+/**
+ * Detach an end from its location, bullets still queued in its pipes are 
+ * dropped.
+ * @param location
+ * @param endpoint
+ *   Reset once detached
+ */
+void InprocJunction::Detach(const std::string& location, std::shared_ptr<InprocEndpoint>& endpoint) {
+   if (!endpoint) {
+      return;
+   }
+   std::lock_guard<std::mutex> lock(mMutex);
+   auto found = mLocations.find(location);
+   if (found != mLocations.end()) {
+      Location& junction = found->second;
+      for (auto list : {&junction.mRifles, &junction.mVampires}) {
+         auto self = std::find(list->begin(), list->end(), endpoint);
+         if (self != list->end()) {
+            list->erase(self);
+            std::vector<std::shared_ptr<InprocEndpoint> >& peers =
+               (list == &junction.mRifles) ? junction.mVampires : junction.mRifles;
+            for (auto it = peers.begin(); it != peers.end(); it++) {
+               RemovePipesOf(*endpoint, **it);
+            }
+         }
+      }
+      if (junction.mBinder == endpoint.get()) {
+         junction.mBinder = NULL;
+      }
+      if (junction.mRifles.empty() && junction.mVampires.empty()) {
+         mLocations.erase(found);
+      }
+   }
+   endpoint.reset();
+}
+
+/**
+ * @param location
+ * @return 
+ *   The number of Rifle to Vampire pipes at a location
+ */
+size_t InprocJunction::GetPipeCount(const std::string& location) {
+   std::lock_guard<std::mutex> lock(mMutex);
+   auto found = mLocations.find(location);
+   if (found == mLocations.end()) {
+      return 0;
+   }
+   return found->second.mRifles.size() * found->second.mVampires.size();
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <stddef.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "InprocEndpoint.h"
+
+/**
+ * Connects the Rifles and Vampires that share an inproc:// location.
+ * 
+ * Inproc Rifles and Vampires don't go through zeromq at all, they exchange 
+ * bullets over lock free rings. Every Rifle gets a pipe to every Vampire, 
+ * the pipe holds the high water marks of both ends. As with zeromq only one
+ * end may bind a location, but either end may attach first.
+ */
+class InprocJunction {
+public:
+   static InprocJunction& Instance();
+   static bool IsInproc(const std::string& location);
+
+   std::shared_ptr<InprocEndpoint> Attach(const std::string& location,
+      const bool isRifle, const bool bind, const int hwm);
+   void Detach(const std::string& location, std::shared_ptr<InprocEndpoint>& endpoint);
+   size_t GetPipeCount(const std::string& location);
+private:
+   struct Location {
+      Location() : mBinder(NULL) {
+      }
+      const InprocEndpoint* mBinder;
+      std::vector<std::shared_ptr<InprocEndpoint> > mRifles;
+      std::vector<std::shared_ptr<InprocEndpoint> > mVampires;
+   };
+   InprocJunction() = default;
+   InprocJunction(const InprocJunction&) = delete;
+   InprocJunction& operator=(const InprocJunction&) = delete;
+   static void RemovePipesOf(InprocEndpoint& leaving, InprocEndpoint& peer);
+
+   std::mutex mMutex;
+   std::map<std::string, Location> mLocations;
+};
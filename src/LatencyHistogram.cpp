@@ -0,0 +1,137 @@
+#include <time.h>
+#include <string.h>
+#include <algorithm>
+
+#include "LatencyHistogram.h"
+#include "SocketStats.h"
+
+LatencyHistogram::LatencyHistogram() : mCount(0), mMax(0), mTotal(0) {
+   for (size_t i = 0; i < kBucketCount; i++) {
+      mBuckets[i].store(0, std::memory_order_relaxed);
+   }
+}
+
+/**
+ * @return 
+ *   CLOCK_MONOTONIC in nanoseconds
+ */
+uint64_t LatencyHistogram::Now() {
+   struct timespec now;
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return static_cast<uint64_t> (now.tv_sec) * 1000000000ULL + now.tv_nsec;
+}
+
+/**
+ * Write the current time into the first kStampSize bytes of a bullet.
+ * @param header
+ */
+void LatencyHistogram::Stamp(void* header) {
+   const uint64_t now = Now();
+   memcpy(header, &now, kStampSize);
+}
+
+/**
+ * @param header
+ *   A bullet written by Stamp
+ * @return 
+ *   The nanoseconds since it was stamped
+ */
+uint64_t LatencyHistogram::Elapsed(const void* header) {
+   uint64_t stamp;
+   memcpy(&stamp, header, kStampSize);
+   const uint64_t now = Now();
+   return (now > stamp) ? now - stamp : 0;
+}
+
+/**
+ * @param nanoseconds
+ * @return 
+ *   The bucket the value is counted in
+ */
+size_t LatencyHistogram::BucketOf(const uint64_t nanoseconds) {
+   if (nanoseconds < kSubBuckets) {
+      return nanoseconds;
+   }
+   const size_t magnitude = 63 - __builtin_clzll(nanoseconds);
+   const size_t subBucket = (nanoseconds >> (magnitude - kSubBucketBits)) & (kSubBuckets - 1);
+   return (magnitude - kSubBucketBits + 1) * kSubBuckets + subBucket;
+}
+
+/**
+ * @param bucket
+ * @return 
+ *   The largest value counted in the bucket
+ */
+uint64_t LatencyHistogram::HighestIn(const size_t bucket) {
+   if (bucket < kSubBuckets) {
+      return bucket;
+   }
+   const size_t magnitude = bucket / kSubBuckets + kSubBucketBits - 1;
+   const uint64_t lowest = static_cast<uint64_t> (kSubBuckets + bucket % kSubBuckets)
+      << (magnitude - kSubBucketBits);
+   return lowest + (1ULL << (magnitude - kSubBucketBits)) - 1;
+}
+
+/**
+ * Count one delivery.
+ * @param nanoseconds
+ */
+void LatencyHistogram::Record(const uint64_t nanoseconds) {
+   SocketStats::Bump(mBuckets[BucketOf(nanoseconds)], 1);
+   SocketStats::Bump(mTotal, nanoseconds);
+   if (nanoseconds > mMax.load(std::memory_order_relaxed)) {
+      mMax.store(nanoseconds, std::memory_order_relaxed);
+   }
+   // released after the bucket, a reader that acquires the count sees every 
+   // delivery it covers in the buckets
+   mCount.store(mCount.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+/**
+ * @return 
+ *   How many deliveries have been recorded
+ */
+uint64_t LatencyHistogram::GetCount() const {
+   return mCount.load(std::memory_order_acquire);
+}
+
+/**
+ * @return 
+ *   The slowest delivery, exactly
+ */
+uint64_t LatencyHistogram::GetMax() const {
+   return mMax.load(std::memory_order_relaxed);
+}
+
+/**
+ * @return 
+ *   The average delivery
+ */
+uint64_t LatencyHistogram::GetMean() const {
+   const uint64_t count = GetCount();
+   return (count == 0) ? 0 : mTotal.load(std::memory_order_relaxed) / count;
+}
+
+/**
+ * @param percentile
+ *   Between 0 and 100, e.g. 99.9
+ * @return 
+ *   The latency that percentile of deliveries came in under, 0 if nothing 
+ * has been recorded
+ */
+uint64_t LatencyHistogram::GetPercentile(const double percentile) const {
+   const uint64_t count = GetCount();
+   if (count == 0) {
+      return 0;
+   }
+   const double wanted = std::min(100.0, std::max(0.0, percentile));
+   const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t> (count * wanted / 100.0 + 0.5));
+   uint64_t seen = 0;
+   for (size_t bucket = 0; bucket < kBucketCount; bucket++) {
+      seen += mBuckets[bucket].load(std::memory_order_relaxed);
+      if (seen >= rank) {
+         return std::min(HighestIn(bucket), GetMax());
+      }
+   }
+   return GetMax();
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * A log-linear histogram of one way delivery latencies, in nanoseconds.
+ * 
+ * Every power of two is split into kSubBuckets linear buckets, so any value
+ * is reported within about 6% of what was recorded. One thread records, 
+ * using relaxed loads and stores instead of locked adds, and any thread can
+ * read percentiles at any time.
+ * 
+ * Rifles stamp bullets with Now() taken from CLOCK_MONOTONIC, which is the 
+ * same clock for every process on a host. Latencies are only meaningful 
+ * when both ends share a host.
+ */
+class LatencyHistogram {
+public:
+   static const size_t kStampSize = sizeof (uint64_t);
+   static const size_t kSubBucketBits = 4;
+   static const size_t kSubBuckets = 1 << kSubBucketBits;
+   static const size_t kBucketCount = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+   LatencyHistogram();
+
+   static uint64_t Now();
+   static void Stamp(void* header);
+   static uint64_t Elapsed(const void* header);
+
+   void Record(const uint64_t nanoseconds);
+   uint64_t GetCount() const;
+   uint64_t GetMax() const;
+   uint64_t GetMean() const;
+   uint64_t GetPercentile(const double percentile) const;
+private:
+   LatencyHistogram(const LatencyHistogram&) = delete;
+   LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+   static size_t BucketOf(const uint64_t nanoseconds);
+   static uint64_t HighestIn(const size_t bucket);
+
+   std::atomic<uint64_t> mBuckets[kBucketCount];
+   std::atomic<uint64_t> mCount;
+   std::atomic<uint64_t> mMax;
+   std::atomic<uint64_t> mTotal;
+};
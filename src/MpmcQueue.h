@@ -0,0 +1,115 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+
+/**
+ * A bounded, lock free, multi producer multi consumer queue.
+ * 
+ * Dmitry Vyukov's array queue: every cell carries a sequence number that 
+ * says whether it is ready to be written or read for the current lap, so a
+ * producer or consumer claims a cell with one compare and swap on its index
+ * and never touches the other side's index.
+ */
+template<typename T>
+class MpmcQueue {
+public:
+
+   /**
+    * @param capacity
+    *   Rounded up to the next power of two
+    */
+   explicit MpmcQueue(const size_t capacity) : mMask(RoundUp(capacity) - 1),
+   mCells(new Cell[mMask + 1]), mEnqueue(0), mDequeue(0) {
+      for (size_t i = 0; i <= mMask; i++) {
+         mCells[i].mSequence.store(i, std::memory_order_relaxed);
+      }
+   }
+
+   /**
+    * @param item
+    * @return 
+    *   false if the queue is full
+    */
+   bool Push(const T& item) {
+      size_t position = mEnqueue.load(std::memory_order_relaxed);
+      for (;;) {
+         Cell& cell = mCells[position & mMask];
+         const size_t sequence = cell.mSequence.load(std::memory_order_acquire);
+         const intptr_t difference = static_cast<intptr_t> (sequence) - static_cast<intptr_t> (position);
+         if (difference == 0) {
+            if (mEnqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+               cell.mItem = item;
+               cell.mSequence.store(position + 1, std::memory_order_release);
+               return true;
+            }
+         } else if (difference < 0) {
+            return false;
+         } else {
+            position = mEnqueue.load(std::memory_order_relaxed);
+         }
+      }
+   }
+
+   /**
+    * @param item
+    * @return 
+    *   false if the queue is empty
+    */
+   bool Pop(T& item) {
+      size_t position = mDequeue.load(std::memory_order_relaxed);
+      for (;;) {
+         Cell& cell = mCells[position & mMask];
+         const size_t sequence = cell.mSequence.load(std::memory_order_acquire);
+         const intptr_t difference = static_cast<intptr_t> (sequence) - static_cast<intptr_t> (position + 1);
+         if (difference == 0) {
+            if (mDequeue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+               item = cell.mItem;
+               cell.mSequence.store(position + mMask + 1, std::memory_order_release);
+               return true;
+            }
+         } else if (difference < 0) {
+            return false;
+         } else {
+            position = mDequeue.load(std::memory_order_relaxed);
+         }
+      }
+   }
+
+   /**
+    * Approximate, exact only when nobody is pushing or popping.
+    * @return 
+    */
+   size_t Size() const {
+      return mEnqueue.load(std::memory_order_acquire) - mDequeue.load(std::memory_order_acquire);
+   }
+
+   size_t Capacity() const {
+      return mMask + 1;
+   }
+private:
+
+   struct Cell {
+      std::atomic<size_t> mSequence;
+      T mItem;
+   };
+   MpmcQueue(const MpmcQueue&) = delete;
+   MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+   static size_t RoundUp(const size_t capacity) {
+      size_t size = 1;
+      while (size < capacity) {
+         size <<= 1;
+      }
+      return size;
+   }
+
+   const size_t mMask;
+   std::unique_ptr<Cell[]> mCells;
+   char mPadEnqueue[64];
+   std::atomic<size_t> mEnqueue;
+   char mPadDequeue[64];
+   std::atomic<size_t> mDequeue;
+   char mPadEnd[64];
+};
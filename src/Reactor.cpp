@@ -0,0 +1,430 @@
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+
+#include "Reactor.h"
+#include "Vampire.h"
+#include "Alien.h"
+#include "Headcrab.h"
+#include "Crowbar.h"
+#include "BoomStick.h"
+#include "czmq.h"
+#include "g2log.hpp"
+
+/**
+ * Construct a reactor with nothing to watch.
+ */
+Reactor::Reactor() :
+mNextTimer(1),
+mChanged(true),
+mStopped(false),
+mWakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+   if (mWakeFd < 0) {
+      LOG(WARNING) << "Reactor can't create its wake up eventfd, Stop from another thread "
+         "waits for the next socket or timer";
+   }
+}
+
+/**
+ * The watched sockets are left alone, they belong to their wrappers.
+ */
+Reactor::~Reactor() {
+   if (mWakeFd >= 0) {
+      close(mWakeFd);
+   }
+}
+
+/**
+ * Call the handler whenever the Vampire has been shot.
+ * @param vampire
+ *   Prepared to be shot over a zeromq transport, it must outlive the watch
+ * @param handler
+ * @return 
+ *   false if the Vampire can't be watched
+ */
+bool Reactor::Add(Vampire& vampire, const std::function<void (Vampire&)>& handler) {
+   if (vampire.mInproc || vampire.mShm) {
+      LOG(WARNING) << "Reactor can't watch a native transport: " << vampire.GetBinding();
+      return false;
+   }
+   return AddWatch(&vampire, vampire.mBody, [&vampire, handler]() {
+      handler(vampire);
+   });
+}
+
+/**
+ * Call the handler whenever the Alien has been shot, or while a conflating
+ * Alien holds shots.
+ * @param alien
+ *   It must outlive the watch
+ * @param handler
+ * @return 
+ *   false if the Alien can't be watched
+ */
+bool Reactor::Add(Alien& alien, const std::function<void (Alien&)>& handler) {
+   return AddWatch(&alien, alien.mBody, [&alien, handler]() {
+      handler(alien);
+   }, [&alien]() {
+      return alien.HasHeld();
+   });
+}
+
+/**
+ * Call the handler whenever the Headcrab has been hit.
+ * @param headcrab
+ *   Brought to life, it must outlive the watch
+ * @param handler
+ * @return 
+ *   false if the Headcrab can't be watched
+ */
+bool Reactor::Add(Headcrab& headcrab, const std::function<void (Headcrab&)>& handler) {
+   return AddWatch(&headcrab, headcrab.mFace, [&headcrab, handler]() {
+      handler(headcrab);
+   });
+}
+
+/**
+ * Call the handler whenever a kill has come back to the Crowbar.
+ * @param crowbar
+ *   Wielded, it must outlive the watch
+ * @param handler
+ * @return 
+ *   false if the Crowbar can't be watched
+ */
+bool Reactor::Add(Crowbar& crowbar, const std::function<void (Crowbar&)>& handler) {
+   return AddWatch(&crowbar, crowbar.mTip, [&crowbar, handler]() {
+      handler(crowbar);
+   });
+}
+
+/**
+ * Call the handler whenever a reply has come back to the BoomStick.
+ * @param boomStick
+ *   Initialized, it must outlive the watch
+ * @param handler
+ * @return 
+ *   false if the BoomStick can't be watched
+ */
+bool Reactor::Add(BoomStick& boomStick, const std::function<void (BoomStick&)>& handler) {
+   return AddWatch(&boomStick, boomStick.mChamber, [&boomStick, handler]() {
+      handler(boomStick);
+   });
+}
+
+/**
+ * Stop watching a Vampire.
+ * @param vampire
+ */
+void Reactor::Remove(const Vampire& vampire) {
+   RemoveWatch(&vampire);
+}
+
+/**
+ * Stop watching an Alien.
+ * @param alien
+ */
+void Reactor::Remove(const Alien& alien) {
+   RemoveWatch(&alien);
+}
+
+/**
+ * Stop watching a Headcrab.
+ * @param headcrab
+ */
+void Reactor::Remove(const Headcrab& headcrab) {
+   RemoveWatch(&headcrab);
+}
+
+/**
+ * Stop watching a Crowbar.
+ * @param crowbar
+ */
+void Reactor::Remove(const Crowbar& crowbar) {
+   RemoveWatch(&crowbar);
+}
+
+/**
+ * Stop watching a BoomStick.
+ * @param boomStick
+ */
+void Reactor::Remove(const BoomStick& boomStick) {
+   RemoveWatch(&boomStick);
+}
+
+/**
+ * @param owner
+ *   The wrapper the socket belongs to
+ * @param socket
+ * @param handler
+ * @param held
+ *   If the owner has something for the handler that the socket doesn't show,
+ * may be empty
+ * @return 
+ *   false if there is no socket yet or the owner is already watched
+ */
+bool Reactor::AddWatch(const void* owner, void* socket, const std::function<void ()>& handler,
+   const std::function<bool ()>& held) {
+   if (socket == NULL) {
+      LOG(WARNING) << "Reactor can't watch a socket that hasn't been set up";
+      return false;
+   }
+   for (auto it = mWatches.begin(); it != mWatches.end(); it++) {
+      if (it->mOwner == owner && !it->mRemoved) {
+         LOG(WARNING) << "Reactor is already watching that socket";
+         return false;
+      }
+   }
+   Watch watch;
+   watch.mOwner = owner;
+   watch.mSocket = socket;
+   watch.mHandler = handler;
+   watch.mHeld = held;
+   watch.mRemoved = false;
+   mWatches.push_back(watch);
+   mChanged = true;
+   return true;
+}
+
+/**
+ * Mark the owner's watch as removed, it is dropped by the next Poll.
+ * @param owner
+ */
+void Reactor::RemoveWatch(const void* owner) {
+   for (auto it = mWatches.begin(); it != mWatches.end(); it++) {
+      if (it->mOwner == owner && !it->mRemoved) {
+         it->mRemoved = true;
+         mChanged = true;
+      }
+   }
+}
+
+/**
+ * @param watch
+ * @return 
+ *   If the watch's owner holds something the poll can't see
+ */
+bool Reactor::IsHeld(const size_t watch) const {
+   return !mWatches[watch].mRemoved && mWatches[watch].mHeld && mWatches[watch].mHeld();
+}
+
+/**
+ * @return 
+ *   How many sockets are being watched
+ */
+size_t Reactor::GetWatchCount() const {
+   return std::count_if(mWatches.begin(), mWatches.end(), [](const Watch & watch) {
+      return !watch.mRemoved;
+   });
+}
+
+/**
+ * Call the handler after an interval.
+ * @param interval
+ *   In milliseconds
+ * @param handler
+ * @param repeat
+ *   Call it every interval until the timer is cancelled, otherwise just once
+ * @return 
+ *   The timer's id, for CancelTimer
+ */
+int Reactor::AddTimer(const unsigned int interval, const std::function<void ()>& handler,
+   const bool repeat) {
+   Timer timer;
+   timer.mInterval = std::chrono::milliseconds(interval);
+   timer.mDue = std::chrono::steady_clock::now() + timer.mInterval;
+   timer.mHandler = handler;
+   timer.mRepeat = repeat;
+   timer.mCancelled = false;
+   const int id = mNextTimer++;
+   mTimers[id] = timer;
+   return id;
+}
+
+/**
+ * Cancel a timer, it is safe to cancel one that has already gone off.
+ * @param timer
+ */
+void Reactor::CancelTimer(const int timer) {
+   auto found = mTimers.find(timer);
+   if (found != mTimers.end()) {
+      found->second.mCancelled = true;
+      mChanged = true;
+   }
+}
+
+/**
+ * @return 
+ *   How many timers are still to go off
+ */
+size_t Reactor::GetTimerCount() const {
+   return std::count_if(mTimers.begin(), mTimers.end(), [](const std::pair<const int, Timer>& timer) {
+      return !timer.second.mCancelled;
+   });
+}
+
+/**
+ * Drop removed watches and spent timers, then rebuild the poll items.
+ */
+void Reactor::Tidy() {
+   if (!mChanged) {
+      return;
+   }
+   mWatches.erase(std::remove_if(mWatches.begin(), mWatches.end(), [](const Watch & watch) {
+      return watch.mRemoved;
+   }), mWatches.end());
+   for (auto it = mTimers.begin(); it != mTimers.end();) {
+      if (it->second.mCancelled) {
+         it = mTimers.erase(it);
+      } else {
+         it++;
+      }
+   }
+   mItems.clear();
+   for (auto it = mWatches.begin(); it != mWatches.end(); it++) {
+      zmq_pollitem_t item = {it->mSocket, 0, ZMQ_POLLIN, 0};
+      mItems.push_back(item);
+   }
+   if (mWakeFd >= 0) {
+      zmq_pollitem_t wake = {NULL, mWakeFd, ZMQ_POLLIN, 0};
+      mItems.push_back(wake);
+   }
+   mChanged = false;
+}
+
+/**
+ * @param timeout
+ *   The longest the caller wants to wait, in milliseconds
+ * @return 
+ *   How long to poll for so the next timer isn't late
+ */
+int Reactor::GetPollTimeout(const int timeout) const {
+   int wait = timeout;
+   const auto now = std::chrono::steady_clock::now();
+   for (auto it = mTimers.begin(); it != mTimers.end(); it++) {
+      if (it->second.mCancelled) {
+         continue;
+      }
+      // round up, or we would wake just before the timer is due
+      const long due = std::max(0L, static_cast<long> (std::chrono::duration_cast<std::chrono::microseconds>(
+         it->second.mDue - now).count() + 999) / 1000);
+      if (wait < 0 || due < wait) {
+         wait = due;
+      }
+   }
+   return wait;
+}
+
+/**
+ * Call the handlers of the timers that are due.
+ * @return 
+ *   How many went off
+ */
+int Reactor::FireTimers() {
+   const auto now = std::chrono::steady_clock::now();
+   int fired = 0;
+   for (auto it = mTimers.begin(); it != mTimers.end(); it++) {
+      Timer& timer = it->second;
+      if (timer.mCancelled || timer.mDue > now) {
+         continue;
+      }
+      if (timer.mRepeat) {
+         timer.mDue += timer.mInterval;
+         if (timer.mDue <= now) {
+            // a late timer goes off once, not once for every interval missed
+            timer.mDue = now + timer.mInterval;
+         }
+      } else {
+         timer.mCancelled = true;
+         mChanged = true;
+      }
+      timer.mHandler();
+      fired++;
+   }
+   return fired;
+}
+
+/**
+ * Wait once for any watched socket or timer and call the handlers of all 
+ * that are ready.
+ * @param timeout
+ *   The longest to wait in milliseconds, -1 waits until something is ready
+ * @return 
+ *   How many handlers were called, -1 if polling failed
+ */
+int Reactor::Poll(const int timeout) {
+   Tidy();
+   if (mWatches.empty() && GetPollTimeout(timeout) < 0) {
+      LOG(WARNING) << "Reactor has nothing to wait for";
+      return 0;
+   }
+   return Wait(timeout);
+}
+
+/**
+ * Poll the watches, timers and the wake up eventfd once.
+ * @param timeout
+ *   The longest to wait in milliseconds, -1 waits until something is ready
+ * @return 
+ *   How many handlers were called, -1 if polling failed
+ */
+int Reactor::Wait(const int timeout) {
+   Tidy();
+   const size_t watched = (mWakeFd >= 0) ? mItems.size() - 1 : mItems.size();
+   bool held = false;
+   for (size_t i = 0; i < watched && !held; i++) {
+      held = IsHeld(i);
+   }
+   const int wait = held ? 0 : GetPollTimeout(timeout);
+   const int ready = zmq_poll(mItems.data(), mItems.size(), wait);
+   if (ready < 0) {
+      LOG(WARNING) << "Error on Reactor poll: " << zmq_strerror(zmq_errno());
+      return -1;
+   }
+   if (watched < mItems.size() && (mItems[watched].revents & ZMQ_POLLIN)) {
+      uint64_t wakes;
+      while (read(mWakeFd, &wakes, sizeof (wakes)) > 0) {
+      }
+   }
+   int called = 0;
+   // handlers can add watches, only the ones that were polled are looked at
+   for (size_t i = 0; i < watched; i++) {
+      if (((mItems[i].revents & ZMQ_POLLIN) && !mWatches[i].mRemoved) || IsHeld(i)) {
+         mWatches[i].mHandler();
+         called++;
+      }
+   }
+   return called + FireTimers();
+}
+
+/**
+ * Poll until Stop is called or we are interrupted. A Stop that comes before
+ * Run makes it return straight away, either way the reactor can be Run 
+ * again afterwards.
+ */
+void Reactor::Run() {
+   while (!mStopped && !zctx_interrupted) {
+      if (Wait(mWakeFd >= 0 ? -1 : 1000) < 0) {
+         break;
+      }
+   }
+   if (zctx_interrupted) {
+      LOG(INFO) << "Caught Interrupt Signal";
+   }
+   mStopped = false;
+}
+
+/**
+ * Make Run return once the current Poll is done. Safe to call from any 
+ * thread, a Run that is waiting is woken straight away.
+ */
+void Reactor::Stop() {
+   mStopped = true;
+   if (mWakeFd >= 0) {
+      const uint64_t wake = 1;
+      if (write(mWakeFd, &wake, sizeof (wake)) < 0 && errno != EAGAIN) {
+         LOG(WARNING) << "Reactor can't wake up: " << strerror(errno);
+      }
+   }
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <stddef.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <vector>
+#include <zmq.h>
+
+class Vampire;
+class Alien;
+class Headcrab;
+class Crowbar;
+class BoomStick;
+
+/**
+ * Services many sockets, and timers, from one thread.
+ * 
+ * Vampires, Aliens, Headcrabs, Crowbars and BoomSticks are added with a 
+ * handler. All 
+ * of them are waited on in a single zmq_poll and a handler is called when 
+ * its socket has something to read. The handler reads it the usual way with
+ * a timeout of 0, e.g. vampire.GetShot(wound, 0). A handler that leaves 
+ * something unread is simply called again on the next Poll, and so is the 
+ * handler of a conflating Alien that still holds shots, without waiting.
+ * 
+ * Handlers and timers may add or remove watches and timers, and Stop the 
+ * reactor, while they run. Stop can also be called from any other thread, it
+ * wakes the poll through an eventfd. Only the zeromq transports can be 
+ * watched, not the native inproc:// or shm:// ones.
+ */
+class Reactor {
+public:
+   Reactor();
+   virtual ~Reactor();
+
+   bool Add(Vampire& vampire, const std::function<void (Vampire&)>& handler);
+   bool Add(Alien& alien, const std::function<void (Alien&)>& handler);
+   bool Add(Headcrab& headcrab, const std::function<void (Headcrab&)>& handler);
+   bool Add(Crowbar& crowbar, const std::function<void (Crowbar&)>& handler);
+   bool Add(BoomStick& boomStick, const std::function<void (BoomStick&)>& handler);
+   void Remove(const Vampire& vampire);
+   void Remove(const Alien& alien);
+   void Remove(const Headcrab& headcrab);
+   void Remove(const Crowbar& crowbar);
+   void Remove(const BoomStick& boomStick);
+   size_t GetWatchCount() const;
+
+   int AddTimer(const unsigned int interval, const std::function<void ()>& handler,
+      const bool repeat = true);
+   void CancelTimer(const int timer);
+   size_t GetTimerCount() const;
+
+   int Poll(const int timeout);
+   void Run();
+   void Stop();
+private:
+   struct Watch {
+      const void* mOwner;
+      void* mSocket;
+      std::function<void ()> mHandler;
+      // shots already taken off the socket, which the poll can't see
+      std::function<bool ()> mHeld;
+      bool mRemoved;
+   };
+   struct Timer {
+      std::chrono::steady_clock::time_point mDue;
+      std::chrono::milliseconds mInterval;
+      std::function<void ()> mHandler;
+      bool mRepeat;
+      bool mCancelled;
+   };
+   Reactor(const Reactor&) = delete;
+   Reactor& operator=(const Reactor&) = delete;
+   bool AddWatch(const void* owner, void* socket, const std::function<void ()>& handler,
+      const std::function<bool ()>& held = std::function<bool ()>());
+   bool IsHeld(const size_t watch) const;
+   void RemoveWatch(const void* owner);
+   int GetPollTimeout(const int timeout) const;
+   int Wait(const int timeout);
+   int FireTimers();
+   void Tidy();
+
+   // a deque so watches and timers added by a running handler don't move it
+   std::deque<Watch> mWatches;
+   // one per watch, then the wake up eventfd
+   std::vector<zmq_pollitem_t> mItems;
+   std::map<int, Timer> mTimers;
+   int mNextTimer;
+   bool mChanged;
+   std::atomic<bool> mStopped;
+   int mWakeFd;
+};
@@ -1,10 +1,24 @@
 #define _OPEN_SYS
 #include <sys/stat.h>
+#include <algorithm>
+#include <chrono>
 
 #include "Rifle.h"
 #include "czmq.h"
 #include "g2log.hpp"
 #include "Death.h"
+#include "ContextRegistry.h"
+#include "InprocJunction.h"
+#include "ShmRing.h"
+
+namespace {
+   /**
+    * zeromq free function for a fired StakeBundle.
+    */
+   void RecycleStakeBundle(void* data, void* hint) {
+      StakeBundle::Recycle(reinterpret_cast<StakeBundle*> (hint));
+   }
+}
 /**
  * Construct our Rifle which is a push in our ZMQ push pull.
  */
@@ -15,7 +29,9 @@ mChamber(NULL),
 mContext(NULL),
 mLinger(10),
 mIOThredCount(1),
-mOwnSocket(true) {
+mOwnSocket(true),
+mCreditDispatch(false),
+mLatencyTracking(false) {
 }
 
 /**
@@ -74,25 +90,143 @@ bool Rifle::GetOwnSocket() {
    return mOwnSocket;
 }
 
+/**
+ * Send each bullet to the Vampire with the most credit instead of round 
+ * robin. Vampires grant credit as they take their shots, so a slow Vampire 
+ * stops getting bullets before it backs up and stalls the Rifle. The 
+ * Vampires must have credit dispatch set too. This must be called before 
+ * Aim, it only applies to zeromq transports.
+ * @param credit
+ */
+void Rifle::SetCreditDispatch(const bool credit) {
+   mCreditDispatch = credit;
+}
+
+/**
+ * Get value for credit dispatch.
+ * @return bool
+ */
+bool Rifle::GetCreditDispatch() {
+   return mCreditDispatch;
+}
+
+/**
+ * @return 
+ *   What this Rifle has fired so far, safe to call from any thread. Bytes 
+ * are counted after compression.
+ */
+SocketStats::Snapshot Rifle::GetStats() const {
+   return mStats.GetSnapshot();
+}
+
+/**
+ * Stamp every shot with the time it was fired so the Vampires can measure 
+ * how long delivery takes. The Vampires must have latency tracking set too,
+ * shots then can't be sent zero copy. Only meaningful when both ends share a
+ * host.
+ * @param track
+ */
+void Rifle::SetLatencyTracking(const bool track) {
+   mLatencyTracking = track;
+}
+
+/**
+ * Get value for latency tracking.
+ * @return bool
+ */
+bool Rifle::GetLatencyTracking() {
+   return mLatencyTracking;
+}
+
+/**
+ * Compress bullets fired over zeromq, the Vampires must have compression 
+ * set too. Stakes and zero copy shots of other transports are never 
+ * compressed.
+ * @param compress
+ * @param threshold
+ *   Bullets smaller than this are sent as they are
+ */
+void Rifle::SetCompression(const bool compress, const size_t threshold) {
+   if (compress) {
+      mCompressor.reset(new Compressor(threshold));
+   } else {
+      mCompressor.reset();
+   }
+}
+
+/**
+ * Compress with a preset dictionary, the Vampires must use the same one.
+ * @param dictionary
+ *   From Compressor::TrainDictionary
+ * @return 
+ *   false if compression isn't set or the dictionary can't be used
+ */
+bool Rifle::SetCompressionDictionary(const std::string& dictionary) {
+   if (!mCompressor) {
+      LOG(WARNING) << "Compression is not set";
+      return false;
+   }
+   return mCompressor->SetDictionary(dictionary);
+}
+
+/**
+ * @return 
+ *   Uncompressed over compressed size, as last measured. 0 if nothing has 
+ * been measured or compression isn't set.
+ */
+double Rifle::GetCompressionRatio() {
+   return mCompressor ? mCompressor->GetRatio() : 0;
+}
+
 /**
  * Set the location we want to shoot at.
+ * 
+ * inproc:// locations skip zeromq and go over the lock free rings of the 
+ * InprocJunction, shm:// locations go over a ShmRing. The high water mark 
+ * still applies to both.
  * @param location
  * @return 
  */
 bool Rifle::Aim() {
-   if (mChamber) {
+   if (mChamber || mInproc || mShm) {
+      return true;
+   }
+   if (ShmRing::IsShm(mLocation)) {
+      mShm.reset(new ShmRing(mLocation, true, GetOwnSocket(), GetHighWater()));
+      if (!mShm->Open()) {
+         LOG(DEBUG) << "Rifle Can't open : " << mLocation;
+         mShm.reset();
+         return false;
+      }
+      Death::Instance().RegisterDeathEvent(&ShmRing::DeleteShmFiles, mLocation);
+      return true;
+   }
+   if (InprocJunction::IsInproc(mLocation)) {
+      mInproc = InprocJunction::Instance().Attach(mLocation, true, GetOwnSocket(), GetHighWater());
+      if (!mInproc) {
+         LOG(DEBUG) << "Can't bind : " << mLocation;
+         return false;
+      }
       return true;
    }
    if (!mContext) {
-      mContext = zctx_new();
+      mContext = ContextRegistry::Instance().Acquire(mIOThredCount);
+      if (!mContext) {
+         LOG(WARNING) << "Rifle can't get a context";
+         return false;
+      }
       zctx_set_sndhwm(mContext, GetHighWater());
       zctx_set_rcvhwm(mContext, GetHighWater());
       //zctx_set_linger(mContext, mLinger); // linger for a millisecond on close
-      zctx_set_iothreads(mContext, mIOThredCount);
    }
    if (!mChamber) {
-      mChamber = zsocket_new(mContext, ZMQ_PUSH);
+      mChamber = zsocket_new(mContext, GetCreditDispatch() ? ZMQ_ROUTER : ZMQ_PUSH);
       CZMQToolkit::setHWMAndBuffer(mChamber, GetHighWater());
+      if (GetCreditDispatch()) {
+         // fail instead of dropping bullets for a Vampire that has gone
+         int mandatory = 1;
+         zmq_setsockopt(mChamber, ZMQ_ROUTER_MANDATORY, &mandatory, sizeof (mandatory));
+      }
       if (GetOwnSocket()) {
          int result = zsocket_bind(mChamber, mLocation.c_str());
 
@@ -138,6 +272,251 @@ void Rifle::setIpcFilePermissions() {
    }
 }
 
+/**
+ * @return 
+ *   If Aim has succeeded and we can fire
+ */
+bool Rifle::IsAimed() const {
+   return (mChamber || mInproc || mShm);
+}
+
+/**
+ * Send a message, only waiting for room in the pipe when it is full.
+ *
+ * Benchmarks indicate that polling before every send slows things down, so
+ * like ZeroMQ<void*>::GetPointer we try without waiting first and only poll
+ * for ZMQ_POLLOUT if the send would block.
+ *
+ * @param message
+ *   An initialized message, on failure it is left for the caller to close
+ * @param waitToFire in milliseconds
+ * @return 
+ *   If the message was sent
+ */
+bool Rifle::SendMessage(zmq_msg_t& message, const int waitToFire) {
+   if (mCreditDispatch) {
+      return SendCredited(message, waitToFire);
+   }
+   const size_t size = zmq_msg_size(&message);
+   if (zmq_msg_send(&message, mChamber, ZMQ_DONTWAIT) >= 0) {
+      mStats.AddMessage(size);
+      return true;
+   }
+   if (zmq_errno() != EAGAIN) {
+      LOG(WARNING) << "Error on Zmq socket send: " << zmq_strerror(zmq_errno());
+      mStats.AddSendError();
+      return false;
+   }
+   zmq_pollitem_t items [] = {
+      { mChamber, 0, ZMQ_POLLOUT, 0}
+   };
+
+   const auto blocked = std::chrono::steady_clock::now();
+   const int pollResult = zmq_poll(items, 1, waitToFire);
+   mStats.AddBlockedSince(blocked);
+   if (pollResult > 0) {
+      if (items[0].revents & ZMQ_POLLOUT) {
+         if (zmq_msg_send(&message, mChamber, ZMQ_DONTWAIT) >= 0) {
+            mStats.AddMessage(size);
+            return true;
+         }
+         LOG(WARNING) << "Error on Zmq socket send: " << zmq_strerror(zmq_errno());
+      } else {
+         LOG(WARNING) << "Error in zmq_pollout in " << GetBinding() << ": " << zmq_strerror(zmq_errno());
+      }
+      mStats.AddSendError();
+   } else if (pollResult < 0) {
+      mStats.AddPollError();
+   } else {
+      mStats.AddSendTimeout();
+   }
+   return false;
+}
+
+/**
+ * Take in every credit grant the Vampires have sent, without waiting.
+ */
+void Rifle::CollectCredits() {
+   zmq_msg_t identity;
+   zmq_msg_t grant;
+   zmq_msg_init(&identity);
+   zmq_msg_init(&grant);
+   while (zmq_msg_recv(&identity, mChamber, ZMQ_DONTWAIT) >= 0) {
+      if (!zmq_msg_more(&identity) || zmq_msg_recv(&grant, mChamber, ZMQ_DONTWAIT) < 0) {
+         continue;
+      }
+      while (zmq_msg_more(&grant)) {
+         zmq_msg_recv(&grant, mChamber, ZMQ_DONTWAIT);
+      }
+      uint32_t credits = 0;
+      if (zmq_msg_size(&grant) != sizeof (credits)) {
+         LOG(WARNING) << "Received invalid credit grant of size: " << zmq_msg_size(&grant);
+         continue;
+      }
+      memcpy(&credits, zmq_msg_data(&grant), sizeof (credits));
+      const std::string name(reinterpret_cast<char*> (zmq_msg_data(&identity)), zmq_msg_size(&identity));
+      auto peer = mPeers.begin();
+      while (peer != mPeers.end() && peer->mIdentity != name) {
+         peer++;
+      }
+      if (peer == mPeers.end()) {
+         Peer newPeer;
+         newPeer.mIdentity = name;
+         newPeer.mCredits = 0;
+         newPeer.mBlocked = false;
+         peer = mPeers.insert(mPeers.end(), newPeer);
+      }
+      peer->mCredits += credits;
+   }
+   zmq_msg_close(&identity);
+   zmq_msg_close(&grant);
+}
+
+/**
+ * Send a message to the Vampire with the most credit, waiting for credit if
+ * none has any.
+ * 
+ * A Vampire whose pipe is full keeps its credit, it is only skipped until the
+ * next wait, so a stall never loses credit the Vampire still counts as given.
+ * @param message
+ *   An initialized message, on failure it is left for the caller to close
+ * @param waitToFire in milliseconds
+ * @return 
+ *   If the message was sent
+ */
+bool Rifle::SendCredited(zmq_msg_t& message, const int waitToFire) {
+   const auto deadline = std::chrono::steady_clock::now() +
+      std::chrono::milliseconds(waitToFire > 0 ? waitToFire : 0);
+   for (auto it = mPeers.begin(); it != mPeers.end(); it++) {
+      it->mBlocked = false;
+   }
+   for (;;) {
+      CollectCredits();
+      auto best = mPeers.end();
+      bool blocked = false;
+      for (auto it = mPeers.begin(); it != mPeers.end(); it++) {
+         if (it->mCredits <= 0) {
+            continue;
+         } else if (it->mBlocked) {
+            blocked = true;
+         } else if (best == mPeers.end() || it->mCredits > best->mCredits) {
+            best = it;
+         }
+      }
+      if (best != mPeers.end()) {
+         if (zmq_send(mChamber, best->mIdentity.data(), best->mIdentity.size(),
+            ZMQ_SNDMORE | ZMQ_DONTWAIT) >= 0) {
+            const size_t size = zmq_msg_size(&message);
+            if (zmq_msg_send(&message, mChamber, ZMQ_DONTWAIT) >= 0) {
+               best->mCredits--;
+               mStats.AddMessage(size);
+               return true;
+            }
+            LOG(WARNING) << "Error on Zmq socket send: " << zmq_strerror(zmq_errno());
+            mStats.AddSendError();
+            return false;
+         }
+         if (zmq_errno() == EHOSTUNREACH) {
+            // the Vampire went away with credit left
+            mPeers.erase(best);
+         } else {
+            best->mBlocked = true;
+         }
+         continue;
+      }
+      const long remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+         deadline - std::chrono::steady_clock::now()).count();
+      if (remaining <= 0) {
+         mStats.AddSendTimeout();
+         return false;
+      }
+      zmq_pollitem_t items [] = {
+         { mChamber, 0, ZMQ_POLLIN, 0}
+      };
+      const auto blockedSince = std::chrono::steady_clock::now();
+      // a full pipe doesn't wake the poll, so look again after a millisecond
+      const int pollResult = zmq_poll(items, 1, blocked ? std::min(remaining, 1L) : remaining);
+      mStats.AddBlockedSince(blockedSince);
+      if (pollResult < 0) {
+         mStats.AddPollError();
+         return false;
+      } else if (pollResult == 0 && !blocked) {
+         mStats.AddSendTimeout();
+         return false;
+      }
+      for (auto it = mPeers.begin(); it != mPeers.end(); it++) {
+         it->mBlocked = false;
+      }
+   }
+}
+
+/**
+ * Count a shot fired over inproc or shm. Those transports don't say why a 
+ * shot failed or how long they waited, a failure is always a full pipe.
+ * @param fired
+ * @param size
+ */
+void Rifle::CountShot(const bool fired, const size_t size) {
+   if (fired) {
+      mStats.AddMessage(size);
+   } else {
+      mStats.AddSendTimeout();
+   }
+}
+
+/**
+ * Copy the given memory into a message and send it, behind a time stamp if 
+ * latency tracking is set.
+ * @param data
+ * @param size
+ * @param waitToFire in milliseconds
+ * @return 
+ *   If the message was sent
+ */
+bool Rifle::SendCopy(const void* data, const size_t size, const int waitToFire) {
+   const size_t stampSize = mLatencyTracking ? LatencyHistogram::kStampSize : 0;
+   if (mInproc || mShm) {
+      const void* bullet = data;
+      if (stampSize) {
+         // inproc and shm copy in whatever they are given, so stage it first
+         mStampedBullet.resize(stampSize + size);
+         LatencyHistogram::Stamp(&mStampedBullet[0]);
+         memcpy(&mStampedBullet[stampSize], data, size);
+         bullet = mStampedBullet.data();
+      }
+      const bool fired = mInproc ? mInproc->FireCopy(bullet, stampSize + size, waitToFire) :
+         mShm->Fire(bullet, stampSize + size, waitToFire);
+      CountShot(fired, stampSize + size);
+      return fired;
+   }
+   zmq_msg_t message;
+   zmq_msg_init_size(&message, stampSize + size);
+   if (stampSize) {
+      LatencyHistogram::Stamp(zmq_msg_data(&message));
+   }
+   memcpy(static_cast<char*> (zmq_msg_data(&message)) + stampSize, data, size);
+   if (SendMessage(message, waitToFire)) {
+      return true;
+   }
+   zmq_msg_close(&message);
+   return false;
+}
+
+/**
+ * Send a bullet, compressing it first if that has been set.
+ * @param data
+ * @param size
+ * @param waitToFire in milliseconds
+ * @return 
+ */
+bool Rifle::SendBullet(const void* data, const size_t size, const int waitToFire) {
+   if (mCompressor && mChamber) {
+      mCompressor->Compress(data, size, mCompressedBullet);
+      return SendCopy(mCompressedBullet.data(), mCompressedBullet.size(), waitToFire);
+   }
+   return SendCopy(data, size, waitToFire);
+}
+
 /**
  * Shoot a buillet / message to the Vampires / pull.
  *
@@ -149,7 +528,7 @@ void Rifle::setIpcFilePermissions() {
  */
 bool Rifle::Fire(const std::string& bullet, const int waitToFire) {
    //LOG(DEBUG) << "RifleFire";
-   if (!mChamber) {
+   if (!IsAimed()) {
       LOG(WARNING) << "Socket uninitialized!";
       return false;
    }
@@ -157,27 +536,62 @@ bool Rifle::Fire(const std::string& bullet, const int waitToFire) {
       LOG(WARNING) << "Tried to send empty packet";
       return false;
    }
-   zmq_pollitem_t items [] = {
-      { mChamber, 0, ZMQ_POLLOUT, 0}
-   };
+   return SendBullet(&(bullet[0]), bullet.size(), waitToFire);
+}
 
-   if (zmq_poll(items, 1, waitToFire) > 0) {
-      if (items[0].revents & ZMQ_POLLOUT) {
-         zmsg_t* message = zmsg_new();
-         zmsg_addmem(message, &(bullet[0]), bullet.size());
-         return CZMQToolkit::SendExistingMessage(message, mChamber);
-      } else {
-         LOG(WARNING) << "Error on Zmq socket send: " << zmq_strerror(zmq_errno());
-         return false;
+/**
+ * Shoot a volley of bullets / messages to the Vampires / pull.
+ *
+ * The bullets are pushed back to back, we only wait if the pipe fills up 
+ * part way through the volley.
+ *
+ * @param bullets
+ *
+ * @param waitToFire in milliseconds, for the whole volley rather than each
+ * bullet, negative waits forever
+ *
+ * @return 
+ *   The number of bullets fired, counted from the front of the vector
+ */
+size_t Rifle::FireBatch(const std::vector<std::string>& bullets, const int waitToFire) {
+   if (!IsAimed()) {
+      LOG(WARNING) << "Socket uninitialized!";
+      return 0;
+   }
+   if (bullets.empty()) {
+      LOG(WARNING) << "Tried to send nothing";
+      return 0;
+   }
+   const auto deadline = std::chrono::steady_clock::now() +
+      std::chrono::milliseconds(waitToFire > 0 ? waitToFire : 0);
+   size_t fired = 0;
+   for (auto it = bullets.begin(); it != bullets.end(); it++) {
+      if (it->empty()) {
+         LOG(WARNING) << "Tried to send empty packet";
+         break;
       }
-   } else {
-      //      LOG(WARNING) << "timeout in zmq_pollout " << GetBinding();
-      return false;
+      int remaining = waitToFire;
+      if (waitToFire > 0) {
+         remaining = std::max(0, static_cast<int> (std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count()));
+      }
+      if (!SendBullet(&((*it)[0]), it->size(), remaining)) {
+         break;
+      }
+      fired++;
    }
+   return fired;
 }
 
 /**
  * Fire a string without copying it to zeromq. 
+ * 
+ * The FreeFunction is always called to release the string, straight away 
+ * if the shot can't be fired. Over inproc the string's buffer is swapped 
+ * into the pipe, the FreeFunction then releases the string which is left 
+ * holding a recycled buffer. Over shm the bullet is written into the ring 
+ * and the string released straight away, as it is when the bullet has to be
+ * compressed or stamped.
  * @param zero
  * @param size
  * @param FreeFunction
@@ -186,35 +600,28 @@ bool Rifle::Fire(const std::string& bullet, const int waitToFire) {
  */
 bool Rifle::FireZeroCopy(std::string* zero, const size_t size, void (*FreeFunction)(void*, void*), const int waitToFire) {
    bool success = false;
-   if (!mChamber) {
+   if (!IsAimed()) {
       LOG(WARNING) << "Socket uninitialized!";
+      FreeFunction(&((*zero)[0]), zero);
    } else if (size == 0) {
       LOG(WARNING) << "Tried to send empty packet";
+      FreeFunction(&((*zero)[0]), zero);
+   } else if (mInproc && !mLatencyTracking) {
+      zero->resize(size);
+      success = mInproc->Fire(*zero, waitToFire);
+      CountShot(success, size);
+      FreeFunction(&((*zero)[0]), zero);
+   } else if (!mChamber || mCompressor || mLatencyTracking) {
+      success = SendBullet(&((*zero)[0]), size, waitToFire);
+      FreeFunction(&((*zero)[0]), zero);
    } else {
-      zmq_pollitem_t items [] = {
-         { mChamber, 0, ZMQ_POLLOUT, 0}
-      };
-
-      if (zmq_poll(items, 1, waitToFire) > 0) {
-         if (items[0].revents & ZMQ_POLLOUT) {
-
-            zmq_msg_t message;
-            zmq_msg_init_data(&message, &((*zero)[0]), size, FreeFunction, zero);
-            if ((int) size == zmq_msg_send(&message, mChamber, ZMQ_DONTWAIT)) {
-               success = true;
-               zero = NULL;
-            }
-         } else {
-            LOG(WARNING) << "Error on Zmq socket send: " << zmq_strerror(zmq_errno());
-         }
-      } else {
-         //      LOG(WARNING) << "timeout in zmq_pollout " << GetBinding();
+      zmq_msg_t message;
+      zmq_msg_init_data(&message, &((*zero)[0]), size, FreeFunction, zero);
+      success = SendMessage(message, waitToFire);
+      if (!success) {
+         zmq_msg_close(&message);
       }
    }
-   if (!success && zero) {
-      delete zero;
-      zero = NULL;
-   }
    return success;
 }
 
@@ -224,7 +631,7 @@ bool Rifle::FireZeroCopy(std::string* zero, const size_t size, void (*FreeFuncti
  * @return 
  */
 bool Rifle::FireStake(const void* stake, const int waitToFire) {
-   if (!mChamber) {
+   if (!IsAimed()) {
       LOG(WARNING) << "Socket uninitialized!";
       return false;
    }
@@ -232,24 +639,7 @@ bool Rifle::FireStake(const void* stake, const int waitToFire) {
       LOG(WARNING) << "Tried to send empty packet";
       return false;
    }
-   zmq_pollitem_t items [] = {
-      { mChamber, 0, ZMQ_POLLOUT, 0}
-   };
-
-   if (zmq_poll(items, 1, waitToFire) > 0) {
-      if (items[0].revents & ZMQ_POLLOUT) {
-         zmsg_t* message = zmsg_new();
-         zmsg_addmem(message, &(stake), sizeof (void*));
-         return CZMQToolkit::SendExistingMessage(message, mChamber);
-      } else {
-
-         LOG(WARNING) << "Error in zmq_pollout in " << GetBinding() << ": " << zmq_strerror(zmq_errno());
-         return false;
-      }
-   } else {
-      //      LOG(WARNING) << "timeout in zmq_pollout " << GetBinding();
-      return false;
-   }
+   return SendCopy(&(stake), sizeof (void*), waitToFire);
 }
 
 /**
@@ -263,28 +653,48 @@ bool Rifle::FireStake(const void* stake, const int waitToFire) {
 bool Rifle::FireStakes(const std::vector<std::pair<void*, unsigned int> >
    & stakes, const int waitToFire) {
    bool success = false;
-   if (!mChamber) {
+   if (!IsAimed()) {
       LOG(WARNING) << "Socket uninitialized!";
    } else if (stakes.empty()) {
       LOG(WARNING) << "Tried to send nothing";
    } else {
-      zmq_pollitem_t items [] = {
-         { mChamber, 0, ZMQ_POLLOUT, 0}
-      };
+      success = SendCopy(&(stakes[0]),
+         stakes.size() * (sizeof (std::pair<void*, unsigned int>)), waitToFire);
+   }
+   return success;
+}
 
-      if (zmq_poll(items, 1, waitToFire) > 0) {
-         if (items[0].revents & ZMQ_POLLOUT) {
-            zmsg_t* message = zmsg_new();
-            zmsg_addmem(message, &(stakes[0]),
-               stakes.size() * (sizeof (std::pair<void*, unsigned int>)));
-            success = CZMQToolkit::SendExistingMessage(message, mChamber);
-         } else {
-            LOG(WARNING) << "Error in zmq_pollout in " << GetBinding() << ": " << zmq_strerror(zmq_errno());
-         }
-      } else {
-         //      LOG(WARNING) << "timeout in zmq_pollout " << GetBinding();
+/**
+ * Shoot a bundle of stakes to the Vampires / pull without copying it.
+ * 
+ * The bundle's memory is handed to zeromq as it is and the bundle goes back
+ * to the pool once zeromq is done with it. Vampires can take it with either
+ * GetStakes.
+ * @param bundle
+ *   Ownership is taken, it is recycled even if the shot fails
+ * @param waitToFire in milliseconds
+ * @return 
+ *   false if something went wrong
+ */
+bool Rifle::FireStakes(StakeBundle* bundle, const int waitToFire) {
+   bool success = false;
+   if (!IsAimed()) {
+      LOG(WARNING) << "Socket uninitialized!";
+   } else if (bundle == NULL || bundle->empty()) {
+      LOG(WARNING) << "Tried to send nothing";
+   } else if (mChamber && !mLatencyTracking) {
+      zmq_msg_t message;
+      zmq_msg_init_data(&message, bundle->data(), bundle->size() * sizeof (StakeBundle::Stake),
+         RecycleStakeBundle, bundle);
+      bundle = NULL;
+      success = SendMessage(message, waitToFire);
+      if (!success) {
+         zmq_msg_close(&message);
       }
+   } else {
+      success = SendCopy(bundle->data(), bundle->size() * sizeof (StakeBundle::Stake), waitToFire);
    }
+   StakeBundle::Recycle(bundle);
    return success;
 }
 
@@ -292,10 +702,13 @@ bool Rifle::FireStakes(const std::vector<std::pair<void*, unsigned int> >
  * Destroy the gun.
  */
 void Rifle::Destroy() {
+   InprocJunction::Instance().Detach(mLocation, mInproc);
+   mShm.reset();
+   mPeers.clear();
    if (mContext != NULL) {
       //LOG(DEBUG) << "Rifle: destroying context";
       zsocket_destroy(mContext, mChamber);
-      zctx_destroy(&mContext);
+      ContextRegistry::Instance().Release(mContext);
       //zclock_sleep(mLinger * 2);
       mChamber = NULL;
       mContext = NULL;
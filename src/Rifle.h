@@ -1,20 +1,29 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <memory>
+#include <zmq.h>
 #include "CZMQToolkit.h"
+#include "StakeBundle.h"
+#include "Compressor.h"
+#include "SocketStats.h"
+#include "LatencyHistogram.h"
 
-#define SIZE_OF_STAKE_BUNDLE 500
 struct _zctx_t;
 typedef struct _zctx_t zctx_t;
+class InprocEndpoint;
+class ShmRing;
 class Rifle {
 public:
    explicit Rifle(const std::string& location);
    bool Aim();
    std::string GetBinding() const;
    bool Fire(const std::string& bullet, const int waitToFire = 10000);
+   size_t FireBatch(const std::vector<std::string>& bullets, const int waitToFire = 10000);
    bool FireStake(const void* stake,const int waitToFire = 10000);
    bool FireStakes(const std::vector<std::pair<void*, unsigned int> >& stakes,
            const int waitToFire = 10000);
+   bool FireStakes(StakeBundle* bundle, const int waitToFire = 10000);
 
    bool FireZeroCopy( std::string* zero, const size_t size, void (*FreeFunction)(void*,void*), const int waitToFire = 10000);
    int GetHighWater();
@@ -23,10 +32,30 @@ public:
    void SetIOThreads(const int count);
    void SetOwnSocket(const bool own);
    bool GetOwnSocket();
+   void SetCompression(const bool compress, const size_t threshold = Compressor::kDefaultThreshold);
+   bool SetCompressionDictionary(const std::string& dictionary);
+   double GetCompressionRatio();
+   void SetCreditDispatch(const bool credit);
+   bool GetCreditDispatch();
+   SocketStats::Snapshot GetStats() const;
+   void SetLatencyTracking(const bool track);
+   bool GetLatencyTracking();
    virtual ~Rifle();
 protected:
    void Destroy();
+   bool IsAimed() const;
+   bool SendCopy(const void* data, const size_t size, const int waitToFire);
 private:
+   struct Peer {
+      std::string mIdentity;
+      int64_t mCredits;
+      bool mBlocked;
+   };
+   bool SendMessage(zmq_msg_t& message, const int waitToFire);
+   bool SendCredited(zmq_msg_t& message, const int waitToFire);
+   void CollectCredits();
+   void CountShot(const bool fired, const size_t size);
+   bool SendBullet(const void* data, const size_t size, const int waitToFire);
    void setIpcFilePermissions();
    std::string mLocation;
    int mHwm;
@@ -35,4 +64,13 @@ private:
    int mLinger;
    int mIOThredCount;
    bool mOwnSocket;
+   std::shared_ptr<InprocEndpoint> mInproc;
+   std::unique_ptr<ShmRing> mShm;
+   std::unique_ptr<Compressor> mCompressor;
+   std::string mCompressedBullet;
+   bool mCreditDispatch;
+   std::vector<Peer> mPeers;
+   SocketStats mStats;
+   bool mLatencyTracking;
+   std::string mStampedBullet;
 };
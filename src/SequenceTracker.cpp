@@ -0,0 +1,88 @@
+#include "SequenceTracker.h"
+#include "SocketStats.h"
+
+SequenceTracker::SequenceTracker() : mSequenced(0), mTopics(0), mGaps(0),
+mDropped(0), mReordered(0), mDuplicates(0), mRestarts(0) {
+}
+
+/**
+ * Write a sequence number as a frame, most significant byte first.
+ * @param sequence
+ * @param frame
+ *   At least kSequenceSize bytes
+ */
+void SequenceTracker::Encode(const uint64_t sequence, char* frame) {
+   for (size_t i = 0; i < kSequenceSize; i++) {
+      frame[i] = static_cast<char> (sequence >> (8 * (kSequenceSize - 1 - i)));
+   }
+}
+
+/**
+ * Read a sequence number written by Encode.
+ * @param frame
+ * @param size
+ * @param sequence
+ * @return 
+ *   false if the frame is the wrong size
+ */
+bool SequenceTracker::Decode(const void* frame, const size_t size, uint64_t& sequence) {
+   if (size != kSequenceSize) {
+      return false;
+   }
+   const unsigned char* bytes = static_cast<const unsigned char*> (frame);
+   sequence = 0;
+   for (size_t i = 0; i < kSequenceSize; i++) {
+      sequence = (sequence << 8) | bytes[i];
+   }
+   return true;
+}
+
+/**
+ * Account for a shot at a topic.
+ * @param topic
+ * @param topicSize
+ * @param sequence
+ */
+void SequenceTracker::Track(const char* topic, const size_t topicSize, const uint64_t sequence) {
+   SocketStats::Bump(mSequenced, 1);
+   mTopic.assign(topic, topicSize);
+   auto found = mLast.find(mTopic);
+   if (found == mLast.end()) {
+      mLast.insert(std::make_pair(mTopic, sequence));
+      SocketStats::Bump(mTopics, 1);
+      return;
+   }
+   uint64_t& last = found->second;
+   if (sequence == last + 1) {
+      last = sequence;
+   } else if (sequence > last) {
+      SocketStats::Bump(mGaps, 1);
+      SocketStats::Bump(mDropped, sequence - last - 1);
+      last = sequence;
+   } else if (sequence == last) {
+      SocketStats::Bump(mDuplicates, 1);
+   } else if (sequence == 1) {
+      // a Shotgun starts every topic at 1, it has been restarted
+      SocketStats::Bump(mRestarts, 1);
+      last = sequence;
+   } else {
+      // counted as dropped when the gap it left was seen
+      SocketStats::Bump(mReordered, 1);
+   }
+}
+
+/**
+ * @return 
+ *   The counts so far, safe to call from any thread
+ */
+SequenceTracker::Snapshot SequenceTracker::GetSnapshot() const {
+   Snapshot snapshot;
+   snapshot.mSequenced = mSequenced.load(std::memory_order_relaxed);
+   snapshot.mTopics = mTopics.load(std::memory_order_relaxed);
+   snapshot.mGaps = mGaps.load(std::memory_order_relaxed);
+   snapshot.mDropped = mDropped.load(std::memory_order_relaxed);
+   snapshot.mReordered = mReordered.load(std::memory_order_relaxed);
+   snapshot.mDuplicates = mDuplicates.load(std::memory_order_relaxed);
+   snapshot.mRestarts = mRestarts.load(std::memory_order_relaxed);
+   return snapshot;
+}
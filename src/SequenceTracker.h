@@ -0,0 +1,53 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <unordered_map>
+
+/**
+ * Follows the per topic sequence numbers a Shotgun stamps on its shots and
+ * counts what went missing on the way.
+ * 
+ * The first shot seen at a topic starts it, so an Alien joining late isn't 
+ * charged for what was fired before it subscribed. After that a jump ahead
+ * is a gap and the numbers skipped over are dropped, a number seen again is
+ * a duplicate (a shot in flight repeated by a last value snapshot) and 
+ * anything older is reordered. A topic going back to 1 is a restarted 
+ * Shotgun and starts the topic over, rather than being reordered forever.
+ * One thread tracks, any thread can take a Snapshot.
+ */
+class SequenceTracker {
+public:
+   static const size_t kSequenceSize = sizeof (uint64_t);
+
+   struct Snapshot {
+      uint64_t mSequenced;
+      uint64_t mTopics;
+      uint64_t mGaps;
+      uint64_t mDropped;
+      uint64_t mReordered;
+      uint64_t mDuplicates;
+      uint64_t mRestarts;
+   };
+
+   SequenceTracker();
+
+   static void Encode(const uint64_t sequence, char* frame);
+   static bool Decode(const void* frame, const size_t size, uint64_t& sequence);
+   void Track(const char* topic, const size_t topicSize, const uint64_t sequence);
+   Snapshot GetSnapshot() const;
+private:
+   SequenceTracker(const SequenceTracker&) = delete;
+   SequenceTracker& operator=(const SequenceTracker&) = delete;
+
+   std::unordered_map<std::string, uint64_t> mLast;
+   std::string mTopic;
+   std::atomic<uint64_t> mSequenced;
+   std::atomic<uint64_t> mTopics;
+   std::atomic<uint64_t> mGaps;
+   std::atomic<uint64_t> mDropped;
+   std::atomic<uint64_t> mReordered;
+   std::atomic<uint64_t> mDuplicates;
+   std::atomic<uint64_t> mRestarts;
+};
@@ -0,0 +1,463 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <new>
+
+#include "ShmRing.h"
+#include "Doorbell.h"
+#include "g2log.hpp"
+
+namespace {
+   const uint64_t kMagic = 0x51756575654e6164ULL; // "QueueNad"
+   const uint32_t kWrapMarker = 0xFFFFFFFF;
+   const size_t kRecordHeaderBytes = 8;
+   const int kSpinsBeforeParking = 64;
+   // how often a waiting end looks for a replaced file, in milliseconds
+   const int kReplacedCheck = 100;
+   const int kOpenTries = 10;
+
+   size_t RecordBytes(const size_t size) {
+      return kRecordHeaderBytes + ((size + 7) & ~static_cast<size_t> (7));
+   }
+
+   /**
+    * Lock a process shared mutex, recovering it if its last owner died.
+    */
+   bool LockShared(pthread_mutex_t* mutex) {
+      const int result = pthread_mutex_lock(mutex);
+      if (result == EOWNERDEAD) {
+         LOG(WARNING) << "Recovering shm ring lock from a dead process";
+         pthread_mutex_consistent(mutex);
+         return true;
+      }
+      return (result == 0);
+   }
+
+   void InitShared(pthread_mutex_t* mutex) {
+      pthread_mutexattr_t attributes;
+      pthread_mutexattr_init(&attributes);
+      pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+      pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+      pthread_mutex_init(mutex, &attributes);
+      pthread_mutexattr_destroy(&attributes);
+   }
+
+   int Remaining(const std::chrono::steady_clock::time_point& deadline) {
+      const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+         deadline - std::chrono::steady_clock::now()).count();
+      return (left > 0) ? static_cast<int> (left) : 0;
+   }
+}
+
+/**
+ * The start of the mapped file, the records follow it. Producer and consumer
+ * fields are kept on separate cache lines.
+ */
+struct ShmRing::Header {
+   uint64_t mMagic;
+   uint64_t mBytes;
+   std::atomic<uint32_t> mRifleHwm;
+   std::atomic<uint32_t> mVampireHwm;
+
+   alignas(64) std::atomic<uint64_t> mTail;
+   std::atomic<uint64_t> mFired;
+   pthread_mutex_t mRifleLock;
+   alignas(64) Doorbell mRoom;
+
+   alignas(64) std::atomic<uint64_t> mHead;
+   std::atomic<uint64_t> mFed;
+   pthread_mutex_t mVampireLock;
+   alignas(64) Doorbell mShots;
+
+   Header() : mMagic(0), mBytes(0), mRifleHwm(0), mVampireHwm(0), mTail(0),
+   mFired(0), mRoom(true), mHead(0), mFed(0), mShots(true) {
+      InitShared(&mRifleLock);
+      InitShared(&mVampireLock);
+   }
+};
+
+/**
+ * @param location
+ * @return 
+ *   If the location is a shm:// one
+ */
+bool ShmRing::IsShm(const std::string& location) {
+   return (location.compare(0, 6, "shm://") == 0);
+}
+
+/**
+ * @param location
+ *   shm://name
+ * @return 
+ *   /dev/shm/name
+ */
+std::string ShmRing::GetShmFile(const std::string& location) {
+   return std::string("/dev/shm/") + location.substr(6);
+}
+
+/**
+ * Remove the file behind a shm location, registered with Death the same way
+ * ipc files are.
+ * @param location
+ */
+void ShmRing::DeleteShmFiles(const std::string& location) {
+   if (IsShm(location)) {
+      unlink(GetShmFile(location).c_str());
+   }
+}
+
+/**
+ * Construct a ring end, nothing is mapped until Open.
+ * @param location
+ * @param isRifle
+ * @param own
+ *   The owner removes the file when it is done with it
+ * @param hwm
+ */
+ShmRing::ShmRing(const std::string& location, const bool isRifle, const bool own,
+   const int hwm) : mLocation(location),
+mFile(GetShmFile(location)),
+mIsRifle(isRifle),
+mOwn(own),
+mHwm(hwm),
+mHeader(NULL),
+mRecords(NULL),
+mMappedBytes(0),
+mFedBytes(0),
+mDevice(0),
+mInode(0) {
+}
+
+/**
+ * Unmap the ring, the owner also removes the file unless it has already 
+ * been replaced by a new owner.
+ */
+ShmRing::~ShmRing() {
+   if (mFedBytes) {
+      Digest();
+   }
+   if (mHeader) {
+      munmap(mHeader, mMappedBytes);
+      struct stat status;
+      if (mOwn && stat(mFile.c_str(), &status) == 0 &&
+         static_cast<uint64_t> (status.st_dev) == mDevice && static_cast<uint64_t> (status.st_ino) == mInode) {
+         unlink(mFile.c_str());
+      }
+   }
+}
+
+/**
+ * Open and lock the file at the location, creating it if there is none. A
+ * file that was unlinked between the open and the lock is not the ring any
+ * more, and is opened again.
+ * @return 
+ *   The locked descriptor, -1 on failure
+ */
+int ShmRing::OpenFile() {
+   for (int tries = 0; tries < kOpenTries; tries++) {
+      const int fd = open(mFile.c_str(), O_RDWR | O_CREAT, 0777);
+      if (fd < 0) {
+         LOG(WARNING) << "Can't open " << mFile << ": " << strerror(errno);
+         return -1;
+      }
+      flock(fd, LOCK_EX);
+      struct stat opened;
+      struct stat onDisk;
+      if (fstat(fd, &opened) == 0 && stat(mFile.c_str(), &onDisk) == 0 &&
+         opened.st_dev == onDisk.st_dev && opened.st_ino == onDisk.st_ino) {
+         return fd;
+      }
+      flock(fd, LOCK_UN);
+      close(fd);
+   }
+   LOG(WARNING) << "Can't open " << mFile << ", it keeps being replaced";
+   return -1;
+}
+
+/**
+ * Map the ring, creating it if we are the first to the location. The owner
+ * always creates a fresh one, the file of an earlier owner is unlinked.
+ * @return 
+ */
+bool ShmRing::Open() {
+   if (mHeader) {
+      return true;
+   }
+   if (mLocation.size() <= 6 || mLocation.find('/', 6) != std::string::npos) {
+      LOG(WARNING) << "Invalid shm location: " << mLocation;
+      return false;
+   }
+   if (mOwn) {
+      // whatever a crashed owner left behind is thrown away, under its lock 
+      // so nobody is half way through mapping it
+      const int old = open(mFile.c_str(), O_RDWR);
+      if (old >= 0) {
+         flock(old, LOCK_EX);
+         unlink(mFile.c_str());
+         flock(old, LOCK_UN);
+         close(old);
+      }
+   }
+   const int fd = OpenFile();
+   if (fd < 0) {
+      return false;
+   }
+   fchmod(fd, 0777);
+   // the first to take the lock initializes the ring
+   bool success = false;
+   struct stat status;
+   const size_t bytes = sizeof (Header) + kRingBytes;
+   if (fstat(fd, &status) == 0 && (status.st_size == 0 || static_cast<size_t> (status.st_size) == bytes)) {
+      const bool create = (status.st_size == 0);
+      if (!create || ftruncate(fd, bytes) == 0) {
+         void* mapped = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+         if (mapped != MAP_FAILED) {
+            mMappedBytes = bytes;
+            mHeader = create ? new (mapped) Header : reinterpret_cast<Header*> (mapped);
+            mRecords = reinterpret_cast<char*> (mapped) + sizeof (Header);
+            if (create) {
+               mHeader->mBytes = kRingBytes;
+               mHeader->mMagic = kMagic;
+            }
+            success = (mHeader->mMagic == kMagic && mHeader->mBytes == kRingBytes);
+         }
+      }
+   }
+   if (success) {
+      mDevice = status.st_dev;
+      mInode = status.st_ino;
+      mNextCheck = std::chrono::steady_clock::now() + std::chrono::milliseconds(kReplacedCheck);
+      std::atomic<uint32_t>& hwm = mIsRifle ? mHeader->mRifleHwm : mHeader->mVampireHwm;
+      uint32_t current = hwm.load();
+      while (current < static_cast<uint32_t> (mHwm) && !hwm.compare_exchange_weak(current, mHwm)) {
+      }
+   } else {
+      LOG(WARNING) << "Can't map shm ring " << mFile;
+      if (mHeader) {
+         munmap(mHeader, mMappedBytes);
+         mHeader = NULL;
+         mRecords = NULL;
+      }
+   }
+   flock(fd, LOCK_UN);
+   close(fd);
+   return success;
+}
+
+/**
+ * Map the new ring if the file has been replaced by a restarted owner, at 
+ * most every kReplacedCheck milliseconds. The old ring is only unmapped 
+ * between bullets.
+ */
+void ShmRing::FollowReplacement() {
+   const auto now = std::chrono::steady_clock::now();
+   if (mOwn || mFedBytes || now < mNextCheck) {
+      return;
+   }
+   mNextCheck = now + std::chrono::milliseconds(kReplacedCheck);
+   struct stat status;
+   if (stat(mFile.c_str(), &status) != 0 ||
+      (static_cast<uint64_t> (status.st_dev) == mDevice && static_cast<uint64_t> (status.st_ino) == mInode)) {
+      return;
+   }
+   LOG(WARNING) << "Shm ring " << mFile << " was replaced, mapping the new one";
+   Header* old = mHeader;
+   char* oldRecords = mRecords;
+   const size_t oldBytes = mMappedBytes;
+   mHeader = NULL;
+   if (!Open()) {
+      // keep the old ring and try again on the next check
+      mHeader = old;
+      mRecords = oldRecords;
+      mMappedBytes = oldBytes;
+      return;
+   }
+   munmap(old, oldBytes);
+}
+
+/**
+ * Write one record, wrapping to the start of the ring if it doesn't fit 
+ * before the end.
+ * @param data
+ * @param size
+ * @return 
+ *   false if the ring is at its high water mark or out of room
+ */
+bool ShmRing::TryFire(const void* data, const size_t size) {
+   if (!LockShared(&mHeader->mRifleLock)) {
+      return false;
+   }
+   bool fired = false;
+   const uint64_t mask = mHeader->mBytes - 1;
+   const uint64_t hwm = mHeader->mRifleHwm.load(std::memory_order_relaxed) +
+      mHeader->mVampireHwm.load(std::memory_order_relaxed);
+   const uint64_t queued = mHeader->mFired.load(std::memory_order_relaxed) -
+      mHeader->mFed.load(std::memory_order_acquire);
+   if (queued < hwm) {
+      uint64_t tail = mHeader->mTail.load(std::memory_order_relaxed);
+      const uint64_t head = mHeader->mHead.load(std::memory_order_acquire);
+      const size_t record = RecordBytes(size);
+      const size_t untilEnd = mHeader->mBytes - (tail & mask);
+      const size_t needed = (record > untilEnd) ? untilEnd + record : record;
+      if (tail + needed - head <= mHeader->mBytes) {
+         if (record > untilEnd) {
+            *reinterpret_cast<uint32_t*> (mRecords + (tail & mask)) = kWrapMarker;
+            tail += untilEnd;
+         }
+         char* slot = mRecords + (tail & mask);
+         *reinterpret_cast<uint32_t*> (slot) = static_cast<uint32_t> (size);
+         memcpy(slot + kRecordHeaderBytes, data, size);
+         mHeader->mFired.fetch_add(1, std::memory_order_relaxed);
+         mHeader->mTail.store(tail + record, std::memory_order_release);
+         fired = true;
+      }
+   }
+   pthread_mutex_unlock(&mHeader->mRifleLock);
+   if (fired) {
+      mHeader->mShots.Ring();
+   }
+   return fired;
+}
+
+/**
+ * Write a bullet into the ring, parking until there is room.
+ * @param data
+ * @param size
+ * @param waitToFire
+ *   In milliseconds, negative waits forever
+ * @return 
+ *   If the bullet was queued
+ */
+bool ShmRing::Fire(const void* data, const size_t size, const int waitToFire) {
+   if (!mHeader) {
+      return false;
+   }
+   if (RecordBytes(size) > mHeader->mBytes / 2) {
+      LOG(WARNING) << "Bullet of " << size << " bytes is too big for " << mLocation;
+      return false;
+   }
+   const auto deadline = std::chrono::steady_clock::now() +
+      std::chrono::milliseconds(waitToFire > 0 ? waitToFire : 0);
+   for (int spin = 0;; spin++) {
+      if (TryFire(data, size)) {
+         return true;
+      }
+      if (waitToFire == 0) {
+         return false;
+      }
+      if (spin < kSpinsBeforeParking) {
+         continue;
+      }
+      const uint32_t ticket = mHeader->mRoom.Arm();
+      if (TryFire(data, size)) {
+         mHeader->mRoom.Disarm();
+         return true;
+      }
+      const int remaining = (waitToFire < 0) ? -1 : Remaining(deadline);
+      if (remaining == 0) {
+         mHeader->mRoom.Disarm();
+         return false;
+      }
+      mHeader->mRoom.Wait(ticket, remaining);
+   }
+}
+
+/**
+ * Find the oldest record, on success the Vampire lock stays held until 
+ * Digest.
+ * @param data
+ * @param size
+ * @return 
+ */
+bool ShmRing::TryFeed(const char*& data, size_t& size) {
+   if (!LockShared(&mHeader->mVampireLock)) {
+      return false;
+   }
+   const uint64_t mask = mHeader->mBytes - 1;
+   uint64_t head = mHeader->mHead.load(std::memory_order_relaxed);
+   const uint64_t tail = mHeader->mTail.load(std::memory_order_acquire);
+   if (head != tail) {
+      const char* slot = mRecords + (head & mask);
+      uint32_t length = *reinterpret_cast<const uint32_t*> (slot);
+      if (length == kWrapMarker) {
+         // the record the marker belongs to is published with it
+         head += mHeader->mBytes - (head & mask);
+         mHeader->mHead.store(head, std::memory_order_release);
+         slot = mRecords + (head & mask);
+         length = *reinterpret_cast<const uint32_t*> (slot);
+      }
+      data = slot + kRecordHeaderBytes;
+      size = length;
+      mFedBytes = RecordBytes(length);
+      return true;
+   }
+   pthread_mutex_unlock(&mHeader->mVampireLock);
+   return false;
+}
+
+/**
+ * Get the oldest bullet in the ring, read in place. Digest must be called
+ * once the bullet has been used.
+ * @param timeout
+ *   In milliseconds, negative waits forever
+ * @param data
+ *   Points into the ring until Digest
+ * @param size
+ * @return 
+ *   If a bullet was found
+ */
+bool ShmRing::Feed(const int timeout, const char*& data, size_t& size) {
+   if (!mHeader) {
+      return false;
+   }
+   const auto deadline = std::chrono::steady_clock::now() +
+      std::chrono::milliseconds(timeout > 0 ? timeout : 0);
+   for (int spin = 0;; spin++) {
+      if (TryFeed(data, size)) {
+         return true;
+      }
+      if (timeout == 0) {
+         FollowReplacement();
+         return false;
+      }
+      if (spin < kSpinsBeforeParking) {
+         continue;
+      }
+      const uint32_t ticket = mHeader->mShots.Arm();
+      if (TryFeed(data, size)) {
+         mHeader->mShots.Disarm();
+         return true;
+      }
+      const int remaining = (timeout < 0) ? -1 : Remaining(deadline);
+      if (remaining == 0) {
+         mHeader->mShots.Disarm();
+         FollowReplacement();
+         return false;
+      }
+      // wake up now and then to see if the Rifle has restarted
+      mHeader->mShots.Wait(ticket, (remaining < 0 || remaining > kReplacedCheck) ? kReplacedCheck : remaining);
+      FollowReplacement();
+   }
+}
+
+/**
+ * Give the record returned by Feed back to the Rifles.
+ */
+void ShmRing::Digest() {
+   if (!mFedBytes) {
+      return;
+   }
+   const uint64_t head = mHeader->mHead.load(std::memory_order_relaxed);
+   mHeader->mHead.store(head + mFedBytes, std::memory_order_release);
+   mHeader->mFed.fetch_add(1, std::memory_order_release);
+   mFedBytes = 0;
+   pthread_mutex_unlock(&mHeader->mVampireLock);
+   mHeader->mRoom.Ring();
+}
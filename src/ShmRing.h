@@ -0,0 +1,61 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <chrono>
+#include <string>
+
+/**
+ * A ring of variable length records in /dev/shm, shared by the Rifles and 
+ * Vampires of a shm://name location running in different processes on the 
+ * same host.
+ * 
+ * A Rifle writes each bullet into the mapped ring exactly once and a Vampire
+ * reads it in place, there is no kernel round trip as there is with ipc. 
+ * Parked ends are woken with futexes that live in the ring. As with zeromq 
+ * the high water marks of the Rifle and the Vampire added together bound the
+ * number of bullets queued. Rifles share the ring under one process shared
+ * lock and Vampires under another, so any number of each can attach. 
+ * Bullets fired before any Vampire attaches wait in the ring for one.
+ * 
+ * The owner always starts a fresh ring, replacing any file left behind by a
+ * crash. The other ends notice a replaced file while they wait for bullets
+ * and map the new one, so a Vampire follows a restarted Rifle.
+ */
+class ShmRing {
+public:
+   static const size_t kRingBytes = 32 * 1024 * 1024;
+
+   static bool IsShm(const std::string& location);
+   static std::string GetShmFile(const std::string& location);
+   static void DeleteShmFiles(const std::string& location);
+
+   ShmRing(const std::string& location, const bool isRifle, const bool own, const int hwm);
+   ~ShmRing();
+
+   bool Open();
+   bool Fire(const void* data, const size_t size, const int waitToFire);
+   bool Feed(const int timeout, const char*& data, size_t& size);
+   void Digest();
+private:
+   struct Header;
+   ShmRing(const ShmRing&) = delete;
+   ShmRing& operator=(const ShmRing&) = delete;
+
+   int OpenFile();
+   void FollowReplacement();
+   bool TryFire(const void* data, const size_t size);
+   bool TryFeed(const char*& data, size_t& size);
+
+   const std::string mLocation;
+   const std::string mFile;
+   const bool mIsRifle;
+   const bool mOwn;
+   const int mHwm;
+   Header* mHeader;
+   char* mRecords;
+   size_t mMappedBytes;
+   size_t mFedBytes;
+   uint64_t mDevice;
+   uint64_t mInode;
+   std::chrono::steady_clock::time_point mNextCheck;
+};
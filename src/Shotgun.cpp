@@ -5,15 +5,156 @@
 #include "g2log.hpp"
 #include "czmq.h"
 #include "Death.h"
+#include "ContextRegistry.h"
+#include "SequenceTracker.h"
+#include "CZMQToolkit.h"
+
+namespace {
+   // how often the snapshot thread looks to see if it should stop
+   const int kSnapshotPoll = 100;
+}
+
 /**
  * Shotgun class is a ZeroMQ Publisher.
  */
-Shotgun::Shotgun() {
-   mCtx = zctx_new();
+Shotgun::Shotgun() : mCaching(false), mSnapshots(NULL), mServing(false), mSequencing(false),
+mMidShot(false), mJammed(false) {
+   mCtx = ContextRegistry::Instance().Acquire(1);
    assert(mCtx);
    mGun = zsocket_new(mCtx, ZMQ_PUB);
 }
 
+/**
+ * Keep the last shot fired at each topic and serve it to late Aliens as a 
+ * snapshot, the Clone pattern. 
+ * 
+ * A ROUTER bound at the snapshot location is answered by a thread of its 
+ * own, so a new Alien gets its snapshot straight away whether or not 
+ * anything is being fired, and only the Alien that asked gets it. Aliens 
+ * ask with Alien::GetSnapshot. Each topic's last value goes out with its 
+ * sequence number, 0 if the Shotgun isn't sequencing.
+ * @param snapshotLocation
+ *   Where Aliens ask for snapshots, not where the Shotgun is aimed
+ * @return 
+ *   false if the snapshot location can't be bound, or the cache is already
+ * on
+ */
+bool Shotgun::SetLastValueCache(const std::string& snapshotLocation) {
+   if (mCaching) {
+      LOG(WARNING) << "Shotgun already serves snapshots";
+      return false;
+   }
+   mSnapshots = zsocket_new(mCtx, ZMQ_ROUTER);
+   if (!mSnapshots || zsocket_bind(mSnapshots, snapshotLocation.c_str()) == -1) {
+      LOG(WARNING) << "Shotgun can't serve snapshots at " << snapshotLocation << ": " 
+         << zmq_strerror(zmq_errno());
+      if (mSnapshots) {
+         zsocket_destroy(mCtx, mSnapshots);
+         mSnapshots = NULL;
+      }
+      return false;
+   }
+   setIpcFilePermissions(snapshotLocation);
+   Death::Instance().RegisterDeathEvent(&Death::DeleteIpcFiles, snapshotLocation);
+   mCaching = true;
+   mServing = true;
+   mSnapshotServer = std::thread(&Shotgun::ServeSnapshots, this);
+   return true;
+}
+
+/**
+ * @return 
+ *   If the last shot at each topic is kept for new subscribers
+ */
+bool Shotgun::GetLastValueCache() const {
+   return mCaching;
+}
+
+/**
+ * The snapshot thread, answers requests until the Shotgun is destroyed. A 
+ * request is the Alien's identity then the prefix it wants.
+ */
+void Shotgun::ServeSnapshots() {
+   zmq_msg_t identity;
+   zmq_msg_t request;
+   zmq_msg_init(&identity);
+   zmq_msg_init(&request);
+   while (mServing) {
+      if (CZMQToolkit::PollIn(mSnapshots, kSnapshotPoll) <= 0 ||
+         zmq_msg_recv(&identity, mSnapshots, ZMQ_DONTWAIT) < 0) {
+         continue;
+      }
+      if (!zmq_msg_more(&identity) || zmq_msg_recv(&request, mSnapshots, 0) < 0) {
+         continue;
+      }
+      const std::string prefix(static_cast<const char*> (zmq_msg_data(&request)), zmq_msg_size(&request));
+      while (zmq_msg_more(&request) && zmq_msg_recv(&request, mSnapshots, 0) >= 0) {
+      }
+      SendSnapshot(std::string(static_cast<const char*> (zmq_msg_data(&identity)),
+         zmq_msg_size(&identity)), prefix);
+   }
+   zmq_msg_close(&identity);
+   zmq_msg_close(&request);
+}
+
+/**
+ * Send the last value of every topic starting with the prefix, each as 
+ * [identity][topic][sequence][bullets...], then [identity][empty frame] to 
+ * say the snapshot is complete. The values are copied out under the lock so
+ * Fire isn't held up while they are sent.
+ * @param identity
+ *   Of the Alien that asked
+ * @param prefix
+ * @return 
+ *   If the whole snapshot was sent
+ */
+bool Shotgun::SendSnapshot(const std::string& identity, const std::string& prefix) {
+   std::vector<std::pair<std::string, LastValue> > values;
+   {
+      std::lock_guard<std::mutex> lock(mLastValuesMutex);
+      for (auto it = mLastValues.lower_bound(prefix);
+         it != mLastValues.end() && it->first.compare(0, prefix.size(), prefix) == 0; it++) {
+         values.push_back(*it);
+      }
+   }
+   char frame[SequenceTracker::kSequenceSize];
+   for (auto it = values.begin(); it != values.end(); it++) {
+      const std::vector<std::string>& bullets = it->second.mBullets;
+      SequenceTracker::Encode(it->second.mSequence, frame);
+      bool sent = zmq_send(mSnapshots, identity.data(), identity.size(), ZMQ_SNDMORE) >= 0 &&
+         zmq_send(mSnapshots, it->first.data(), it->first.size(), ZMQ_SNDMORE) >= 0 &&
+         zmq_send(mSnapshots, frame, sizeof (frame), bullets.empty() ? 0 : ZMQ_SNDMORE) >= 0;
+      for (auto bullet = bullets.begin(); bullet != bullets.end() && sent; bullet++) {
+         sent = zmq_send(mSnapshots, bullet->data(), bullet->size(),
+            (bullet + 1 == bullets.end()) ? 0 : ZMQ_SNDMORE) >= 0;
+      }
+      if (!sent) {
+         LOG(WARNING) << "Shotgun could not send a snapshot: " << zmq_strerror(zmq_errno());
+         return false;
+      }
+   }
+   return zmq_send(mSnapshots, identity.data(), identity.size(), ZMQ_SNDMORE) >= 0 &&
+      zmq_send(mSnapshots, NULL, 0, 0) >= 0;
+}
+
+/**
+ * Stamp every shot with a sequence number, counting up from 1 per topic, in
+ * a frame after the topic. Aliens must SetSequencing to match, they use the
+ * numbers to count what they missed.
+ * @param sequence
+ */
+void Shotgun::SetSequencing(const bool sequence) {
+   mSequencing = sequence;
+}
+
+/**
+ * @return 
+ *   If shots are stamped with sequence numbers
+ */
+bool Shotgun::GetSequencing() const {
+   return mSequencing;
+}
+
 /**
  * Where to fire our messages.
  * @param location
@@ -53,14 +194,23 @@ void Shotgun::setIpcFilePermissions(const std::string& location) {
 }
 
 /**
- * Fire our shotgun, hopefully we hit something.
+ * Fire our shotgun, hopefully we hit something. The bullet follows an empty
+ * topic and a "dummy" frame as it always has, sent straight from the string.
  * @param msg
  */
 void Shotgun::Fire(const std::string& bullet) {
-   std::vector<std::string> bullets;
-   bullets.push_back("dummy");
-   bullets.push_back(bullet);
-   Fire(bullets);
+   static const char kDummy[] = "dummy";
+   const uint64_t sequence = NextSequence(std::string());
+   if (mCaching) {
+      std::vector<std::string> last(2);
+      last[0].assign(kDummy, sizeof (kDummy) - 1);
+      last[1].assign(bullet);
+      Remember(std::string(), sequence, last);
+   }
+   const bool sent = SendTopic(std::string(), sequence, true) &&
+      SendFrame(kDummy, sizeof (kDummy) - 1, true) &&
+      SendFrame(bullet.data(), bullet.size(), false);
+   CountShot(sent, sizeof (kDummy) - 1 + bullet.size());
 }
 
 /**
@@ -68,28 +218,237 @@ void Shotgun::Fire(const std::string& bullet) {
  * @param msg
  */
 void Shotgun::Fire(const std::vector<std::string>& bullets) {
-   zframe_t* key = zframe_new("key", 0);
+   // an empty topic, only Aliens subscribed to everything are hit
+   Fire(std::string(), bullets);
+}
 
-   zmsg_t* msg = zmsg_new();
-   zmsg_add(msg, key);
-   for (auto it = bullets.begin(); it != bullets.end(); it ++) {
-      zframe_t* body = zframe_new(it->c_str(), it->size());
-      zmsg_add(msg, body);
+/**
+ * Fire our shotgun at the Aliens subscribed to a prefix of the topic. 
+ * 
+ * Subscriptions are forwarded to the publisher, so over tcp and ipc shots
+ * nobody subscribed to are dropped here rather than sent and discarded.
+ * @param topic
+ *   Sent as the first frame, matched against each Alien's subscriptions
+ * @param bullets
+ */
+void Shotgun::Fire(const std::string& topic, const std::vector<std::string>& bullets) {
+   const uint64_t sequence = NextSequence(topic);
+   if (mCaching) {
+      Remember(topic, sequence, bullets);
    }
+   size_t bytes = 0;
+   const bool sent = Send(topic, sequence, bullets, bytes);
+   CountShot(sent, bytes);
+}
 
-   if (zmsg_send(&msg, mGun) != 0) {
-      LOG(WARNING) << "could not send message";
+/**
+ * Send a topic and its bullets.
+ * @param topic
+ * @param sequence
+ *   From NextSequence
+ * @param bullets
+ * @param bytes
+ *   Increased by the size of the bullets
+ * @return 
+ *   If it was sent
+ */
+bool Shotgun::Send(const std::string& topic, const uint64_t sequence,
+   const std::vector<std::string>& bullets, size_t& bytes) {
+   bool sent = SendTopic(topic, sequence, !bullets.empty());
+   for (auto it = bullets.begin(); it != bullets.end() && sent; it++) {
+      sent = SendFrame(it->data(), it->size(), it + 1 != bullets.end());
+      bytes += it->size();
+   }
+   return sent;
+}
+
+/**
+ * @param topic
+ * @return 
+ *   The sequence number of the next shot at the topic, 0 when not 
+ * sequencing
+ */
+uint64_t Shotgun::NextSequence(const std::string& topic) {
+   return mSequencing ? ++mSequences[topic] : 0;
+}
+
+/**
+ * Send the topic frame, followed by the topic's sequence number when 
+ * sequencing, so even a shot without bullets is counted by the Aliens.
+ * @param topic
+ * @param sequence
+ *   From NextSequence
+ * @param more
+ *   If bullets follow
+ * @return 
+ *   If it was sent
+ */
+bool Shotgun::SendTopic(const std::string& topic, const uint64_t sequence, const bool more) {
+   if (!SendFrame(topic.data(), topic.size(), more || mSequencing)) {
+      return false;
+   }
+   if (!mSequencing) {
+      return true;
    }
-   if (msg) {
-      zmsg_destroy(&msg);
+   char frame[SequenceTracker::kSequenceSize];
+   SequenceTracker::Encode(sequence, frame);
+   return SendFrame(frame, sizeof (frame), more);
+}
+
+/**
+ * Send one frame of a shot, retrying if a signal interrupts it.
+ * @param data
+ * @param size
+ * @param more
+ *   If more frames of the shot follow
+ * @return 
+ *   If it was sent
+ */
+bool Shotgun::SendFrame(const void* data, const size_t size, const bool more) {
+   if (mJammed) {
+      return false;
    }
+   int rc;
+   do {
+      rc = zmq_send(mGun, data, size, more ? ZMQ_SNDMORE : 0);
+   } while (rc < 0 && zmq_errno() == EINTR);
+   return Sent(rc >= 0, more);
+}
+
+/**
+ * Send one frame of a shot, retrying if a signal interrupts it.
+ * @param frame
+ *   Owned by zeromq once sent, otherwise left for the caller to close
+ * @param more
+ *   If more frames of the shot follow
+ * @return 
+ *   If it was sent
+ */
+bool Shotgun::SendFrame(zmq_msg_t& frame, const bool more) {
+   if (mJammed) {
+      return false;
+   }
+   int rc;
+   do {
+      rc = zmq_msg_send(&frame, mGun, more ? ZMQ_SNDMORE : 0);
+   } while (rc < 0 && zmq_errno() == EINTR);
+   return Sent(rc >= 0, more);
+}
+
+/**
+ * Keep track of where we are in a shot. A frame that fails after the first
+ * has been sent leaves zeromq holding part of a message that can't be taken
+ * back, whatever is sent next would be glued on to it. The Shotgun is 
+ * jammed for good from then on and has to be replaced.
+ * @param sent
+ * @param more
+ * @return 
+ *   sent
+ */
+bool Shotgun::Sent(const bool sent, const bool more) {
+   if (!sent) {
+      if (mMidShot) {
+         LOG(WARNING) << "Shotgun failed part way through a shot, it is jammed: " 
+            << zmq_strerror(zmq_errno());
+         mJammed = true;
+      }
+      return false;
+   }
+   mMidShot = more;
+   return true;
+}
+
+/**
+ * @return 
+ *   If a shot failed part way through, nothing can be fired after that
+ */
+bool Shotgun::IsJammed() const {
+   return mJammed;
+}
+
+/**
+ * Keep a topic's last value for the snapshots, before it is sent.
+ * @param topic
+ * @param sequence
+ * @param bullets
+ */
+void Shotgun::Remember(const std::string& topic, const uint64_t sequence,
+   const std::vector<std::string>& bullets) {
+   std::lock_guard<std::mutex> lock(mLastValuesMutex);
+   LastValue& last = mLastValues[topic];
+   last.mSequence = sequence;
+   last.mBullets = bullets;
+}
+
+/**
+ * Fire a string at a topic without copying it to zeromq.
+ * 
+ * The bullet's buffer is handed to zeromq and shared by reference between 
+ * all the subscribers it goes to, the FreeFunction is called once the last
+ * of them is done with it, or straight away if it can't be fired. The 
+ * Aliens get it as a single bullet. With the last value cache on the bullet
+ * is copied into the cache.
+ * @param topic
+ * @param zero
+ *   Owned by zeromq from here on
+ * @param size
+ * @param FreeFunction
+ *   Called with the buffer and the string, possibly on a zeromq thread
+ * @return 
+ *   If the shot was fired
+ */
+bool Shotgun::FireZeroCopy(const std::string& topic, std::string* zero, const size_t size,
+   void (*FreeFunction)(void*, void*)) {
+   const uint64_t sequence = NextSequence(topic);
+   if (mCaching) {
+      Remember(topic, sequence, std::vector<std::string>(1, std::string(zero->data(), size)));
+   }
+   zmq_msg_t message;
+   zmq_msg_init_data(&message, &((*zero)[0]), size, FreeFunction, zero);
+   const bool sent = SendTopic(topic, sequence, true) && SendFrame(message, false);
+   if (!sent) {
+      zmq_msg_close(&message);
+   }
+   CountShot(sent, size);
+   return sent;
+}
+
+/**
+ * Count a shot that was fired, or not.
+ * @param sent
+ * @param bytes
+ */
+void Shotgun::CountShot(const bool sent, const size_t bytes) {
+   if (!sent && mJammed) {
+      mStats.AddSendError();
+   } else if (!sent) {
+      LOG(WARNING) << "could not send message";
+      // a publisher never waits for room, the message was dropped
+      mStats.AddSendTimeout();
+   } else {
+      mStats.AddMessage(bytes);
+   }
+}
+
+/**
+ * @return 
+ *   What this Shotgun has fired so far, safe to call from any thread. 
+ * Messages a publisher drops at its high water mark can't be seen here.
+ */
+SocketStats::Snapshot Shotgun::GetStats() const {
+   return mStats.GetSnapshot();
 }
 
 /**
  * Cleanup our socket and context.
  */
 Shotgun::~ Shotgun() {
+   if (mCaching) {
+      mServing = false;
+      mSnapshotServer.join();
+      zsocket_destroy(mCtx, mSnapshots);
+   }
    zsocket_destroy(mCtx, mGun);
-   zctx_destroy(&mCtx);
+   ContextRegistry::Instance().Release(mCtx);
 }
 
@@ -2,19 +2,64 @@
 
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <atomic>
 #include <vector>
 #include <string>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <zmq.h>
+#include "SocketStats.h"
 struct _zctx_t;
 typedef struct _zctx_t zctx_t;
 class Shotgun {
 public:
    Shotgun();
+   bool SetLastValueCache(const std::string& snapshotLocation);
+   bool GetLastValueCache() const;
+   void SetSequencing(const bool sequence);
+   bool GetSequencing() const;
    void Aim(const std::string& location);
    void Fire(const std::string& msg);
    void Fire(const std::vector<std::string>& bullets);
+   void Fire(const std::string& topic, const std::vector<std::string>& bullets);
+   bool FireZeroCopy(const std::string& topic, std::string* zero, const size_t size,
+      void (*FreeFunction)(void*, void*));
+   bool IsJammed() const;
+   SocketStats::Snapshot GetStats() const;
    virtual ~Shotgun();
 private:
+   struct LastValue {
+      uint64_t mSequence;
+      std::vector<std::string> mBullets;
+   };
    void setIpcFilePermissions(const std::string& location);
+   void CountShot(const bool sent, const size_t bytes);
+   bool SendFrame(const void* data, const size_t size, const bool more);
+   bool SendFrame(zmq_msg_t& frame, const bool more);
+   bool Sent(const bool sent, const bool more);
+   uint64_t NextSequence(const std::string& topic);
+   bool SendTopic(const std::string& topic, const uint64_t sequence, const bool more);
+   bool Send(const std::string& topic, const uint64_t sequence,
+      const std::vector<std::string>& bullets, size_t& bytes);
+   void Remember(const std::string& topic, const uint64_t sequence,
+      const std::vector<std::string>& bullets);
+   void ServeSnapshots();
+   bool SendSnapshot(const std::string& identity, const std::string& prefix);
    void *mGun;
    zctx_t *mCtx;
+   SocketStats mStats;
+   bool mCaching;
+   // shared with the thread serving snapshots
+   std::mutex mLastValuesMutex;
+   std::map<std::string, LastValue> mLastValues;
+   void* mSnapshots;
+   std::thread mSnapshotServer;
+   std::atomic<bool> mServing;
+   bool mSequencing;
+   std::unordered_map<std::string, uint64_t> mSequences;
+   bool mMidShot;
+   bool mJammed;
 };
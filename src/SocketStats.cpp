@@ -0,0 +1,69 @@
+#include "SocketStats.h"
+
+SocketStats::SocketStats() : mMessages(0), mBytes(0), mSendTimeouts(0),
+mSendErrors(0), mPollErrors(0), mInvalidMessages(0), mBlockedMicroseconds(0) {
+}
+
+/**
+ * Count a message that was sent or received.
+ * @param bytes
+ *   The size of its payload
+ */
+void SocketStats::AddMessage(const size_t bytes) {
+   Bump(mMessages, 1);
+   Bump(mBytes, bytes);
+}
+
+/**
+ * Count a send that gave up, normally because the high water mark was hit 
+ * and no room came free in time.
+ */
+void SocketStats::AddSendTimeout() {
+   Bump(mSendTimeouts, 1);
+}
+
+/**
+ * Count a send that failed for any reason other than running out of time.
+ */
+void SocketStats::AddSendError() {
+   Bump(mSendErrors, 1);
+}
+
+/**
+ * Count a zmq_poll that failed.
+ */
+void SocketStats::AddPollError() {
+   Bump(mPollErrors, 1);
+}
+
+/**
+ * Count a message that was received but thrown away.
+ */
+void SocketStats::AddInvalidMessage() {
+   Bump(mInvalidMessages, 1);
+}
+
+/**
+ * Count the time spent waiting for room to send, from start until now.
+ * @param start
+ */
+void SocketStats::AddBlockedSince(const std::chrono::steady_clock::time_point& start) {
+   Bump(mBlockedMicroseconds, std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start).count());
+}
+
+/**
+ * @return 
+ *   A copy of the counters, safe to take from any thread
+ */
+SocketStats::Snapshot SocketStats::GetSnapshot() const {
+   Snapshot snapshot;
+   snapshot.mMessages = mMessages.load(std::memory_order_relaxed);
+   snapshot.mBytes = mBytes.load(std::memory_order_relaxed);
+   snapshot.mSendTimeouts = mSendTimeouts.load(std::memory_order_relaxed);
+   snapshot.mSendErrors = mSendErrors.load(std::memory_order_relaxed);
+   snapshot.mPollErrors = mPollErrors.load(std::memory_order_relaxed);
+   snapshot.mInvalidMessages = mInvalidMessages.load(std::memory_order_relaxed);
+   snapshot.mBlockedMicroseconds = mBlockedMicroseconds.load(std::memory_order_relaxed);
+   return snapshot;
+}
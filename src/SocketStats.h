@@ -0,0 +1,57 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+
+/**
+ * Counters for what a socket wrapper has moved and how often it had to wait.
+ * 
+ * A wrapper is only ever used from one thread, so the counters are bumped 
+ * with a relaxed load and store instead of a locked add. Any thread can take
+ * a Snapshot at any time, each count in it is exact as of some recent 
+ * moment but they aren't read together.
+ */
+class SocketStats {
+public:
+
+   struct Snapshot {
+      uint64_t mMessages;
+      uint64_t mBytes;
+      uint64_t mSendTimeouts;
+      uint64_t mSendErrors;
+      uint64_t mPollErrors;
+      uint64_t mInvalidMessages;
+      uint64_t mBlockedMicroseconds;
+   };
+
+   SocketStats();
+
+   void AddMessage(const size_t bytes);
+   void AddSendTimeout();
+   void AddSendError();
+   void AddPollError();
+   void AddInvalidMessage();
+   void AddBlockedSince(const std::chrono::steady_clock::time_point& start);
+   Snapshot GetSnapshot() const;
+
+   /**
+    * Add to a counter that only one thread ever writes.
+    * @param counter
+    * @param amount
+    */
+   static void Bump(std::atomic<uint64_t>& counter, const uint64_t amount) {
+      counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+   }
+private:
+   SocketStats(const SocketStats&) = delete;
+   SocketStats& operator=(const SocketStats&) = delete;
+
+   std::atomic<uint64_t> mMessages;
+   std::atomic<uint64_t> mBytes;
+   std::atomic<uint64_t> mSendTimeouts;
+   std::atomic<uint64_t> mSendErrors;
+   std::atomic<uint64_t> mPollErrors;
+   std::atomic<uint64_t> mInvalidMessages;
+   std::atomic<uint64_t> mBlockedMicroseconds;
+};
@@ -0,0 +1,104 @@
+#pragma once
+#include <stddef.h>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+/**
+ * A bounded, lock free, single producer single consumer ring.
+ * 
+ * Items are swapped in and out of preallocated slots instead of being 
+ * copied, so for types like std::string the buffers are recycled between 
+ * the producer and the consumer and the steady state doesn't allocate.
+ * The producer and consumer indexes live on their own cache lines, each 
+ * side keeps a private copy of the other's index and only reloads it when 
+ * the ring looks full or empty.
+ */
+template<typename T>
+class SpscRing {
+public:
+
+   /**
+    * @param capacity
+    *   Rounded up to the next power of two
+    */
+   explicit SpscRing(const size_t capacity) : mMask(RoundUp(capacity) - 1),
+   mSlots(mMask + 1), mTail(0), mCachedHead(0), mHead(0), mCachedTail(0) {
+   }
+
+   /**
+    * Producer side, swap item into the ring.
+    * @param item
+    *   Left holding whatever the slot held before
+    * @return 
+    *   false if the ring is full
+    */
+   bool Push(T& item) {
+      const size_t tail = mTail.load(std::memory_order_relaxed);
+      if (tail - mCachedHead > mMask) {
+         mCachedHead = mHead.load(std::memory_order_acquire);
+         if (tail - mCachedHead > mMask) {
+            return false;
+         }
+      }
+      using std::swap;
+      swap(mSlots[tail & mMask], item);
+      mTail.store(tail + 1, std::memory_order_release);
+      return true;
+   }
+
+   /**
+    * Consumer side, swap the oldest item out of the ring.
+    * @param item
+    *   Its old value is left in the slot for the producer to reuse
+    * @return 
+    *   false if the ring is empty
+    */
+   bool Pop(T& item) {
+      const size_t head = mHead.load(std::memory_order_relaxed);
+      if (head == mCachedTail) {
+         mCachedTail = mTail.load(std::memory_order_acquire);
+         if (head == mCachedTail) {
+            return false;
+         }
+      }
+      using std::swap;
+      swap(item, mSlots[head & mMask]);
+      mHead.store(head + 1, std::memory_order_release);
+      return true;
+   }
+
+   /**
+    * The number of items queued, only exact when called from one side while 
+    * the other is idle.
+    * @return 
+    */
+   size_t Size() const {
+      return mTail.load(std::memory_order_acquire) - mHead.load(std::memory_order_acquire);
+   }
+
+   size_t Capacity() const {
+      return mMask + 1;
+   }
+private:
+   SpscRing(const SpscRing&) = delete;
+   SpscRing& operator=(const SpscRing&) = delete;
+
+   static size_t RoundUp(const size_t capacity) {
+      size_t size = 1;
+      while (size < capacity) {
+         size <<= 1;
+      }
+      return size;
+   }
+
+   const size_t mMask;
+   std::vector<T> mSlots;
+   char mPadProducer[64];
+   std::atomic<size_t> mTail;
+   size_t mCachedHead;
+   char mPadConsumer[64];
+   std::atomic<size_t> mHead;
+   size_t mCachedTail;
+   char mPadEnd[64];
+};
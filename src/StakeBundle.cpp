@@ -0,0 +1,99 @@
+#include "StakeBundle.h"
+
+/**
+ * The process wide pool of empty bundles.
+ * @return 
+ */
+MpmcQueue<StakeBundle*>& StakeBundle::Pool() {
+   static MpmcQueue<StakeBundle*> pool(kPoolSize);
+   return pool;
+}
+
+/**
+ * Construct an empty bundle, use Get instead.
+ */
+StakeBundle::StakeBundle() : mCount(0) {
+}
+
+/**
+ * Get an empty bundle, from the pool if it has one.
+ * @return 
+ */
+StakeBundle* StakeBundle::Get() {
+   StakeBundle* bundle = NULL;
+   if (!Pool().Pop(bundle)) {
+      bundle = new StakeBundle;
+   }
+   return bundle;
+}
+
+/**
+ * Give a bundle back to the pool, it is deleted if the pool is full.
+ * @param bundle
+ */
+void StakeBundle::Recycle(StakeBundle* bundle) {
+   if (bundle == NULL) {
+      return;
+   }
+   bundle->clear();
+   if (!Pool().Push(bundle)) {
+      delete bundle;
+   }
+}
+
+/**
+ * @return 
+ *   The number of bundles waiting in the pool
+ */
+size_t StakeBundle::GetPooledCount() {
+   return Pool().Size();
+}
+
+/**
+ * Add a stake to the bundle.
+ * @param stake
+ * @param hash
+ * @return 
+ *   false if the bundle is full
+ */
+bool StakeBundle::push_back(void* stake, const unsigned int hash) {
+   if (mCount == kCapacity) {
+      return false;
+   }
+   mStakes[mCount].first = stake;
+   mStakes[mCount].second = hash;
+   mCount++;
+   return true;
+}
+
+void StakeBundle::clear() {
+   mCount = 0;
+}
+
+size_t StakeBundle::size() const {
+   return mCount;
+}
+
+bool StakeBundle::empty() const {
+   return (mCount == 0);
+}
+
+bool StakeBundle::full() const {
+   return (mCount == kCapacity);
+}
+
+StakeBundle::Stake* StakeBundle::data() {
+   return mStakes;
+}
+
+const StakeBundle::Stake* StakeBundle::data() const {
+   return mStakes;
+}
+
+StakeBundle::Stake& StakeBundle::operator[](const size_t index) {
+   return mStakes[index];
+}
+
+const StakeBundle::Stake& StakeBundle::operator[](const size_t index) const {
+   return mStakes[index];
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <stddef.h>
+#include <utility>
+#include "MpmcQueue.h"
+
+#define SIZE_OF_STAKE_BUNDLE 500
+
+/**
+ * A fixed size bundle of stakes, recycled through a lock free pool.
+ * 
+ * A bundle is filled in place and fired with Rifle::FireStakes, which hands
+ * its memory to zeromq without copying it and recycles it once sent. 
+ * Vampire::GetStakes fills a bundle from the pool, the caller recycles it 
+ * when done. On the wire a bundle is the same as a vector of stakes.
+ */
+class StakeBundle {
+public:
+   typedef std::pair<void*, unsigned int> Stake;
+   static const size_t kCapacity = SIZE_OF_STAKE_BUNDLE;
+   static const size_t kPoolSize = 1024;
+
+   static StakeBundle* Get();
+   static void Recycle(StakeBundle* bundle);
+   static size_t GetPooledCount();
+
+   bool push_back(void* stake, const unsigned int hash);
+   void clear();
+   size_t size() const;
+   bool empty() const;
+   bool full() const;
+   Stake* data();
+   const Stake* data() const;
+   Stake& operator[](const size_t index);
+   const Stake& operator[](const size_t index) const;
+private:
+   friend class Vampire;
+   StakeBundle();
+   StakeBundle(const StakeBundle&) = delete;
+   StakeBundle& operator=(const StakeBundle&) = delete;
+   static MpmcQueue<StakeBundle*>& Pool();
+
+   size_t mCount;
+   Stake mStakes[kCapacity];
+};
@@ -0,0 +1,66 @@
+#pragma once
+#include <string.h>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "Rifle.h"
+#include "g2log.hpp"
+
+/**
+ * A Rifle that fires fixed layout records as their raw bytes.
+ * 
+ * There is no string built on the way out, each record or array of records 
+ * is copied once into the frame. Pair it with a TypedVampire of the same T.
+ */
+template<typename T>
+class TypedRifle : public Rifle {
+   static_assert(std::is_trivially_copyable<T>::value,
+      "TypedRifle records are sent as their bytes and must be trivially copyable");
+public:
+
+   explicit TypedRifle(const std::string& location) : Rifle(location) {
+   }
+
+   /**
+    * Fire one record.
+    * @param record
+    * @param waitToFire in milliseconds
+    * @return 
+    */
+   bool Fire(const T& record, const int waitToFire = 10000) {
+      if (!IsAimed()) {
+         LOG(WARNING) << "Socket uninitialized!";
+         return false;
+      }
+      return SendCopy(&record, sizeof (T), waitToFire);
+   }
+
+   /**
+    * Fire an array of records as one bullet.
+    * @param records
+    * @param count
+    * @param waitToFire in milliseconds
+    * @return 
+    */
+   bool Fire(const T* records, const size_t count, const int waitToFire = 10000) {
+      if (!IsAimed()) {
+         LOG(WARNING) << "Socket uninitialized!";
+         return false;
+      }
+      if (count == 0) {
+         LOG(WARNING) << "Tried to send empty packet";
+         return false;
+      }
+      return SendCopy(records, count * sizeof (T), waitToFire);
+   }
+
+   /**
+    * Fire a vector of records as one bullet.
+    * @param records
+    * @param waitToFire in milliseconds
+    * @return 
+    */
+   bool Fire(const std::vector<T>& records, const int waitToFire = 10000) {
+      return Fire(records.data(), records.size(), waitToFire);
+   }
+};
@@ -0,0 +1,106 @@
+#pragma once
+#include <string.h>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <boost/thread.hpp>
+#include "Vampire.h"
+#include "g2log.hpp"
+
+/**
+ * A Vampire that is shot with the fixed layout records of a TypedRifle.
+ * 
+ * Bullets are copied straight from the frame into the caller's records, 
+ * there is no intermediate string to parse.
+ */
+template<typename T>
+class TypedVampire : public Vampire {
+   static_assert(std::is_trivially_copyable<T>::value,
+      "TypedVampire records are sent as their bytes and must be trivially copyable");
+public:
+
+   explicit TypedVampire(const std::string& location) : Vampire(location) {
+   }
+
+   /**
+    * Get shot with one record.
+    * @param record
+    * @param timeout
+    * @return 
+    *   false on timeout or if the bullet wasn't exactly one record
+    */
+   bool GetShot(T& record, const int timeout) {
+      size_t count = 0;
+      return (GetShot(&record, 1, count, timeout) && count == 1);
+   }
+
+   /**
+    * Get shot with an array of records.
+    * @param records
+    *   Caller owned room for maxCount records
+    * @param maxCount
+    * @param count
+    *   The number of records received
+    * @param timeout
+    * @return 
+    *   false on timeout or if the bullet didn't fit
+    */
+   bool GetShot(T* records, const size_t maxCount, size_t& count, const int timeout) {
+      count = 0;
+      if (!Bite(timeout)) {
+         return false;
+      }
+      bool success = false;
+      if (BloodSize() > maxCount * sizeof (T)) {
+         LOG(WARNING) << "Received " << BloodSize() / sizeof (T) << " records, room for " << maxCount;
+      } else {
+         count = BloodSize() / sizeof (T);
+         memcpy(records, BloodData(), count * sizeof (T));
+         success = true;
+      }
+      Digest();
+      return success;
+   }
+
+   /**
+    * Get shot with a vector of records.
+    * @param records
+    *   Resized to the records received, keeping its capacity
+    * @param timeout
+    * @return 
+    */
+   bool GetShot(std::vector<T>& records, const int timeout) {
+      if (!Bite(timeout)) {
+         records.clear();
+         return false;
+      }
+      // frames aren't aligned for T, so copy rather than cast
+      records.resize(BloodSize() / sizeof (T));
+      memcpy(records.data(), BloodData(), BloodSize());
+      Digest();
+      return true;
+   }
+private:
+
+   /**
+    * Feed on the next bullet, which must be a whole number of records.
+    * @param timeout
+    * @return 
+    */
+   bool Bite(const int timeout) {
+      if (!IsPrepared()) {
+         LOG(WARNING) << "Socket uninitialized!";
+         boost::this_thread::sleep(boost::posix_time::seconds(1));
+         return false;
+      }
+      if (!Feed(timeout)) {
+         return false;
+      }
+      if (BloodSize() == 0 || BloodSize() % sizeof (T) != 0) {
+         LOG(WARNING) << "Received bullet of " << BloodSize() << " bytes, records are " << sizeof (T);
+         Digest();
+         return false;
+      }
+      return true;
+   }
+};
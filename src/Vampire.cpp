@@ -1,11 +1,25 @@
 #include <boost/thread.hpp>
 #define _OPEN_SYS
 #include <sys/stat.h>
+#include <algorithm>
+#include <chrono>
 
 #include "Vampire.h"
 #include "czmq.h"
 #include "g2log.hpp"
 #include "Death.h"
+#include "ContextRegistry.h"
+#include "InprocJunction.h"
+#include "ShmRing.h"
+
+namespace {
+   /**
+    * zeromq free function for a string handed over as a Wound's frame.
+    */
+   void FreeInprocBlood(void* data, void* hint) {
+      delete reinterpret_cast<std::string*> (hint);
+   }
+}
 
 
 /**
@@ -18,7 +32,14 @@ mBody(NULL),
 mContext(NULL),
 mLinger(10),
 mIOThredCount(1),
-mOwnSocket(false) {
+mOwnSocket(false),
+mShmBlood(NULL),
+mShmBloodSize(0),
+mCreditDispatch(false),
+mOwedCredits(0),
+mLatencyTracking(false),
+mBloodOffset(0) {
+   zmq_msg_init(&mBlood);
 }
 
 /**
@@ -69,6 +90,99 @@ bool Vampire::GetOwnSocket() {
    return mOwnSocket;
 }
 
+/**
+ * Decompress bullets received over zeromq, the Rifles must have compression
+ * set too.
+ * @param compress
+ */
+void Vampire::SetCompression(const bool compress) {
+   if (compress) {
+      mCompressor.reset(new Compressor);
+   } else {
+      mCompressor.reset();
+   }
+}
+
+/**
+ * Decompress with a preset dictionary, the Rifles must use the same one.
+ * @param dictionary
+ * @return 
+ *   false if compression isn't set or the dictionary can't be used
+ */
+bool Vampire::SetCompressionDictionary(const std::string& dictionary) {
+   if (!mCompressor) {
+      LOG(WARNING) << "Compression is not set";
+      return false;
+   }
+   return mCompressor->SetDictionary(dictionary);
+}
+
+/**
+ * @return 
+ *   What this Vampire has been shot with so far, safe to call from any 
+ * thread. Bytes are counted before decompression.
+ */
+SocketStats::Snapshot Vampire::GetStats() const {
+   return mStats.GetSnapshot();
+}
+
+/**
+ * Measure how long each shot took to arrive from the time stamp the Rifle 
+ * put on it. The Rifle must have latency tracking set too. Only meaningful 
+ * when both ends share a host.
+ * 
+ * Turning it off only stops recording, the histogram lives as long as the
+ * Vampire so what GetLatency returned stays good to read.
+ * @param track
+ */
+void Vampire::SetLatencyTracking(const bool track) {
+   if (track && !mLatency) {
+      mLatency.reset(new LatencyHistogram);
+   }
+   mLatencyTracking = track;
+}
+
+/**
+ * @return 
+ *   The delivery latencies measured so far, safe to read from any thread 
+ * for the life of the Vampire, or NULL if latency tracking was never set
+ */
+const LatencyHistogram* Vampire::GetLatency() const {
+   return mLatency.get();
+}
+
+/**
+ * Take bullets from a Rifle using credit dispatch, granting it credit for 
+ * our high water mark up front and more as shots are taken. This must be 
+ * called before PrepareToBeShot, it only applies to zeromq transports.
+ * @param credit
+ */
+void Vampire::SetCreditDispatch(const bool credit) {
+   mCreditDispatch = credit;
+}
+
+/**
+ * Get value for credit dispatch.
+ * @return bool
+ */
+bool Vampire::GetCreditDispatch() {
+   return mCreditDispatch;
+}
+
+/**
+ * Give the Rifle back the credit for the shots we have taken, once we owe 
+ * it half our high water mark. Grants that can't go out yet are kept.
+ */
+void Vampire::GrantCredits() {
+   if (mOwedCredits < std::max(1, GetHighWater() / 2)) {
+      return;
+   }
+   const uint32_t credits = mOwedCredits;
+   if (zmq_send(mBody, &credits, sizeof (credits), ZMQ_DONTWAIT) >= 0) {
+      mOwedCredits = 0;
+   }
+}
+
 /**
  * Get IO thread count;
  * @param count
@@ -79,22 +193,47 @@ int Vampire::GetIOThreads() {
 
 /**
  * Set the location we are going to be shot at.
+ * 
+ * inproc:// locations skip zeromq and go over the lock free rings of the 
+ * InprocJunction, shm:// locations go over a ShmRing. The high water mark 
+ * still applies to both.
  * @param location
  * @return 
  */
 bool Vampire::PrepareToBeShot() {
-   if (mBody) {
+   if (mBody || mInproc || mShm) {
+      return true;
+   }
+   if (ShmRing::IsShm(mLocation)) {
+      mShm.reset(new ShmRing(mLocation, false, GetOwnSocket(), GetHighWater()));
+      if (!mShm->Open()) {
+         LOG(WARNING) << "Vampire Can't open : " << mLocation;
+         mShm.reset();
+         return false;
+      }
+      Death::Instance().RegisterDeathEvent(&ShmRing::DeleteShmFiles, mLocation);
+      return true;
+   }
+   if (InprocJunction::IsInproc(mLocation)) {
+      mInproc = InprocJunction::Instance().Attach(mLocation, false, GetOwnSocket(), GetHighWater());
+      if (!mInproc) {
+         LOG(WARNING) << "Vampire Can't bind : " << mLocation;
+         return false;
+      }
       return true;
    }
    if (!mContext) {
-      mContext = zctx_new();
+      mContext = ContextRegistry::Instance().Acquire(GetIOThreads());
+      if (!mContext) {
+         LOG(WARNING) << "Vampire can't get a context";
+         return false;
+      }
       zctx_set_sndhwm(mContext, GetHighWater());
       zctx_set_rcvhwm(mContext, GetHighWater());// HWM on internal thread communication
       //zctx_set_linger(mContext, mLinger); // linger for a millisecond on close
-      zctx_set_iothreads(mContext, GetIOThreads());
    }
    if (!mBody) {
-      mBody = zsocket_new(mContext, ZMQ_PULL);
+      mBody = zsocket_new(mContext, GetCreditDispatch() ? ZMQ_DEALER : ZMQ_PULL);
       CZMQToolkit::setHWMAndBuffer(mBody, GetHighWater());
       if (GetOwnSocket()) {
          int result = zsocket_bind(mBody, mLocation.c_str());
@@ -118,6 +257,10 @@ bool Vampire::PrepareToBeShot() {
       }
       Death::Instance().RegisterDeathEvent(&Death::DeleteIpcFiles, mLocation);
       CZMQToolkit::PrintCurrentHighWater(mBody, "Vampire: body");
+      if (GetCreditDispatch()) {
+         mOwedCredits = std::max(1, GetHighWater());
+         GrantCredits();
+      }
    }
    return ((mContext != NULL) && (mBody != NULL));
 
@@ -142,53 +285,345 @@ void Vampire::setIpcFilePermissions() {
    }
 }
 
+/**
+ * @return 
+ *   If PrepareToBeShot has succeeded and we can be shot
+ */
+bool Vampire::IsPrepared() const {
+   return (mBody || mInproc || mShm);
+}
+
+/**
+ * Receive a single frame message into our blood, recording its latency and
+ * skipping its time stamp when latency tracking is set.
+ * @param timeout
+ * @return 
+ *   If a valid message is now held in mBlood, or in mInprocBlood for inproc.
+ *   For shm it is held in the ring until Digest.
+ */
+bool Vampire::Feed(const int timeout) {
+   mBloodOffset = 0;
+   if (!Drink(timeout)) {
+      return false;
+   }
+   if (mLatencyTracking) {
+      if (BloodSize() < LatencyHistogram::kStampSize) {
+         LOG(WARNING) << "Received message without a time stamp.";
+         mStats.AddInvalidMessage();
+         Digest();
+         return false;
+      }
+      mLatency->Record(LatencyHistogram::Elapsed(BloodData()));
+      mBloodOffset = LatencyHistogram::kStampSize;
+   }
+   return true;
+}
+
+/**
+ * Receive a single frame message as it was sent.
+ * 
+ * The message is reused for every receive, so once its been initialized the
+ * receive path doesn't touch the heap. Like ZeroMQ<void*>::GetPointer we try
+ * to receive first and only poll when nothing is waiting.
+ * @param timeout
+ * @return 
+ *   If a valid message was received
+ */
+bool Vampire::Drink(const int timeout) {
+   if (mInproc || mShm) {
+      const bool fed = mInproc ? mInproc->GetShot(mInprocBlood, timeout) :
+         mShm->Feed(timeout, mShmBlood, mShmBloodSize);
+      if (fed) {
+         mStats.AddMessage(BloodSize());
+      }
+      return fed;
+   }
+   if (zmq_msg_recv(&mBlood, mBody, ZMQ_DONTWAIT) < 0) {
+      if (zmq_errno() != EAGAIN) {
+         LOG(INFO) << "received null message, time for shutdown.";
+         return false;
+      }
+      if (mCreditDispatch) {
+         // a grant that couldn't go out earlier must not wait for a shot
+         GrantCredits();
+      }
+      if (timeout == 0) {
+         return false;
+      }
+      zmq_pollitem_t items [] = {
+         { mBody, 0, ZMQ_POLLIN, 0}
+      };
+      if (mCreditDispatch && mOwedCredits >= std::max(1, GetHighWater() / 2)) {
+         // a grant can't go out until the Rifle is connected
+         items[0].events |= ZMQ_POLLOUT;
+      }
+      const auto start = std::chrono::steady_clock::now();
+      int pollResult = zmq_poll(items, 1, timeout);
+      if (pollResult > 0 && !(items[0].revents & ZMQ_POLLIN) && (items[0].revents & ZMQ_POLLOUT)) {
+         GrantCredits();
+         items[0].events = ZMQ_POLLIN;
+         long remaining = timeout;
+         if (timeout > 0) {
+            remaining = std::max(0L, timeout - static_cast<long> (std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - start).count()));
+         }
+         pollResult = zmq_poll(items, 1, remaining);
+      }
+      if (pollResult < 0) {
+         LOG(WARNING) << "Error on zmq socket receiving " << GetBinding() << ": " << zmq_strerror(zmq_errno());
+         mStats.AddPollError();
+         return false;
+      } else if (pollResult == 0) {
+         //socket timed out
+         return false;
+      } else if (!(items[0].revents & ZMQ_POLLIN)) {
+         LOG(WARNING) << "Error in zmq_pollin " << GetBinding();
+         return false;
+      }
+      if (zmq_msg_recv(&mBlood, mBody, ZMQ_DONTWAIT) < 0) {
+         LOG(INFO) << "received null message, time for shutdown.";
+         return false;
+      }
+   }
+   if (mCreditDispatch) {
+      mOwedCredits++;
+      GrantCredits();
+   }
+   if (zmq_msg_more(&mBlood)) {
+      size_t frames = 1;
+      while (zmq_msg_more(&mBlood) && zmq_msg_recv(&mBlood, mBody, 0) >= 0) {
+         frames++;
+      }
+      LOG(WARNING) << "Received invalid sized message of size: " << frames;
+      mStats.AddInvalidMessage();
+      return false;
+   }
+   mStats.AddMessage(zmq_msg_size(&mBlood));
+   return true;
+}
+
+/**
+ * @return 
+ *   The bytes of the message Feed received
+ */
+const char* Vampire::BloodData() {
+   if (mInproc) {
+      return mInprocBlood.data() + mBloodOffset;
+   }
+   if (mShm) {
+      return mShmBlood + mBloodOffset;
+   }
+   return reinterpret_cast<const char*> (zmq_msg_data(&mBlood)) + mBloodOffset;
+}
+
+/**
+ * @return 
+ *   The size of the message Feed received
+ */
+size_t Vampire::BloodSize() {
+   if (mInproc) {
+      return mInprocBlood.size() - mBloodOffset;
+   }
+   if (mShm) {
+      return mShmBloodSize - mBloodOffset;
+   }
+   return zmq_msg_size(&mBlood) - mBloodOffset;
+}
+
+/**
+ * Done with the message Feed received, a shm bullet is given back to the 
+ * ring.
+ */
+void Vampire::Digest() {
+   if (mShm) {
+      mShm->Digest();
+   }
+}
+
 /**
  * Get shot by the rifle.
+ * 
+ * Over inproc the bullet's buffer is swapped straight out of the pipe and 
+ * the wound's old buffer goes back to the Rifle for reuse, unless latency 
+ * tracking is set.
  * @param bullet
  * @return 
  */
 bool Vampire::GetShot(std::string& wound, const int timeout) {
-   if (!mBody) {
+   if (!IsPrepared()) {
       LOG(WARNING) << "Socket uninitialized!";
       boost::this_thread::sleep(boost::posix_time::seconds(1));
       return false;
    }
-   bool success = false;
-   zmsg_t* message = NULL;
-   zmq_pollitem_t items [] = {
-      { mBody, 0, ZMQ_POLLIN, 0}
-   };
-   int pollResult = zmq_poll(items, 1, timeout);
-   if (pollResult > 0) {
-      if (items[0].revents & ZMQ_POLLIN) {
-         message = zmsg_recv(mBody);
-         if (message && zmsg_size(message) == 1) {
-            zframe_t* frame = zmsg_last(message);
-            wound.clear();
-            wound.append(reinterpret_cast<char*> (zframe_data(frame)), zframe_size(frame));
-            success = true;
-         } else {
-            if (!message) {
-               LOG(INFO) << "received null message, time for shutdown.";
-            } else {
-               LOG(WARNING) << "Received invalid sized message of size: " << zmsg_size(message);
-            }
-         }
-      } else {
-         LOG(WARNING) << "Error in zmq_pollin " << GetBinding();
+   if (mInproc && !mLatencyTracking) {
+      if (!mInproc->GetShot(wound, timeout)) {
+         return false;
       }
-
-   } else if (pollResult < 0) {
-      LOG(WARNING) << "Error on zmq socket receiving " << GetBinding() << ": " << zmq_strerror(zmq_errno());
-   } else {
-      //socket timed out
+      mStats.AddMessage(wound.size());
+      return true;
+   }
+   if (!Feed(timeout)) {
+      return false;
    }
-   if (message) {
-      zmsg_destroy(&message);
+   bool success = true;
+   if (mCompressor && mBody) {
+      success = mCompressor->Decompress(BloodData(), BloodSize(), wound);
+      if (!success) {
+         mStats.AddInvalidMessage();
+      }
+   } else {
+      wound.assign(BloodData(), BloodSize());
    }
+   Digest();
    return success;
 }
 
+/**
+ * Get shot by the rifle without copying the bullet out of zeromq.
+ * 
+ * The receive side twin of Rifle::FireZeroCopy, the wound holds the frame
+ * until it is released. Over inproc the frame wraps the string swapped out 
+ * of the pipe. With compression set the wound holds a decompressed copy, 
+ * and with latency tracking set it holds a copy without the time stamp.
+ * @param wound
+ *   Any frame it held before is freed
+ * @param timeout
+ * @return 
+ */
+bool Vampire::GetShot(Wound& wound, const int timeout) {
+   if (!IsPrepared()) {
+      LOG(WARNING) << "Socket uninitialized!";
+      boost::this_thread::sleep(boost::posix_time::seconds(1));
+      return false;
+   }
+   if (!Feed(timeout)) {
+      wound.Release();
+      return false;
+   }
+   if (mInproc && !mLatencyTracking) {
+      std::string* blood = new std::string;
+      blood->swap(mInprocBlood);
+      wound.Release();
+      zmq_msg_init_data(&wound.mFrame, &((*blood)[0]), blood->size(), FreeInprocBlood, blood);
+      return true;
+   }
+   if (mCompressor && mBody) {
+      if (!mCompressor->Decompress(BloodData(), BloodSize(), mDecompressed)) {
+         mStats.AddInvalidMessage();
+         wound.Release();
+         return false;
+      }
+      wound.Release();
+      zmq_msg_init_size(&wound.mFrame, mDecompressed.size());
+      memcpy(zmq_msg_data(&wound.mFrame), mDecompressed.data(), mDecompressed.size());
+      return true;
+   }
+   if (mShm || mLatencyTracking) {
+      // the ring can't lend out its records and a stamp can't be cut off a
+      // frame, so those wounds are a copy
+      wound.Release();
+      zmq_msg_init_size(&wound.mFrame, BloodSize());
+      memcpy(zmq_msg_data(&wound.mFrame), BloodData(), BloodSize());
+      Digest();
+      return true;
+   }
+   zmq_msg_move(&wound.mFrame, &mBlood);
+   return true;
+}
+
+/**
+ * Get shot without waiting, for callers driving their own epoll loop on 
+ * GetReadFd.
+ * 
+ * The fd is edge triggered, once it fires keep calling this until it 
+ * returns false. A false return has checked ZMQ_EVENTS so the fd is armed
+ * again for the next shot.
+ * @param wound
+ * @return 
+ *   If a shot was taken
+ */
+bool Vampire::TryGetShot(std::string& wound) {
+   if (!IsPrepared()) {
+      return false;
+   }
+   // a shot thrown away as invalid doesn't mean the socket has been drained
+   while (!GetShot(wound, 0)) {
+      if (!mBody || !CZMQToolkit::HasEvents(mBody, ZMQ_POLLIN)) {
+         return false;
+      }
+   }
+   return true;
+}
+
+/**
+ * Get shot without waiting and without copying the bullet out of zeromq, 
+ * see TryGetShot(std::string&).
+ * @param wound
+ * @return 
+ *   If a shot was taken
+ */
+bool Vampire::TryGetShot(Wound& wound) {
+   if (!IsPrepared()) {
+      return false;
+   }
+   // a shot thrown away as invalid doesn't mean the socket has been drained
+   while (!GetShot(wound, 0)) {
+      if (!mBody || !CZMQToolkit::HasEvents(mBody, ZMQ_POLLIN)) {
+         return false;
+      }
+   }
+   return true;
+}
+
+/**
+ * Get a file descriptor to wait on for shots, with epoll or the like. It is
+ * edge triggered, see TryGetShot.
+ * @return 
+ *   The file descriptor, or -1 if we aren't prepared or are shot over the 
+ * native inproc:// or shm:// transports
+ */
+int Vampire::GetReadFd() {
+   return CZMQToolkit::GetFd(mBody);
+}
+
+/**
+ * Get shot by a volley from the rifle.
+ * 
+ * Waits once for the first shot and then drains whatever else is already 
+ * queued, up to maxCount, without waiting again. Strings already in wounds 
+ * are reused so their buffers don't need to be reallocated.
+ * @param wounds
+ *   Resized to the number of shots received
+ * @param maxCount
+ *   The most shots to take in one go
+ * @param timeout
+ * @return 
+ *   If at least one shot was received
+ */
+bool Vampire::GetShots(std::vector<std::string>& wounds, const size_t maxCount,
+   const int timeout) {
+   if (!IsPrepared()) {
+      LOG(WARNING) << "Socket uninitialized!";
+      boost::this_thread::sleep(boost::posix_time::seconds(1));
+      wounds.clear();
+      return false;
+   }
+   size_t count = 0;
+   int wait = timeout;
+   while (count < maxCount) {
+      if (count == wounds.size()) {
+         wounds.push_back(std::string());
+      }
+      if (!GetShot(wounds[count], wait)) {
+         break;
+      }
+      count++;
+      wait = 0;
+   }
+   wounds.resize(count);
+   return (count > 0);
+}
+
 /**
  * Get a pointer from the rifle
  * @param stake
@@ -197,33 +632,21 @@ bool Vampire::GetShot(std::string& wound, const int timeout) {
  *   If something was found
  */
 bool Vampire::GetStake(void*& stake, const int timeout) {
-   if (!mBody) {
+   if (!IsPrepared()) {
       LOG(WARNING) << "Socket uninitialized!";
       boost::this_thread::sleep(boost::posix_time::seconds(1));
       return false;
    }
    bool success = false;
-   zmsg_t* message = NULL;
-   if (zsocket_poll(mBody, timeout)) {
-      message = zmsg_recv(mBody);
-      if (message && (zmsg_size(message) == 1)) {
-         zframe_t* frame = zmsg_pop(message);
-         if (frame && zframe_size(frame) != sizeof (void*)) {
-            LOG(WARNING) << "Received non-pointer message.";
-         } else if(frame) {
-            stake = *reinterpret_cast<void**> (zframe_data(frame));
-            success = true;
-         }
-         //always delete frame if it exists
-         if (frame) {
-            zframe_destroy(&frame);
-         }
-      } else if (message) {
-         LOG(WARNING) << "Received an invalid message";
+   if (Feed(timeout)) {
+      if (BloodSize() != sizeof (void*)) {
+         LOG(WARNING) << "Received non-pointer message.";
+         mStats.AddInvalidMessage();
+      } else {
+         memcpy(&stake, BloodData(), sizeof (void*));
+         success = true;
       }
-   }
-   if (message) {
-      zmsg_destroy(&message);
+      Digest();
    }
    if (!success) {
       stake = NULL;
@@ -252,36 +675,24 @@ bool Vampire::GetStakeNoWait(void*& stake) {
  */
 bool Vampire::GetStakes(std::vector<std::pair<void*, unsigned int> >& stakes,
    const int timeout) {
-   if (!mBody) {
+   if (!IsPrepared()) {
       LOG(WARNING) << "Socket uninitialized!";
       boost::this_thread::sleep(boost::posix_time::seconds(1));
       return false;
    }
    bool success = false;
-   zmsg_t* message = NULL;
-   if (zsocket_poll(mBody, timeout)) {
-      message = zmsg_recv(mBody);
-      if (message && zmsg_size(message) == 1) {
-         zframe_t* frame = zmsg_pop(message);
-         if (frame && zframe_size(frame) < (sizeof (std::pair<void*, unsigned int>))) {
-            LOG(WARNING) << "Received non-pointer message.";
-         } else if (frame) {
-            stakes.clear();
-            stakes.assign(reinterpret_cast<std::pair<void*, unsigned int>*> (zframe_data(frame)),
-               reinterpret_cast<std::pair<void*, unsigned int>*> (zframe_data(frame))
-               + (zframe_size(frame) / sizeof (std::pair<void*, unsigned int>)));
-            success = true;
-         }
-         //always delete frame if it exists
-         if (frame) {
-            zframe_destroy(&frame);
-         }
-      } else if (!message || (zmsg_size(message) != 1)) {
-         LOG(WARNING) << "Received invalid message.";
+   if (Feed(timeout)) {
+      if (BloodSize() < (sizeof (std::pair<void*, unsigned int>))) {
+         LOG(WARNING) << "Received non-pointer message.";
+         mStats.AddInvalidMessage();
+      } else {
+         // assign keeps the capacity stakes already has
+         const std::pair<void*, unsigned int>* first =
+            reinterpret_cast<const std::pair<void*, unsigned int>*> (BloodData());
+         stakes.assign(first, first + (BloodSize() / sizeof (std::pair<void*, unsigned int>)));
+         success = true;
       }
-   }
-   if (message) {
-      zmsg_destroy(&message);
+      Digest();
    }
    if (!success) {
       stakes.clear();
@@ -289,15 +700,52 @@ bool Vampire::GetStakes(std::vector<std::pair<void*, unsigned int> >& stakes,
    return success;
 }
 
+/**
+ * Get a bundle of pointers from the rifle
+ * 
+ * The stakes are copied once, straight from the frame into a bundle from the
+ * pool.
+ * @param bundle
+ *   Set to NULL if nothing was found, otherwise the caller owns it and 
+ * should StakeBundle::Recycle it when done
+ * @return 
+ *   If something was found
+ */
+bool Vampire::GetStakes(StakeBundle*& bundle, const int timeout) {
+   bundle = NULL;
+   if (!IsPrepared()) {
+      LOG(WARNING) << "Socket uninitialized!";
+      boost::this_thread::sleep(boost::posix_time::seconds(1));
+      return false;
+   }
+   if (Feed(timeout)) {
+      if (BloodSize() < sizeof (StakeBundle::Stake)) {
+         LOG(WARNING) << "Received non-pointer message.";
+         mStats.AddInvalidMessage();
+      } else if (BloodSize() > sizeof (StakeBundle::Stake) * StakeBundle::kCapacity) {
+         LOG(WARNING) << "Received more stakes than fit in a bundle.";
+         mStats.AddInvalidMessage();
+      } else {
+         bundle = StakeBundle::Get();
+         bundle->mCount = BloodSize() / sizeof (StakeBundle::Stake);
+         memcpy(static_cast<void*> (bundle->mStakes), BloodData(), bundle->mCount * sizeof (StakeBundle::Stake));
+      }
+      Digest();
+   }
+   return (bundle != NULL);
+}
+
 /**
  * Stake our vampire.
  * @return 
  */
 void Vampire::Destroy() {
+   InprocJunction::Instance().Detach(mLocation, mInproc);
+   mShm.reset();
    if (mContext != NULL) {
       //LOG(DEBUG) << "Vampire: destroying context";
       zsocket_destroy(mContext, mBody);
-      zctx_destroy(&mContext);
+      ContextRegistry::Instance().Release(mContext);
       //zclock_sleep(mLinger * 2);
       mContext = NULL;
       mBody = NULL;
@@ -309,4 +757,5 @@ void Vampire::Destroy() {
  */
 Vampire::~Vampire() {
    Destroy();
+   zmq_msg_close(&mBlood);
 }
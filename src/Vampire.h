@@ -1,35 +1,80 @@
 #pragma once
 #include <string>
 #include <vector>
+#include <memory>
+#include <zmq.h>
 #include "CZMQToolkit.h"
+#include "Wound.h"
+#include "StakeBundle.h"
+#include "Compressor.h"
+#include "SocketStats.h"
+#include "LatencyHistogram.h"
 struct _zctx_t;
 typedef struct _zctx_t zctx_t;
+class InprocEndpoint;
+class ShmRing;
 class Vampire {
 public:
    explicit Vampire(const std::string& location);
    bool PrepareToBeShot();
    std::string GetBinding() const;
    bool GetShot(std::string& wound, const int timeout);
+   bool GetShot(Wound& wound, const int timeout);
+   bool TryGetShot(std::string& wound);
+   bool TryGetShot(Wound& wound);
+   int GetReadFd();
+   bool GetShots(std::vector<std::string>& wounds, const size_t maxCount,
+           const int timeout);
    bool GetStake(void*& stake, const int timeout=1000);
    bool GetStakeNoWait(void*& stake);
    bool GetStakes(std::vector<std::pair<void*, unsigned int> >& stakes,
            const int timeout=1000);
+   bool GetStakes(StakeBundle*& bundle, const int timeout=1000);
    int GetHighWater();
    void SetHighWater(const int hwm);
    int GetIOThreads();
    void SetIOThreads(const int count);
    void SetOwnSocket(const bool own);
    bool GetOwnSocket();
+   void SetCompression(const bool compress);
+   bool SetCompressionDictionary(const std::string& dictionary);
+   void SetCreditDispatch(const bool credit);
+   bool GetCreditDispatch();
+   SocketStats::Snapshot GetStats() const;
+   void SetLatencyTracking(const bool track);
+   const LatencyHistogram* GetLatency() const;
    virtual ~Vampire();
 protected:
    void Destroy();
+   bool IsPrepared() const;
+   bool Feed(const int timeout);
+   const char* BloodData();
+   size_t BloodSize();
+   void Digest();
 private:
+   friend class Reactor;
+   bool Drink(const int timeout);
+   void GrantCredits();
    void setIpcFilePermissions();
    std::string mLocation;
    int mHwm;
    void* mBody;
+   zmq_msg_t mBlood;
    zctx_t* mContext;
    int mLinger;
    int mIOThredCount;
    bool mOwnSocket;
+   std::shared_ptr<InprocEndpoint> mInproc;
+   std::string mInprocBlood;
+   std::unique_ptr<ShmRing> mShm;
+   const char* mShmBlood;
+   size_t mShmBloodSize;
+   std::unique_ptr<Compressor> mCompressor;
+   std::string mDecompressed;
+   bool mCreditDispatch;
+   int mOwedCredits;
+   SocketStats mStats;
+   std::unique_ptr<LatencyHistogram> mLatency;
+   bool mLatencyTracking;
+   size_t mBloodOffset;
 };
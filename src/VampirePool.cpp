@@ -0,0 +1,319 @@
+#include <algorithm>
+
+#include "VampirePool.h"
+#include "Vampire.h"
+#include "SocketStats.h"
+#include "g2log.hpp"
+
+namespace {
+   const int kReceiveTimeout = 100;
+   const int kParkTimeout = 100;
+   const int kSpinsBeforeParking = 100;
+}
+
+/**
+ * Construct a pool, nothing runs until Start.
+ * @param location
+ *   Where the Rifle is, each receiver connects its own Vampire to it
+ * @param workers
+ * @param handler
+ *   Called on a worker thread for every shot, the shot may be swapped out
+ * @param receivers
+ */
+VampirePool::VampirePool(const std::string& location, const size_t workers,
+   const Handler& handler, const size_t receivers) :
+mLocation(location),
+mWorkerCount(std::max<size_t>(1, workers)),
+mReceiverCount(std::max<size_t>(1, receivers)),
+mHandler(handler),
+mHwm(250),
+mIOThredCount(1),
+mQueueSize(1024),
+mReceiving(false),
+mWorking(false),
+mReady(0),
+mFailed(false) {
+}
+
+/**
+ * Stop and free every shot still queued.
+ */
+VampirePool::~VampirePool() {
+   Stop();
+   FreeShots();
+}
+
+/**
+ * Set the receivers' high water mark. This must be called before Start.
+ * @param hwm
+ */
+void VampirePool::SetHighWater(const int hwm) {
+   mHwm = hwm;
+}
+
+/**
+ * Set the receivers' IO thread count. This must be called before Start.
+ * @param count
+ */
+void VampirePool::SetIOThreads(const int count) {
+   mIOThredCount = count;
+}
+
+/**
+ * Set how many shots each worker can have queued before the receivers wait
+ * for room. This must be called before Start.
+ * @param size
+ */
+void VampirePool::SetQueueSize(const size_t size) {
+   mQueueSize = std::max<size_t>(1, size);
+}
+
+/**
+ * Start the workers, then the receivers.
+ * @return 
+ *   false if a receiver couldn't be prepared to be shot, the pool is stopped
+ */
+bool VampirePool::Start() {
+   if (mWorking) {
+      return true;
+   }
+   FreeShots();
+   mWorkers.clear();
+   for (size_t i = 0; i < mWorkerCount; i++) {
+      mWorkers.push_back(std::unique_ptr<Worker>(new Worker(mQueueSize)));
+   }
+   mSpares.reset(new MpmcQueue<std::string*>(mQueueSize * mWorkerCount + mReceiverCount));
+   mStarted = std::chrono::steady_clock::now();
+   mReady = 0;
+   mFailed = false;
+   mWorking = true;
+   mReceiving = true;
+   for (size_t i = 0; i < mWorkerCount; i++) {
+      mWorkers[i]->mThread = std::thread(&VampirePool::Work, this, i);
+   }
+   for (size_t i = 0; i < mReceiverCount; i++) {
+      mReceivers.push_back(std::thread(&VampirePool::Receive, this, i));
+   }
+   while (mReady < mReceiverCount && !mFailed) {
+      std::this_thread::yield();
+   }
+   if (mFailed) {
+      Stop();
+      return false;
+   }
+   return true;
+}
+
+/**
+ * Stop the receivers, let the workers finish what is queued, then stop them.
+ */
+void VampirePool::Stop() {
+   mReceiving = false;
+   for (auto it = mReceivers.begin(); it != mReceivers.end(); it++) {
+      it->join();
+   }
+   mReceivers.clear();
+   mWorking = false;
+   mWorkBell.Ring();
+   for (auto it = mWorkers.begin(); it != mWorkers.end(); it++) {
+      if ((*it)->mThread.joinable()) {
+         (*it)->mThread.join();
+      }
+   }
+}
+
+/**
+ * @return 
+ *   How many workers there are
+ */
+size_t VampirePool::GetWorkerCount() const {
+   return mWorkerCount;
+}
+
+/**
+ * @param worker
+ * @return 
+ *   What the worker has done since Start, safe to call from any thread
+ */
+VampirePool::WorkerStats VampirePool::GetWorkerStats(const size_t worker) const {
+   WorkerStats stats = {0, 0, 0, 0.0};
+   if (worker >= mWorkers.size()) {
+      return stats;
+   }
+   const Worker& working = *mWorkers[worker];
+   stats.mShots = working.mShots.load(std::memory_order_relaxed);
+   stats.mStolen = working.mStolen.load(std::memory_order_relaxed);
+   stats.mQueued = working.mQueue.Size();
+   const double elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - mStarted).count();
+   if (elapsed > 0) {
+      stats.mUtilization = std::min(1.0,
+         working.mBusyNanoseconds.load(std::memory_order_relaxed) / elapsed);
+   }
+   return stats;
+}
+
+/**
+ * Delete every shot left in the queues and the pool.
+ */
+void VampirePool::FreeShots() {
+   std::string* shot;
+   for (auto it = mWorkers.begin(); it != mWorkers.end(); it++) {
+      while ((*it)->mQueue.Pop(shot)) {
+         delete shot;
+      }
+   }
+   while (mSpares && mSpares->Pop(shot)) {
+      delete shot;
+   }
+}
+
+/**
+ * @return 
+ *   A string from the pool, or a new one if the pool is empty
+ */
+std::string* VampirePool::GetSpare() {
+   std::string* spare;
+   if (mSpares->Pop(spare)) {
+      return spare;
+   }
+   return new std::string;
+}
+
+/**
+ * Give a string back to the pool, keeping its buffer.
+ * @param shot
+ */
+void VampirePool::Recycle(std::string* shot) {
+   if (!mSpares->Push(shot)) {
+      delete shot;
+   }
+}
+
+/**
+ * Queue a shot for the next worker with room, round robin.
+ * @param shot
+ * @param next
+ *   The worker to try first, moved on past the one that took it
+ * @return 
+ *   false if every worker's queue is full
+ */
+bool VampirePool::Deal(std::string* shot, size_t& next) {
+   for (size_t i = 0; i < mWorkerCount; i++) {
+      const size_t worker = (next + i) % mWorkerCount;
+      if (mWorkers[worker]->mQueue.Push(shot)) {
+         next = (worker + 1) % mWorkerCount;
+         mWorkBell.Ring();
+         return true;
+      }
+   }
+   return false;
+}
+
+/**
+ * Take a shot from the worker's own queue, or else steal one.
+ * @param worker
+ * @param shot
+ * @param stolen
+ * @return 
+ *   false if every queue is empty
+ */
+bool VampirePool::Take(const size_t worker, std::string*& shot, bool& stolen) {
+   stolen = false;
+   if (mWorkers[worker]->mQueue.Pop(shot)) {
+      return true;
+   }
+   for (size_t i = 1; i < mWorkerCount; i++) {
+      if (mWorkers[(worker + i) % mWorkerCount]->mQueue.Pop(shot)) {
+         stolen = true;
+         return true;
+      }
+   }
+   return false;
+}
+
+/**
+ * A receiver thread, shots are dealt out as fast as the workers take them.
+ * @param receiver
+ */
+void VampirePool::Receive(const size_t receiver) {
+   Vampire vampire(mLocation);
+   vampire.SetHighWater(mHwm);
+   vampire.SetIOThreads(mIOThredCount);
+   if (!vampire.PrepareToBeShot()) {
+      LOG(WARNING) << "VampirePool receiver can't be shot at " << mLocation;
+      mFailed = true;
+      return;
+   }
+   mReady++;
+   size_t next = receiver % mWorkerCount;
+   std::string* shot = GetSpare();
+   while (mReceiving) {
+      if (!vampire.GetShot(*shot, kReceiveTimeout)) {
+         continue;
+      }
+      // every queue is full, hold the shot and let the socket back up. The
+      // workers keep going until the receivers are joined, so a shot held 
+      // when Stop comes is still dealt rather than lost
+      while (!Deal(shot, next)) {
+         std::this_thread::yield();
+      }
+      shot = GetSpare();
+   }
+   Recycle(shot);
+}
+
+/**
+ * Run the handler on a shot and count it against the worker.
+ * @param worker
+ * @param shot
+ * @param stolen
+ */
+void VampirePool::Handle(const size_t worker, std::string* shot, const bool stolen) {
+   Worker& working = *mWorkers[worker];
+   const auto start = std::chrono::steady_clock::now();
+   mHandler(*shot, worker);
+   const uint64_t busy = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start).count();
+   Recycle(shot);
+   // only this worker's thread writes its counters
+   SocketStats::Bump(working.mBusyNanoseconds, busy);
+   SocketStats::Bump(working.mShots, 1);
+   if (stolen) {
+      SocketStats::Bump(working.mStolen, 1);
+   }
+}
+
+/**
+ * A worker thread, runs until stopped and everything queued is done.
+ * @param worker
+ */
+void VampirePool::Work(const size_t worker) {
+   std::string* shot;
+   bool stolen;
+   for (int spin = 0;; spin++) {
+      if (Take(worker, shot, stolen)) {
+         Handle(worker, shot, stolen);
+         spin = 0;
+         continue;
+      }
+      if (!mWorking) {
+         return;
+      }
+      if (spin < kSpinsBeforeParking) {
+         continue;
+      }
+      const uint32_t ticket = mWorkBell.Arm();
+      if (Take(worker, shot, stolen)) {
+         mWorkBell.Disarm();
+         Handle(worker, shot, stolen);
+         spin = 0;
+         continue;
+      }
+      if (!mWorking) {
+         mWorkBell.Disarm();
+         return;
+      }
+      mWorkBell.Wait(ticket, kParkTimeout);
+   }
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MpmcQueue.h"
+#include "Doorbell.h"
+
+/**
+ * A few Vampires feeding many workers that steal from each other.
+ * 
+ * Receiver threads each take shots with their own Vampire and deal them 
+ * round robin onto the workers' queues. A worker takes from its own queue 
+ * first and steals from the others' when it runs dry, so a worker stuck on 
+ * an expensive shot doesn't hold up the cheap ones queued behind it. Idle 
+ * workers park until there is work. Shot strings are recycled through a 
+ * pool, so once the pool is warm nothing is allocated per shot.
+ * 
+ * Each worker's shots, steals and the fraction of time it spent in the 
+ * handler are kept for sizing the pool.
+ */
+class VampirePool {
+public:
+   typedef std::function<void (std::string& shot, const size_t worker)> Handler;
+
+   struct WorkerStats {
+      uint64_t mShots;
+      uint64_t mStolen;
+      size_t mQueued;
+      double mUtilization;
+   };
+
+   VampirePool(const std::string& location, const size_t workers, const Handler& handler,
+      const size_t receivers = 1);
+   virtual ~VampirePool();
+
+   void SetHighWater(const int hwm);
+   void SetIOThreads(const int count);
+   void SetQueueSize(const size_t size);
+   bool Start();
+   void Stop();
+   size_t GetWorkerCount() const;
+   WorkerStats GetWorkerStats(const size_t worker) const;
+private:
+   struct Worker {
+      explicit Worker(const size_t queueSize) : mQueue(queueSize), mShots(0),
+      mStolen(0), mBusyNanoseconds(0) {
+      }
+      MpmcQueue<std::string*> mQueue;
+      std::atomic<uint64_t> mShots;
+      std::atomic<uint64_t> mStolen;
+      std::atomic<uint64_t> mBusyNanoseconds;
+      std::thread mThread;
+   };
+   VampirePool(const VampirePool&) = delete;
+   VampirePool& operator=(const VampirePool&) = delete;
+   void Receive(const size_t receiver);
+   void Work(const size_t worker);
+   void Handle(const size_t worker, std::string* shot, const bool stolen);
+   bool Deal(std::string* shot, size_t& next);
+   bool Take(const size_t worker, std::string*& shot, bool& stolen);
+   std::string* GetSpare();
+   void Recycle(std::string* shot);
+   void FreeShots();
+
+   const std::string mLocation;
+   const size_t mWorkerCount;
+   const size_t mReceiverCount;
+   const Handler mHandler;
+   int mHwm;
+   int mIOThredCount;
+   size_t mQueueSize;
+   std::vector<std::unique_ptr<Worker> > mWorkers;
+   std::vector<std::thread> mReceivers;
+   std::unique_ptr<MpmcQueue<std::string*> > mSpares;
+   Doorbell mWorkBell;
+   std::atomic<bool> mReceiving;
+   std::atomic<bool> mWorking;
+   std::atomic<size_t> mReady;
+   std::atomic<bool> mFailed;
+   std::chrono::steady_clock::time_point mStarted;
+};
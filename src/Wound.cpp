@@ -0,0 +1,69 @@
+#include "Wound.h"
+
+/**
+ * Construct an empty wound.
+ */
+Wound::Wound() {
+   zmq_msg_init(&mFrame);
+}
+
+/**
+ * Move constructor, other is left empty.
+ * @param other
+ */
+Wound::Wound(Wound&& other) {
+   zmq_msg_init(&mFrame);
+   zmq_msg_move(&mFrame, &other.mFrame);
+}
+
+/**
+ * Free the frame if we still hold one.
+ */
+Wound::~Wound() {
+   zmq_msg_close(&mFrame);
+}
+
+/**
+ * Move assignment, any frame we held is freed and other is left empty.
+ * @param other
+ * @return 
+ *   A reference to this
+ */
+Wound& Wound::operator=(Wound&& other) {
+   if (this != &other) {
+      zmq_msg_move(&mFrame, &other.mFrame);
+   }
+   return *this;
+}
+
+/**
+ * The bytes of the shot, valid until the wound is released.
+ * @return 
+ */
+const char* Wound::data() const {
+   return reinterpret_cast<const char*> (zmq_msg_data(&mFrame));
+}
+
+/**
+ * The number of bytes in the shot.
+ * @return 
+ */
+size_t Wound::size() const {
+   return zmq_msg_size(&mFrame);
+}
+
+/**
+ * If there is no shot held.
+ * @return 
+ */
+bool Wound::empty() const {
+   return (size() == 0);
+}
+
+/**
+ * Free the frame, leaving the wound empty.
+ */
+void Wound::Release() {
+   zmq_msg_close(&mFrame);
+   zmq_msg_init(&mFrame);
+}
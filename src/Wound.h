@@ -0,0 +1,29 @@
+#pragma once
+#include <stddef.h>
+#include <zmq.h>
+
+/**
+ * A shot taken by a Vampire, still held in the zeromq frame it arrived in.
+ * 
+ * The bytes are read in place instead of being copied out. A Wound can be 
+ * moved but not copied, the frame is freed when the Wound is released or 
+ * destroyed.
+ */
+class Wound {
+public:
+   Wound();
+   Wound(Wound&& other);
+   ~Wound();
+
+   Wound& operator=(Wound&& other);
+   const char* data() const;
+   size_t size() const;
+   bool empty() const;
+   void Release();
+private:
+   friend class Vampire;
+   Wound(const Wound&) = delete;
+   Wound& operator=(const Wound&) = delete;
+
+   mutable zmq_msg_t mFrame;
+};
@@ -0,0 +1,148 @@
+#include <czmq.h>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "AlienDispatcherTests.h"
+#include "Shotgun.h"
+
+TEST_F(AlienDispatcherTests, TopicsStickToWorkers) {
+   AlienDispatcher dispatcher(GetIpcLocation(), 4, [](const std::string&, std::vector<std::string>&,
+      const size_t) {
+   });
+   EXPECT_EQ(4, dispatcher.GetWorkerCount());
+   for (int i = 0; i < 100; i++) {
+      const std::string topic = std::to_string(i);
+      EXPECT_GT(4u, dispatcher.GetWorker(topic));
+      EXPECT_EQ(dispatcher.GetWorker(topic), dispatcher.GetWorker(topic));
+   }
+   EXPECT_EQ(0, dispatcher.GetWorkerStats(0).mShots);
+}
+
+TEST_F(AlienDispatcherTests, OrderedPerTopic) {
+   std::string location = GetIpcLocation();
+   Shotgun shotgun;
+   shotgun.Aim(location);
+   std::mutex lock;
+   std::map<std::string, int> last;
+   std::map<std::string, size_t> workers;
+   std::atomic<int> handled(0);
+   std::atomic<int> outOfOrder(0);
+   std::atomic<int> wrongWorker(0);
+   AlienDispatcher dispatcher(location, 4, [&](const std::string& topic, std::vector<std::string>& bullets,
+      const size_t worker) {
+      if (topic == "probe") {
+         return;
+      }
+      const int sequence = std::stoi(bullets[0]);
+      std::lock_guard<std::mutex> guard(lock);
+      if (last.count(topic) && last[topic] + 1 != sequence) {
+         outOfOrder++;
+      }
+      last[topic] = sequence;
+      if (workers.count(topic) && workers[topic] != worker) {
+         wrongWorker++;
+      }
+      workers[topic] = worker;
+      handled++;
+   });
+   dispatcher.SetQueueSize(16);
+   ASSERT_TRUE(dispatcher.Start());
+   std::vector<std::string> bullets(1);
+   // publish until the subscription has gone through
+   for (int i = 0; i < 200 && dispatcher.GetWorkerStats(dispatcher.GetWorker("probe")).mShots == 0; i++) {
+      bullets[0] = "probe";
+      shotgun.Fire("probe", bullets);
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+   }
+   ASSERT_LT(0, dispatcher.GetWorkerStats(dispatcher.GetWorker("probe")).mShots);
+   const int topics = 16;
+   const int perTopic = 500;
+   for (int i = 0; i < perTopic; i++) {
+      bullets[0] = std::to_string(i);
+      for (int topic = 0; topic < topics; topic++) {
+         shotgun.Fire("topic" + std::to_string(topic), bullets);
+      }
+   }
+   for (int i = 0; i < 500 && handled < topics * perTopic; i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+   }
+   dispatcher.Stop();
+   EXPECT_EQ(topics * perTopic, handled);
+   EXPECT_EQ(0, outOfOrder);
+   EXPECT_EQ(0, wrongWorker);
+   EXPECT_EQ(topics, last.size());
+   uint64_t shots = 0;
+   for (size_t i = 0; i < dispatcher.GetWorkerCount(); i++) {
+      shots += dispatcher.GetWorkerStats(i).mShots;
+      EXPECT_EQ(0, dispatcher.GetWorkerStats(i).mQueued);
+   }
+   EXPECT_LE(static_cast<uint64_t> (topics * perTopic), shots);
+}
+
+TEST_F(AlienDispatcherTests, StopQueuesTheHeldShot) {
+   std::string location = GetIpcLocation();
+   Shotgun shotgun;
+   shotgun.Aim(location);
+   std::atomic<bool> open(true);
+   std::atomic<int> handled(0);
+   AlienDispatcher dispatcher(location, 1, [&](const std::string& topic, std::vector<std::string>&,
+      const size_t) {
+      while (!open) {
+         std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      if (topic == "x") {
+         handled++;
+      }
+   });
+   dispatcher.SetQueueSize(1);
+   ASSERT_TRUE(dispatcher.Start());
+   std::vector<std::string> bullets(1, "Fire!");
+   // publish until the subscription has gone through
+   for (int i = 0; i < 200 && dispatcher.GetWorkerStats(0).mShots == 0; i++) {
+      shotgun.Fire("probe", bullets);
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+   }
+   ASSERT_LT(0, dispatcher.GetWorkerStats(0).mShots);
+   std::this_thread::sleep_for(std::chrono::milliseconds(100));
+   // one shot in the handler, one in the ring and one held by the receiver
+   open = false;
+   for (int i = 0; i < 3; i++) {
+      shotgun.Fire("x", bullets);
+   }
+   std::this_thread::sleep_for(std::chrono::milliseconds(200));
+   std::thread opener([&]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      open = true;
+   });
+   dispatcher.Stop();
+   opener.join();
+   EXPECT_EQ(3, handled);
+}
+
+TEST_F(AlienDispatcherTests, SubscribeThroughTheAlien) {
+   std::string location = GetIpcLocation();
+   Shotgun shotgun;
+   shotgun.Aim(location);
+   std::atomic<int> wanted(0);
+   std::atomic<int> unwanted(0);
+   AlienDispatcher dispatcher(location, 2, [&](const std::string& topic, std::vector<std::string>&,
+      const size_t) {
+      if (topic == "wanted") {
+         wanted++;
+      } else {
+         unwanted++;
+      }
+   });
+   dispatcher.GetAlien().Subscribe("wanted");
+   ASSERT_TRUE(dispatcher.Start());
+   std::vector<std::string> bullets(1, "Fire!");
+   for (int i = 0; i < 200 && wanted < 10; i++) {
+      shotgun.Fire("unwanted", bullets);
+      shotgun.Fire("wanted", bullets);
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+   }
+   dispatcher.Stop();
+   EXPECT_LE(10, wanted);
+   EXPECT_EQ(0, unwanted);
+}
@@ -0,0 +1,166 @@
+#include <czmq.h>
+
+#include "AwaitLoopTests.h"
+#include "Rifle.h"
+#include "Vampire.h"
+#include "Crowbar.h"
+#include "Headcrab.h"
+#include "BoomStick.h"
+#include "MockSkelleton.h"
+
+namespace {
+
+   Task TakeShots(AwaitLoop& loop, Vampire& vampire, const int count, int& taken) {
+      std::string wound;
+      for (int i = 0; i < count; i++) {
+         if (!co_await loop.Shot(vampire, wound, 1000)) {
+            break;
+         }
+         EXPECT_EQ(std::to_string(i), wound);
+         taken++;
+      }
+      loop.Stop();
+   }
+
+   Task WaitInVain(AwaitLoop& loop, Vampire& vampire, bool& finished, bool& shot) {
+      std::string wound;
+      shot = co_await loop.Shot(vampire, wound, 10);
+      finished = true;
+   }
+
+   Task SwingAway(AwaitLoop& loop, Crowbar& crowbar, std::string& guts) {
+      co_await loop.Swing(crowbar, "hit", guts, 1000);
+      loop.Stop();
+   }
+
+   Task RequestReply(AwaitLoop& loop, BoomStick& boomStick, const int id, int& replies) {
+      std::string reply;
+      const std::string request = "request " + std::to_string(id);
+      if (co_await loop.Request(boomStick, request, reply, 1000)) {
+         EXPECT_EQ(request + " reply", reply);
+         replies++;
+      }
+   }
+}
+
+TEST_F(AwaitLoopTests, ShotsWithoutAThread) {
+   std::string location = GetIpcLocation();
+   Rifle rifle(location);
+   rifle.SetOwnSocket(true);
+   ASSERT_TRUE(rifle.Aim());
+   Vampire vampire(location);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+
+   AwaitLoop loop;
+   int taken = 0;
+   TakeShots(loop, vampire, 10, taken);
+   EXPECT_EQ(1, loop.GetWaitingCount());
+   for (int i = 0; i < 10; i++) {
+      ASSERT_TRUE(rifle.Fire(std::to_string(i), 500));
+   }
+   loop.Run();
+   EXPECT_EQ(10, taken);
+   EXPECT_EQ(0, loop.GetWaitingCount());
+}
+
+TEST_F(AwaitLoopTests, TimesOut) {
+   std::string location = GetIpcLocation();
+   Rifle rifle(location);
+   rifle.SetOwnSocket(true);
+   ASSERT_TRUE(rifle.Aim());
+   Vampire vampire(location);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+
+   AwaitLoop loop;
+   bool finished = false;
+   bool shot = true;
+   WaitInVain(loop, vampire, finished, shot);
+   EXPECT_FALSE(finished);
+   for (int i = 0; i < 100 && !finished; i++) {
+      loop.Poll(10);
+   }
+   EXPECT_TRUE(finished);
+   EXPECT_FALSE(shot);
+   EXPECT_EQ(0, loop.GetWaitingCount());
+}
+
+TEST_F(AwaitLoopTests, NativeTransportsCantBeAwaited) {
+   std::string location("inproc://awaitlooptest");
+   Rifle rifle(location);
+   ASSERT_TRUE(rifle.Aim());
+   Vampire vampire(location);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+
+   AwaitLoop loop;
+   bool finished = false;
+   bool shot = true;
+   WaitInVain(loop, vampire, finished, shot);
+   EXPECT_TRUE(finished);
+   EXPECT_FALSE(shot);
+}
+
+TEST_F(AwaitLoopTests, SwingForAKill) {
+   std::string location = GetIpcLocation();
+   Headcrab headcrab(location);
+   ASSERT_TRUE(headcrab.ComeToLife());
+   Crowbar crowbar(headcrab);
+   ASSERT_TRUE(crowbar.Wield());
+
+   AwaitLoop loop;
+   // the headcrab is served from the same thread by a reactor of its own
+   Reactor reactor;
+   ASSERT_TRUE(reactor.Add(headcrab, [](Headcrab & hit) {
+      std::string theHit;
+      if (hit.GetHitWait(theHit, 0)) {
+         hit.SendSplatter(theHit + " splat");
+      }
+   }));
+   std::string guts;
+   SwingAway(loop, crowbar, guts);
+   for (int i = 0; i < 100 && guts.empty(); i++) {
+      reactor.Poll(1);
+      loop.Poll(1);
+   }
+   EXPECT_EQ("hit splat", guts);
+}
+
+#ifdef LR_DEBUG
+
+TEST_F(AwaitLoopTests, ManyRequestsInFlight) {
+   std::string location = GetIpcLocation();
+   MockSkelleton target{location};
+   ASSERT_TRUE(target.Initialize());
+   target.BeginListenAndRepeat();
+   BoomStick boomStick{location};
+   ASSERT_TRUE(boomStick.Initialize());
+
+   AwaitLoop loop;
+   int replies = 0;
+   const int requests = 1000;
+   for (int i = 0; i < requests; i++) {
+      RequestReply(loop, boomStick, i, replies);
+   }
+   for (int i = 0; i < 1000 && loop.GetWaitingCount() > 0; i++) {
+      loop.Poll(10);
+   }
+   EXPECT_EQ(requests, replies);
+   EXPECT_EQ(0, loop.GetWaitingCount());
+   target.EndListendAndRepeat();
+}
+#endif
+
+TEST_F(AwaitLoopTests, WaitersAreDestroyedWithTheLoop) {
+   std::string location = GetIpcLocation();
+   Rifle rifle(location);
+   rifle.SetOwnSocket(true);
+   ASSERT_TRUE(rifle.Aim());
+   Vampire vampire(location);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   int taken = 0;
+   {
+      AwaitLoop loop;
+      TakeShots(loop, vampire, 1, taken);
+      EXPECT_EQ(1, loop.GetWaitingCount());
+   }
+   EXPECT_EQ(0, taken);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include <unistd.h>
+#include <string>
+#include "AwaitLoop.h"
+
+class AwaitLoopTests : public ::testing::Test {
+public:
+
+   AwaitLoopTests() {
+   };
+
+   static std::string GetIpcLocation() {
+      std::string location("ipc:///tmp/awaitlooptest");
+      location.append(std::to_string(getpid()));
+      location.append("_");
+      location.append(std::to_string(rand()));
+      return location;
+   }
+
+protected:
+
+   virtual void SetUp() {
+      zctx_interrupted = false;
+   };
+
+   virtual void TearDown() {
+   };
+private:
+
+};
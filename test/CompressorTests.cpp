@@ -0,0 +1,182 @@
+#include <czmq.h>
+
+#include "CompressorTests.h"
+#include "Rifle.h"
+#include "Vampire.h"
+
+TEST_F(CompressorTests, SmallBulletsAreNotCompressed) {
+   Compressor compressor(256);
+   std::string bullet("short");
+   std::string frame;
+   compressor.Compress(bullet.data(), bullet.size(), frame);
+   EXPECT_EQ(bullet.size() + 1, frame.size());
+   EXPECT_EQ(0, compressor.GetCompressedCount());
+   std::string unframed;
+   EXPECT_TRUE(compressor.Decompress(frame.data(), frame.size(), unframed));
+   EXPECT_EQ(bullet, unframed);
+}
+
+TEST_F(CompressorTests, RoundTrip) {
+   Compressor sender(64);
+   Compressor receiver;
+   std::string frame;
+   std::string unframed;
+   for (int i = 0; i < 1000; i++) {
+      // a batch of records, a single one barely compresses without a dictionary
+      std::string bullet = MakeMetadata(i) + MakeMetadata(i + 1) + MakeMetadata(i + 2);
+      sender.Compress(bullet.data(), bullet.size(), frame);
+      ASSERT_TRUE(receiver.Decompress(frame.data(), frame.size(), unframed));
+      ASSERT_EQ(bullet, unframed);
+   }
+   EXPECT_EQ(1000, sender.GetCompressedCount());
+   EXPECT_LT(1.2, sender.GetRatio());
+   EXPECT_FALSE(sender.IsBackedOff());
+}
+
+TEST_F(CompressorTests, BacksOffWhenItDoesntPay) {
+   Compressor sender(64);
+   Compressor receiver;
+   std::string frame;
+   std::string unframed;
+   for (int i = 0; i < 100; i++) {
+      std::string bullet = MakeNoise(1000);
+      sender.Compress(bullet.data(), bullet.size(), frame);
+      ASSERT_TRUE(receiver.Decompress(frame.data(), frame.size(), unframed));
+      ASSERT_EQ(bullet, unframed);
+   }
+   EXPECT_TRUE(sender.IsBackedOff());
+   EXPECT_EQ(0, sender.GetCompressedCount());
+   // noise never gets smaller so it is always sent raw
+   std::string bullet = MakeMetadata(1);
+   sender.Compress(bullet.data(), bullet.size(), frame);
+   EXPECT_EQ(bullet.size() + 1, frame.size());
+}
+
+TEST_F(CompressorTests, TrainedDictionary) {
+   std::vector<std::string> samples;
+   for (int i = 0; i < 100; i++) {
+      samples.push_back(MakeMetadata(i));
+   }
+   std::string dictionary = Compressor::TrainDictionary(samples, 1024);
+   EXPECT_FALSE(dictionary.empty());
+   EXPECT_GE(1024, dictionary.size());
+
+   Compressor plain(64);
+   Compressor trained(64);
+   ASSERT_TRUE(trained.SetDictionary(dictionary));
+   Compressor receiver;
+   ASSERT_TRUE(receiver.SetDictionary(dictionary));
+   std::string bullet = MakeMetadata(5000);
+   std::string plainFrame;
+   std::string trainedFrame;
+   plain.Compress(bullet.data(), bullet.size(), plainFrame);
+   trained.Compress(bullet.data(), bullet.size(), trainedFrame);
+   EXPECT_LT(trainedFrame.size(), plainFrame.size());
+   std::string unframed;
+   ASSERT_TRUE(receiver.Decompress(trainedFrame.data(), trainedFrame.size(), unframed));
+   EXPECT_EQ(bullet, unframed);
+
+   Compressor noDictionary;
+   EXPECT_FALSE(noDictionary.Decompress(trainedFrame.data(), trainedFrame.size(), unframed));
+   EXPECT_FALSE(trained.SetDictionary(std::string(64 * 1024, 'x')));
+}
+
+TEST_F(CompressorTests, BigDictionary) {
+   std::vector<std::string> samples;
+   for (int i = 0; i < 1000; i++) {
+      samples.push_back(MakeMetadata(i));
+   }
+   // big enough that each bullet starts from a copy of the primed stream
+   std::string dictionary = Compressor::TrainDictionary(samples, 16 * 1024);
+   ASSERT_LT(4 * 1024, dictionary.size());
+   Compressor sender(64);
+   ASSERT_TRUE(sender.SetDictionary(dictionary));
+   Compressor receiver;
+   ASSERT_TRUE(receiver.SetDictionary(dictionary));
+   std::string frame;
+   std::string unframed;
+   for (int i = 0; i < 10; i++) {
+      std::string bullet = MakeMetadata(5000 + i);
+      sender.Compress(bullet.data(), bullet.size(), frame);
+      EXPECT_GT(bullet.size(), frame.size());
+      ASSERT_TRUE(receiver.Decompress(frame.data(), frame.size(), unframed));
+      EXPECT_EQ(bullet, unframed);
+   }
+   EXPECT_EQ(10, sender.GetCompressedCount());
+}
+
+TEST_F(CompressorTests, CorruptFrames) {
+   Compressor compressor;
+   std::string unframed;
+   EXPECT_FALSE(compressor.Decompress("", 0, unframed));
+   std::string frame("\x01\x10\x00\x00\x00garbage", 12);
+   EXPECT_FALSE(compressor.Decompress(frame.data(), frame.size(), unframed));
+   frame[0] = 7;
+   EXPECT_FALSE(compressor.Decompress(frame.data(), frame.size(), unframed));
+
+   // sizes that deflate could never have produced are rejected up front
+   std::string huge("\x01\xff\xff\xff\xffgarbage", 12);
+   EXPECT_FALSE(compressor.Decompress(huge.data(), huge.size(), unframed));
+   EXPECT_GT(1024u, unframed.capacity());
+   Compressor small(64, Compressor::kDefaultMinimumRatio, Z_BEST_SPEED, 1024);
+   std::string packed;
+   std::string bullet(4096, 'a');
+   Compressor sender(64);
+   sender.Compress(bullet.data(), bullet.size(), packed);
+   EXPECT_FALSE(small.Decompress(packed.data(), packed.size(), unframed));
+   Compressor receiver;
+   EXPECT_TRUE(receiver.Decompress(packed.data(), packed.size(), unframed));
+   EXPECT_EQ(bullet, unframed);
+}
+
+TEST_F(CompressorTests, RifleAndVampireOverTcp) {
+   std::string location = GetTcpLocation();
+   Rifle rifle(location);
+   Vampire vampire(location);
+   EXPECT_FALSE(rifle.SetCompressionDictionary("dictionary"));
+   rifle.SetCompression(true, 64);
+   vampire.SetCompression(true);
+   std::vector<std::string> samples;
+   for (int i = 0; i < 100; i++) {
+      samples.push_back(MakeMetadata(i));
+   }
+   std::string dictionary = Compressor::TrainDictionary(samples);
+   ASSERT_TRUE(rifle.SetCompressionDictionary(dictionary));
+   ASSERT_TRUE(vampire.SetCompressionDictionary(dictionary));
+   ASSERT_TRUE(rifle.Aim());
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   zclock_sleep(100);
+
+   std::string wound;
+   for (int i = 0; i < 100; i++) {
+      std::string bullet = MakeMetadata(i);
+      ASSERT_TRUE(rifle.Fire(bullet, 100));
+      ASSERT_TRUE(vampire.GetShot(wound, 100));
+      ASSERT_EQ(bullet, wound);
+   }
+   EXPECT_LT(1.2, rifle.GetCompressionRatio());
+
+   std::vector<std::string> volley(10, MakeMetadata(1));
+   volley.push_back("small");
+   EXPECT_EQ(volley.size(), rifle.FireBatch(volley, 100));
+   std::vector<std::string> wounds;
+   std::vector<std::string> arrived;
+   const int64_t deadline = zclock_time() + 1000;
+   while (arrived.size() < volley.size() && zclock_time() < deadline) {
+      if (vampire.GetShots(wounds, 100, 100)) {
+         arrived.insert(arrived.end(), wounds.begin(), wounds.end());
+      }
+   }
+   EXPECT_EQ(volley, arrived);
+
+   Wound held;
+   EXPECT_TRUE(rifle.Fire(MakeMetadata(2), 100));
+   EXPECT_TRUE(vampire.GetShot(held, 100));
+   EXPECT_EQ(MakeMetadata(2), std::string(held.data(), held.size()));
+
+   // stakes are never compressed
+   EXPECT_TRUE(rifle.FireStake(&wound, 100));
+   void* stake = NULL;
+   EXPECT_TRUE(vampire.GetStake(stake, 100));
+   EXPECT_EQ(&wound, stake);
+}
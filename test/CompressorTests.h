@@ -0,0 +1,54 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "Compressor.h"
+
+class CompressorTests : public ::testing::Test {
+public:
+
+   CompressorTests() {
+   };
+
+   /**
+    * Something shaped like our DPI metadata, it compresses well.
+    */
+   static std::string MakeMetadata(const int id) {
+      std::string metadata("{\"application\":\"http\",\"family\":\"web\",\"flowId\":");
+      metadata.append(std::to_string(id));
+      metadata.append(",\"sourceIp\":\"10.1.");
+      metadata.append(std::to_string(id % 255));
+      metadata.append(".1\",\"destinationIp\":\"192.168.0.1\",\"uri\":\"/index.html\","
+         "\"userAgent\":\"Mozilla/5.0 (X11; Linux x86_64)\",\"sessionLength\":");
+      metadata.append(std::to_string(id * 7));
+      metadata.append("}");
+      return metadata;
+   }
+
+   static std::string MakeNoise(const size_t size) {
+      std::string noise(size, '\0');
+      for (size_t i = 0; i < size; i++) {
+         noise[i] = static_cast<char> (random());
+      }
+      return noise;
+   }
+
+   static std::string GetTcpLocation() {
+      int port = (rand() % 2000) + 7000;
+      std::string location("tcp://127.0.0.1:");
+      location.append(std::to_string(port));
+      return location;
+   }
+
+protected:
+
+   virtual void SetUp() {
+   };
+
+   virtual void TearDown() {
+   };
+private:
+
+};
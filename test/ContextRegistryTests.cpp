@@ -0,0 +1,120 @@
+#include <czmq.h>
+#include <thread>
+
+#include "ContextRegistryTests.h"
+#include "Rifle.h"
+#include "Vampire.h"
+#include "Shotgun.h"
+#include "Alien.h"
+#include "Headcrab.h"
+#include "Crowbar.h"
+
+/**
+ * Used to call shutdown just for test.
+ * @param location
+ */
+class SharedRifle : public Rifle {
+public:
+
+   explicit SharedRifle(std::string location) : Rifle(location) {
+   }
+
+   void Destroy() {
+      Rifle::Destroy();
+   }
+};
+
+TEST_F(ContextRegistryTests, NotSharedByDefault) {
+   ContextRegistry& registry = ContextRegistry::Instance();
+   EXPECT_FALSE(registry.IsShared());
+   zctx_t* context = registry.Acquire(1);
+   ASSERT_NE(nullptr, context);
+   EXPECT_EQ(0, registry.GetSharedReferences());
+   registry.Release(context);
+   EXPECT_EQ(nullptr, context);
+}
+
+TEST_F(ContextRegistryTests, BadConfiguration) {
+   ContextRegistry& registry = ContextRegistry::Instance();
+   EXPECT_FALSE(registry.Share(0));
+   std::vector<std::vector<int> > noContexts;
+   EXPECT_FALSE(registry.Share(1, noContexts));
+   EXPECT_FALSE(registry.IsShared());
+}
+
+TEST_F(ContextRegistryTests, SharedContextsAreCounted) {
+   ContextRegistry& registry = ContextRegistry::Instance();
+   ASSERT_TRUE(registry.Share(1));
+   EXPECT_TRUE(registry.IsShared());
+   zctx_t* first = registry.Acquire(4);
+   zctx_t* second = registry.Acquire(4);
+   ASSERT_NE(nullptr, first);
+   ASSERT_NE(nullptr, second);
+   EXPECT_NE(first, second);
+   EXPECT_EQ(2, registry.GetSharedReferences());
+   // can't be reconfigured while in use
+   EXPECT_FALSE(registry.Share(2));
+   EXPECT_FALSE(registry.StopSharing());
+   registry.Release(first);
+   EXPECT_EQ(1, registry.GetSharedReferences());
+   registry.Release(second);
+   EXPECT_EQ(0, registry.GetSharedReferences());
+   EXPECT_TRUE(registry.StopSharing());
+   EXPECT_FALSE(registry.IsShared());
+}
+
+/**
+ * inproc Rifles and Vampires don't use zeromq, so this goes over ipc.
+ */
+TEST_F(ContextRegistryTests, RifleAndVampireShare) {
+   ContextRegistry& registry = ContextRegistry::Instance();
+   ASSERT_TRUE(registry.Share(1));
+   std::string location = GetIpcLocation();
+   {
+      SharedRifle rifle(location);
+      rifle.SetOwnSocket(true);
+      Vampire vampire(location);
+      ASSERT_TRUE(rifle.Aim());
+      ASSERT_TRUE(vampire.PrepareToBeShot());
+      EXPECT_EQ(2, registry.GetSharedReferences());
+      zclock_sleep(100);
+      std::string msg("woo");
+      EXPECT_TRUE(rifle.Fire(msg, 100));
+      std::string bullet;
+      EXPECT_TRUE(vampire.GetShot(bullet, 100));
+      EXPECT_EQ(msg, bullet);
+
+      // Destroy gives back the context and can be aimed again
+      rifle.Destroy();
+      EXPECT_EQ(1, registry.GetSharedReferences());
+      ASSERT_TRUE(rifle.Aim());
+      EXPECT_EQ(2, registry.GetSharedReferences());
+   }
+   EXPECT_EQ(0, registry.GetSharedReferences());
+}
+
+TEST_F(ContextRegistryTests, EveryWrapperShares) {
+   ContextRegistry& registry = ContextRegistry::Instance();
+   std::vector<std::vector<int> > cpus(2);
+   cpus[0].push_back(0);
+   ASSERT_TRUE(registry.Share(1, cpus));
+   {
+      Rifle rifle(GetInprocLocation() + "_native");
+      ASSERT_TRUE(rifle.Aim());
+      EXPECT_EQ(0, registry.GetSharedReferences());
+      Shotgun shotgun;
+      Alien alien;
+      EXPECT_EQ(2, registry.GetSharedReferences());
+      Headcrab headcrab(GetInprocLocation());
+      ASSERT_TRUE(headcrab.ComeToLife());
+      Crowbar crowbar(GetInprocLocation());
+      ASSERT_TRUE(crowbar.Wield());
+      EXPECT_EQ(4, registry.GetSharedReferences());
+      std::string hit("whack");
+      EXPECT_TRUE(crowbar.Swing(hit));
+      std::string gotHit;
+      EXPECT_TRUE(headcrab.GetHitWait(gotHit, 100));
+      EXPECT_EQ(hit, gotHit);
+   }
+   EXPECT_EQ(0, registry.GetSharedReferences());
+}
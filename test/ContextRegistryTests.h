@@ -0,0 +1,38 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include <unistd.h>
+#include <string>
+#include "ContextRegistry.h"
+
+class ContextRegistryTests : public ::testing::Test {
+public:
+
+   ContextRegistryTests() {
+   };
+
+   static std::string GetInprocLocation() {
+      std::string location("inproc://ContextRegistryTests");
+      location.append(std::to_string(getpid()));
+      return location;
+   }
+
+   static std::string GetIpcLocation() {
+      std::string location("ipc:///tmp/ContextRegistryTests");
+      location.append(std::to_string(getpid()));
+      location.append(".ipc");
+      return location;
+   }
+
+protected:
+
+   virtual void SetUp() {
+      zctx_interrupted = false;
+   };
+
+   virtual void TearDown() {
+      ContextRegistry::Instance().StopSharing();
+   };
+private:
+
+};
@@ -0,0 +1,93 @@
+#include <czmq.h>
+
+#include "CovenTests.h"
+#include "Rifle.h"
+
+TEST_F(CovenTests, NoSources) {
+   Coven coven;
+   std::string wound;
+   EXPECT_FALSE(coven.GetShot(wound, 1));
+   EXPECT_FALSE(coven.Connect("inproc://CovenTests"));
+   EXPECT_FALSE(coven.Connect("shm://CovenTests"));
+   EXPECT_EQ(0, coven.GetSourceCount());
+   EXPECT_EQ(0, coven.GetShotCount(3));
+}
+
+TEST_F(CovenTests, EveryRifleOwnsItsSocket) {
+   Rifle rifle0(GetIpcLocation(0));
+   Rifle rifle1(GetIpcLocation(1));
+   ASSERT_TRUE(rifle0.Aim());
+   ASSERT_TRUE(rifle1.Aim());
+   Coven coven;
+   ASSERT_TRUE(coven.Connect(GetIpcLocation(0)));
+   ASSERT_TRUE(coven.Connect(GetIpcLocation(1)));
+   EXPECT_EQ(2, coven.GetSourceCount());
+   EXPECT_EQ(GetIpcLocation(1), coven.GetSourceLocation(1));
+   zclock_sleep(100);
+
+   std::string wound;
+   size_t source = 99;
+   EXPECT_FALSE(coven.GetShot(wound, source, 1));
+   EXPECT_TRUE(rifle1.Fire("one", 100));
+   EXPECT_TRUE(coven.GetShot(wound, source, 100));
+   EXPECT_EQ("one", wound);
+   EXPECT_EQ(1, source);
+   EXPECT_TRUE(rifle0.Fire("zero", 100));
+   EXPECT_TRUE(coven.GetShot(wound, source, 100));
+   EXPECT_EQ("zero", wound);
+   EXPECT_EQ(0, source);
+   EXPECT_EQ(1, coven.GetShotCount(0));
+   EXPECT_EQ(1, coven.GetShotCount(1));
+}
+
+TEST_F(CovenTests, HotRifleDoesntStarveTheOthers) {
+   Rifle hot(GetIpcLocation(0));
+   Rifle cold(GetIpcLocation(1));
+   ASSERT_TRUE(hot.Aim());
+   ASSERT_TRUE(cold.Aim());
+   Coven coven;
+   ASSERT_TRUE(coven.Connect(GetIpcLocation(0)));
+   ASSERT_TRUE(coven.Connect(GetIpcLocation(1)));
+   zclock_sleep(100);
+   for (int i = 0; i < 100; i++) {
+      ASSERT_TRUE(hot.Fire("hot", 100));
+   }
+   for (int i = 0; i < 10; i++) {
+      ASSERT_TRUE(cold.Fire("cold", 100));
+   }
+   zclock_sleep(100);
+   std::string wound;
+   int coldSeen = 0;
+   for (int i = 0; i < 20; i++) {
+      ASSERT_TRUE(coven.GetShot(wound, 100));
+      if (wound == "cold") {
+         coldSeen++;
+      }
+   }
+   // they take turns
+   EXPECT_EQ(10, coldSeen);
+   EXPECT_EQ(10, coven.GetShotCount(0));
+   EXPECT_EQ(10, coven.GetShotCount(1));
+}
+
+TEST_F(CovenTests, WeightedSources) {
+   Rifle heavy(GetIpcLocation(0));
+   Rifle light(GetIpcLocation(1));
+   ASSERT_TRUE(heavy.Aim());
+   ASSERT_TRUE(light.Aim());
+   Coven coven;
+   ASSERT_TRUE(coven.Connect(GetIpcLocation(0), 3));
+   ASSERT_TRUE(coven.Connect(GetIpcLocation(1), 1));
+   zclock_sleep(100);
+   for (int i = 0; i < 30; i++) {
+      ASSERT_TRUE(heavy.Fire("heavy", 100));
+      ASSERT_TRUE(light.Fire("light", 100));
+   }
+   zclock_sleep(100);
+   std::string wound;
+   for (int i = 0; i < 40; i++) {
+      ASSERT_TRUE(coven.GetShot(wound, 100));
+   }
+   EXPECT_EQ(30, coven.GetShotCount(0));
+   EXPECT_EQ(10, coven.GetShotCount(1));
+}
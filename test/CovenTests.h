@@ -0,0 +1,32 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include <unistd.h>
+#include <string>
+#include "Coven.h"
+
+class CovenTests : public ::testing::Test {
+public:
+
+   CovenTests() {
+   };
+
+   static std::string GetIpcLocation(const int index) {
+      std::string location("ipc:///tmp/CovenTests");
+      location.append(std::to_string(getpid()));
+      location.append("_");
+      location.append(std::to_string(index));
+      location.append(".ipc");
+      return location;
+   }
+
+protected:
+
+   virtual void SetUp() {
+   };
+
+   virtual void TearDown() {
+   };
+private:
+
+};
@@ -1,6 +1,7 @@
 
 #include <czmq.h>
 #include <boost/thread.hpp>
+#include <sys/epoll.h>
 
 #include "CrowbarHeadcrabTests.h"
 #include "Death.h"
@@ -356,3 +357,41 @@ TEST_F(CrowbarHeadcrabTests, DISABLED_CrowbarSpeedTest) {
    theSender.join();
 
 }
+
+TEST_F(CrowbarHeadcrabTests, EpollOnReadFd) {
+   Headcrab target(mTarget);
+   EXPECT_EQ(-1, target.GetReadFd());
+   std::string hit;
+   EXPECT_FALSE(target.TryGetHit(hit));
+   ASSERT_TRUE(target.ComeToLife());
+   const int fd = target.GetReadFd();
+   ASSERT_LE(0, fd);
+   EXPECT_EQ(fd, target.GetWriteFd());
+   int epollFd = epoll_create1(0);
+   ASSERT_LE(0, epollFd);
+   struct epoll_event event;
+   event.events = EPOLLIN | EPOLLET;
+   event.data.fd = fd;
+   ASSERT_EQ(0, epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event));
+   EXPECT_FALSE(target.TryGetHit(hit));
+
+   Crowbar shooter(target);
+   ASSERT_TRUE(shooter.Wield());
+   for (int i = 0; i < 10; i++) {
+      ASSERT_TRUE(shooter.Swing(std::to_string(i)));
+      bool gotHit = false;
+      for (int waits = 0; waits < 100 && !gotHit; waits++) {
+         gotHit = target.TryGetHit(hit);
+         if (!gotHit) {
+            struct epoll_event ready;
+            epoll_wait(epollFd, &ready, 1, 10);
+         }
+      }
+      ASSERT_TRUE(gotHit);
+      EXPECT_EQ(std::to_string(i), hit);
+      EXPECT_TRUE(target.SendSplatter("splat"));
+      std::string guts;
+      ASSERT_TRUE(shooter.WaitForKill(guts, 500));
+   }
+   close(epollFd);
+}
@@ -0,0 +1,65 @@
+#include <czmq.h>
+#include <thread>
+
+#include "ForwarderTests.h"
+#include "Shotgun.h"
+#include "Alien.h"
+
+TEST_F(ForwarderTests, StartAndStop) {
+   Forwarder forwarder(GetIpcLocation(), GetIpcLocation());
+   EXPECT_TRUE(forwarder.Start());
+   EXPECT_TRUE(forwarder.Start());
+   forwarder.Stop();
+   EXPECT_TRUE(forwarder.Start());
+   forwarder.Stop();
+   EXPECT_EQ(0, forwarder.GetStats().mMessages);
+}
+
+TEST_F(ForwarderTests, FailedStartKeepsNoSockets) {
+   Forwarder forwarder(GetIpcLocation(), "bogus://nowhere");
+   EXPECT_FALSE(forwarder.Start());
+   // a half made Forwarder must not pass for a started one
+   EXPECT_FALSE(forwarder.Start());
+}
+
+TEST_F(ForwarderTests, FanOutWithTopics) {
+   std::string upstream = GetIpcLocation();
+   std::string downstream = GetIpcLocation();
+   Shotgun shotgun;
+   shotgun.Aim(upstream);
+   Forwarder forwarder(upstream, downstream);
+   forwarder.SetCpu(0);
+   ASSERT_TRUE(forwarder.Start());
+   Alien prices;
+   prices.Subscribe("prices");
+   prices.PrepareToBeShot(downstream);
+   Alien everything;
+   everything.PrepareToBeShot(downstream);
+
+   std::vector<std::string> bullets(1, "Fire!");
+   std::vector<std::string> shots;
+   std::string topic;
+   int pricesShot = 0;
+   int everythingShot = 0;
+   // publish until the subscriptions have gone all the way up
+   for (int i = 0; i < 200 && (pricesShot < 10 || everythingShot < 10); i++) {
+      shotgun.Fire("prices", bullets);
+      shotgun.Fire("news", bullets);
+      for (prices.GetShot(10, topic, shots); !shots.empty(); prices.GetShot(0, topic, shots)) {
+         EXPECT_EQ("prices", topic);
+         pricesShot++;
+      }
+      for (everything.GetShot(0, topic, shots); !shots.empty(); everything.GetShot(0, topic, shots)) {
+         ASSERT_EQ(1, shots.size());
+         EXPECT_EQ("Fire!", shots[0]);
+         everythingShot++;
+      }
+   }
+   EXPECT_LE(10, pricesShot);
+   EXPECT_LE(10, everythingShot);
+   // each shot goes through the forwarder once, however many Aliens get it
+   EXPECT_GE(shotgun.GetStats().mMessages, forwarder.GetStats().mMessages);
+   EXPECT_LE(static_cast<uint64_t> (everythingShot), forwarder.GetStats().mMessages);
+   EXPECT_LE(2, forwarder.GetSubscriptionStats().mMessages);
+   forwarder.Stop();
+}
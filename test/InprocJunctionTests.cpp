@@ -0,0 +1,237 @@
+#include <thread>
+#include <set>
+
+#include "InprocJunctionTests.h"
+#include "SpscRing.h"
+#include "Rifle.h"
+#include "Vampire.h"
+std::atomic<int> InprocJunctionTests::mLocationCount(0);
+std::atomic<int> InprocJunctionTests::mShotsDeleted(0);
+
+namespace {
+
+   void DeleteInprocShot(void*, void* data) {
+      delete reinterpret_cast<std::string*> (data);
+      InprocJunctionTests::mShotsDeleted++;
+   }
+}
+
+TEST_F(InprocJunctionTests, RingSwapsInAndOut) {
+   SpscRing<std::string> ring(3);
+   EXPECT_EQ(4, ring.Capacity());
+   std::string item;
+   EXPECT_FALSE(ring.Pop(item));
+   for (int i = 0; i < 4; i++) {
+      item = std::to_string(i);
+      EXPECT_TRUE(ring.Push(item));
+   }
+   item = "full";
+   EXPECT_FALSE(ring.Push(item));
+   EXPECT_EQ("full", item);
+   EXPECT_EQ(4, ring.Size());
+   for (int i = 0; i < 4; i++) {
+      EXPECT_TRUE(ring.Pop(item));
+      EXPECT_EQ(std::to_string(i), item);
+   }
+   EXPECT_FALSE(ring.Pop(item));
+   EXPECT_EQ(0, ring.Size());
+}
+
+TEST_F(InprocJunctionTests, RingAcrossThreads) {
+   SpscRing<size_t> ring(64);
+   const size_t count = 1000000;
+   std::thread producer([&ring, count]() {
+      for (size_t i = 1; i <= count; i++) {
+         size_t item = i;
+         while (!ring.Push(item)) {
+            std::this_thread::yield();
+         }
+      }
+   });
+   size_t expected = 1;
+   while (expected <= count) {
+      size_t item = 0;
+      if (ring.Pop(item)) {
+         ASSERT_EQ(expected, item);
+         expected++;
+      }
+   }
+   producer.join();
+}
+
+TEST_F(InprocJunctionTests, OneRifleOneVampire) {
+   std::string location = GetInprocLocation();
+   Rifle rifle(location);
+   Vampire vampire(location);
+   ASSERT_TRUE(rifle.Aim());
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   EXPECT_EQ(1, InprocJunction::Instance().GetPipeCount(location));
+
+   std::string bullet("bang");
+   std::string wound;
+   EXPECT_FALSE(vampire.GetShot(wound, 1));
+   EXPECT_TRUE(rifle.Fire(bullet, 100));
+   EXPECT_TRUE(vampire.GetShot(wound, 100));
+   EXPECT_EQ(bullet, wound);
+
+   EXPECT_TRUE(rifle.FireStake(&bullet, 100));
+   void* stake = NULL;
+   EXPECT_TRUE(vampire.GetStake(stake, 100));
+   EXPECT_EQ(&bullet, stake);
+
+   std::vector<std::pair<void*, unsigned int> > stakes;
+   stakes.push_back(std::make_pair(&bullet, 1));
+   stakes.push_back(std::make_pair(&wound, 2));
+   EXPECT_TRUE(rifle.FireStakes(stakes, 100));
+   std::vector<std::pair<void*, unsigned int> > gotStakes;
+   EXPECT_TRUE(vampire.GetStakes(gotStakes, 100));
+   EXPECT_EQ(stakes, gotStakes);
+
+   Wound held;
+   EXPECT_TRUE(rifle.Fire(bullet, 100));
+   EXPECT_TRUE(vampire.GetShot(held, 100));
+   EXPECT_EQ(bullet, std::string(held.data(), held.size()));
+}
+
+TEST_F(InprocJunctionTests, ZeroCopyAndBatches) {
+   std::string location = GetInprocLocation();
+   Rifle rifle(location);
+   Vampire vampire(location);
+   ASSERT_TRUE(rifle.Aim());
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+
+   std::string* zero = new std::string(100, 'z');
+   EXPECT_TRUE(rifle.FireZeroCopy(zero, zero->size(), DeleteInprocShot, 100));
+   EXPECT_EQ(1, mShotsDeleted);
+   std::string wound;
+   EXPECT_TRUE(vampire.GetShot(wound, 100));
+   EXPECT_EQ(std::string(100, 'z'), wound);
+
+   std::vector<std::string> volley;
+   for (int i = 0; i < 10; i++) {
+      volley.push_back(std::to_string(i));
+   }
+   EXPECT_EQ(volley.size(), rifle.FireBatch(volley, 100));
+   std::vector<std::string> wounds;
+   EXPECT_TRUE(vampire.GetShots(wounds, 100, 100));
+   EXPECT_EQ(volley, wounds);
+}
+
+TEST_F(InprocJunctionTests, HighWaterLimitsTheQueue) {
+   std::string location = GetInprocLocation();
+   Rifle rifle(location);
+   rifle.SetHighWater(2);
+   Vampire vampire(location);
+   vampire.SetHighWater(2);
+   ASSERT_TRUE(rifle.Aim());
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   std::string bullet("bang");
+   for (int i = 0; i < 4; i++) {
+      EXPECT_TRUE(rifle.Fire(bullet, 0));
+   }
+   EXPECT_FALSE(rifle.Fire(bullet, 10));
+   std::string wound;
+   EXPECT_TRUE(vampire.GetShot(wound, 0));
+   EXPECT_TRUE(rifle.Fire(bullet, 0));
+}
+
+TEST_F(InprocJunctionTests, NoTargetToShoot) {
+   std::string location = GetInprocLocation();
+   Rifle rifle(location);
+   ASSERT_TRUE(rifle.Aim());
+   std::string bullet("bang");
+   EXPECT_FALSE(rifle.Fire(bullet, 1));
+   EXPECT_FALSE(rifle.FireStake(&bullet, 1));
+}
+
+TEST_F(InprocJunctionTests, OnlyOneBinder) {
+   std::string location = GetInprocLocation();
+   Rifle rifle(location);
+   Rifle another(location);
+   ASSERT_TRUE(rifle.Aim());
+   EXPECT_FALSE(another.Aim());
+   another.SetOwnSocket(false);
+   EXPECT_TRUE(another.Aim());
+}
+
+TEST_F(InprocJunctionTests, ConnectBeforeBind) {
+   std::string location = GetInprocLocation();
+   Vampire vampire(location);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   std::string wound;
+   std::thread late([location]() {
+      Rifle rifle(location);
+      ASSERT_TRUE(rifle.Aim());
+      std::string bullet("late");
+      EXPECT_TRUE(rifle.Fire(bullet, 1000));
+      // stay around until the shot is taken, queued shots die with the rifle
+      std::this_thread::sleep_for(std::chrono::milliseconds(200));
+   });
+   EXPECT_TRUE(vampire.GetShot(wound, 1000));
+   EXPECT_EQ("late", wound);
+   late.join();
+   EXPECT_EQ(0, InprocJunction::Instance().GetPipeCount(location));
+}
+
+TEST_F(InprocJunctionTests, RoundRobinAndFairQueue) {
+   std::string location = GetInprocLocation();
+   Rifle rifle(location);
+   Vampire first(location);
+   Vampire second(location);
+   ASSERT_TRUE(rifle.Aim());
+   ASSERT_TRUE(first.PrepareToBeShot());
+   ASSERT_TRUE(second.PrepareToBeShot());
+   std::string bullet("bang");
+   for (int i = 0; i < 4; i++) {
+      EXPECT_TRUE(rifle.Fire(bullet, 100));
+   }
+   std::string wound;
+   for (int i = 0; i < 2; i++) {
+      EXPECT_TRUE(first.GetShot(wound, 0));
+      EXPECT_TRUE(second.GetShot(wound, 0));
+   }
+   EXPECT_FALSE(first.GetShot(wound, 0));
+
+   Rifle another(location);
+   another.SetOwnSocket(false);
+   ASSERT_TRUE(another.Aim());
+   EXPECT_EQ(4, InprocJunction::Instance().GetPipeCount(location));
+   EXPECT_TRUE(rifle.Fire(std::string("rifle"), 100));
+   EXPECT_TRUE(rifle.Fire(std::string("rifle"), 100));
+   EXPECT_TRUE(another.Fire(std::string("another"), 100));
+   EXPECT_TRUE(another.Fire(std::string("another"), 100));
+   std::set<std::string> shooters;
+   EXPECT_TRUE(first.GetShot(wound, 0));
+   shooters.insert(wound);
+   EXPECT_TRUE(first.GetShot(wound, 0));
+   shooters.insert(wound);
+   EXPECT_EQ(2, shooters.size());
+}
+
+TEST_F(InprocJunctionTests, ParkedVampireWakesUp) {
+   std::string location = GetInprocLocation();
+   Vampire vampire(location);
+   vampire.SetOwnSocket(true);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   const int count = 100000;
+   std::thread shooter([location, count]() {
+      Rifle rifle(location);
+      rifle.SetOwnSocket(false);
+      rifle.SetHighWater(10);
+      ASSERT_TRUE(rifle.Aim());
+      for (int i = 0; i < count; i++) {
+         ASSERT_TRUE(rifle.Fire(std::to_string(i), 1000));
+         if (i % 1000 == 0) {
+            // let the vampire park now and then
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+         }
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(200));
+   });
+   std::string wound;
+   for (int i = 0; i < count; i++) {
+      ASSERT_TRUE(vampire.GetShot(wound, 1000));
+      ASSERT_EQ(std::to_string(i), wound);
+   }
+   shooter.join();
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include "InprocJunction.h"
+
+class InprocJunctionTests : public ::testing::Test {
+public:
+
+   InprocJunctionTests() {
+   };
+
+   static std::string GetInprocLocation() {
+      std::string location("inproc://InprocJunctionTests");
+      location.append(std::to_string(getpid()));
+      location.append("_");
+      location.append(std::to_string(mLocationCount++));
+      return location;
+   }
+   static std::atomic<int> mLocationCount;
+   static std::atomic<int> mShotsDeleted;
+
+protected:
+
+   virtual void SetUp() {
+      mShotsDeleted.store(0);
+   };
+
+   virtual void TearDown() {
+   };
+private:
+
+};
@@ -0,0 +1,194 @@
+#include <czmq.h>
+#include <boost/thread.hpp>
+
+#include "LatencyHistogramTests.h"
+#include "Rifle.h"
+#include "Vampire.h"
+
+namespace {
+
+   void DeleteStampedShot(void*, void* data) {
+      delete reinterpret_cast<std::string*> (data);
+   }
+}
+
+/**
+ * Fire a few stamped bullets and check they arrive unstamped and measured.
+ * @param location
+ */
+void LatencyHistogramTests::RoundTrip(const std::string& location) {
+   Rifle rifle(location);
+   rifle.SetOwnSocket(true);
+   rifle.SetLatencyTracking(true);
+   EXPECT_TRUE(rifle.GetLatencyTracking());
+   ASSERT_TRUE(rifle.Aim());
+   Vampire vampire(location);
+   EXPECT_TRUE(NULL == vampire.GetLatency());
+   vampire.SetLatencyTracking(true);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+
+   const uint64_t before = LatencyHistogram::Now();
+   EXPECT_TRUE(rifle.Fire("woo", 500));
+   std::string bullet;
+   ASSERT_TRUE(vampire.GetShot(bullet, 500));
+   EXPECT_EQ("woo", bullet);
+
+   std::string* zero = new std::string("hoo!");
+   EXPECT_TRUE(rifle.FireZeroCopy(zero, zero->size(), DeleteStampedShot, 500));
+   Wound wound;
+   ASSERT_TRUE(vampire.GetShot(wound, 500));
+   EXPECT_EQ("hoo!", std::string(wound.data(), wound.size()));
+
+   std::string stake("stake");
+   EXPECT_TRUE(rifle.FireStake(&stake, 500));
+   void* gotStake = NULL;
+   ASSERT_TRUE(vampire.GetStake(gotStake, 500));
+   EXPECT_EQ(&stake, gotStake);
+   const uint64_t elapsed = LatencyHistogram::Now() - before;
+
+   const LatencyHistogram* latency = vampire.GetLatency();
+   ASSERT_TRUE(NULL != latency);
+   EXPECT_EQ(3, latency->GetCount());
+   EXPECT_LT(0, latency->GetMax());
+   EXPECT_GE(elapsed, latency->GetMax());
+   EXPECT_GE(latency->GetMax(), latency->GetPercentile(50));
+   EXPECT_EQ(0, vampire.GetStats().mInvalidMessages);
+}
+
+/**
+ * Report the delivery latencies seen by one Vampire.
+ * @param location
+ * @param dataSize
+ * @param nShots
+ */
+void LatencyHistogramTests::LatencyBenchmark(const std::string& location, const int dataSize,
+   const int nShots) {
+#if RIFLE_VAMPIRE_PRODUCTION == 0
+   return;
+#endif
+   Rifle rifle(location);
+   rifle.SetOwnSocket(true);
+   rifle.SetLatencyTracking(true);
+   ASSERT_TRUE(rifle.Aim());
+   Vampire vampire(location);
+   vampire.SetLatencyTracking(true);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   boost::thread feeder([&vampire, nShots]() {
+      std::string bullet;
+      for (int i = 0; i < nShots; i++) {
+         vampire.GetShot(bullet, 1000);
+      }
+   });
+   std::string exampleData(dataSize, 'a');
+   for (int i = 0; i < nShots; i++) {
+      ASSERT_TRUE(rifle.Fire(exampleData));
+   }
+   feeder.join();
+   const LatencyHistogram* latency = vampire.GetLatency();
+   EXPECT_EQ(nShots, latency->GetCount());
+   std::cout << location.substr(0, location.find(':')) << " latency in ns, p50: "
+      << latency->GetPercentile(50) << " p99: " << latency->GetPercentile(99)
+      << " p99.9: " << latency->GetPercentile(99.9) << " max: " << latency->GetMax()
+      << std::endl;
+}
+
+TEST_F(LatencyHistogramTests, Empty) {
+   LatencyHistogram latency;
+   EXPECT_EQ(0, latency.GetCount());
+   EXPECT_EQ(0, latency.GetMax());
+   EXPECT_EQ(0, latency.GetMean());
+   EXPECT_EQ(0, latency.GetPercentile(99));
+}
+
+TEST_F(LatencyHistogramTests, Percentiles) {
+   LatencyHistogram latency;
+   for (uint64_t i = 1; i <= 100000; i++) {
+      latency.Record(i * 10);
+   }
+   EXPECT_EQ(100000, latency.GetCount());
+   EXPECT_EQ(1000000, latency.GetMax());
+   EXPECT_EQ(500005, latency.GetMean());
+   // every value is reported within a bucket, 1/16th of its power of two
+   EXPECT_NEAR(500000, latency.GetPercentile(50), 500000 / 16);
+   EXPECT_NEAR(990000, latency.GetPercentile(99), 990000 / 16);
+   EXPECT_NEAR(999000, latency.GetPercentile(99.9), 999000 / 16);
+   EXPECT_EQ(1000000, latency.GetPercentile(100));
+   EXPECT_EQ(10, latency.GetPercentile(0));
+}
+
+TEST_F(LatencyHistogramTests, ExtremeValues) {
+   LatencyHistogram latency;
+   latency.Record(0);
+   latency.Record(UINT64_MAX);
+   EXPECT_EQ(0, latency.GetPercentile(50));
+   EXPECT_EQ(UINT64_MAX, latency.GetPercentile(100));
+}
+
+TEST_F(LatencyHistogramTests, Stamp) {
+   char header[LatencyHistogram::kStampSize];
+   LatencyHistogram::Stamp(header);
+   usleep(1000);
+   EXPECT_LE(1000000, LatencyHistogram::Elapsed(header));
+}
+
+TEST_F(LatencyHistogramTests, RoundTripIpc) {
+   RoundTrip(GetIpcLocation());
+}
+
+TEST_F(LatencyHistogramTests, RoundTripInproc) {
+   RoundTrip(GetInprocLocation());
+}
+
+TEST_F(LatencyHistogramTests, UnstampedShotsAreInvalid) {
+   std::string location = GetIpcLocation();
+   Rifle rifle(location);
+   rifle.SetOwnSocket(true);
+   ASSERT_TRUE(rifle.Aim());
+   Vampire vampire(location);
+   vampire.SetLatencyTracking(true);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   EXPECT_TRUE(rifle.Fire("woo", 500));
+   std::string bullet;
+   EXPECT_FALSE(vampire.GetShot(bullet, 500));
+   EXPECT_EQ(1, vampire.GetStats().mInvalidMessages);
+   EXPECT_EQ(0, vampire.GetLatency()->GetCount());
+}
+
+TEST_F(LatencyHistogramTests, TrackingOffKeepsTheHistogram) {
+   std::string location = GetIpcLocation();
+   Rifle rifle(location);
+   rifle.SetOwnSocket(true);
+   rifle.SetLatencyTracking(true);
+   ASSERT_TRUE(rifle.Aim());
+   Vampire vampire(location);
+   vampire.SetLatencyTracking(true);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   EXPECT_TRUE(rifle.Fire("woo", 500));
+   std::string bullet;
+   ASSERT_TRUE(vampire.GetShot(bullet, 500));
+   const LatencyHistogram* latency = vampire.GetLatency();
+   ASSERT_TRUE(NULL != latency);
+
+   vampire.SetLatencyTracking(false);
+   rifle.SetLatencyTracking(false);
+   EXPECT_TRUE(rifle.Fire("hoo", 500));
+   ASSERT_TRUE(vampire.GetShot(bullet, 500));
+   EXPECT_EQ("hoo", bullet);
+   // still readable, and nothing more was recorded
+   EXPECT_EQ(latency, vampire.GetLatency());
+   EXPECT_EQ(1, latency->GetCount());
+   vampire.SetLatencyTracking(true);
+   EXPECT_EQ(latency, vampire.GetLatency());
+}
+
+TEST_F(LatencyHistogramTests, LatencyBenchmarkIpc) {
+   if (geteuid() == 0) {
+      LatencyBenchmark(GetIpcLocation(), 100, 1000000);
+   }
+}
+
+TEST_F(LatencyHistogramTests, LatencyBenchmarkInproc) {
+   if (geteuid() == 0) {
+      LatencyBenchmark(GetInprocLocation(), 100, 1000000);
+   }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include <unistd.h>
+#include <string>
+#include "LatencyHistogram.h"
+
+class LatencyHistogramTests : public ::testing::Test {
+public:
+
+   LatencyHistogramTests() {
+   };
+
+   static std::string GetIpcLocation() {
+      std::string location("ipc:///tmp/latencytest");
+      location.append(std::to_string(getpid()));
+      location.append("_");
+      location.append(std::to_string(rand()));
+      return location;
+   }
+
+   static std::string GetInprocLocation() {
+      std::string location("inproc://latencytest");
+      location.append(std::to_string(rand()));
+      return location;
+   }
+
+   void RoundTrip(const std::string& location);
+   void LatencyBenchmark(const std::string& location, const int dataSize, const int nShots);
+
+protected:
+
+   virtual void SetUp() {
+   };
+
+   virtual void TearDown() {
+   };
+private:
+
+};
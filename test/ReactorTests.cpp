@@ -0,0 +1,239 @@
+#include <czmq.h>
+#include <algorithm>
+#include <boost/thread.hpp>
+
+#include "ReactorTests.h"
+#include "Rifle.h"
+#include "Vampire.h"
+#include "Shotgun.h"
+#include "Alien.h"
+#include "Crowbar.h"
+#include "Headcrab.h"
+
+TEST_F(ReactorTests, NothingToDo) {
+   Reactor reactor;
+   EXPECT_EQ(0, reactor.GetWatchCount());
+   EXPECT_EQ(0, reactor.GetTimerCount());
+   EXPECT_EQ(0, reactor.Poll(-1));
+   EXPECT_EQ(0, reactor.Poll(1));
+}
+
+TEST_F(ReactorTests, Timers) {
+   Reactor reactor;
+   int once = 0;
+   int repeated = 0;
+   reactor.AddTimer(10, [&once]() {
+      once++;
+   }, false);
+   const int timer = reactor.AddTimer(5, [&repeated]() {
+      repeated++;
+   });
+   EXPECT_EQ(2, reactor.GetTimerCount());
+   const auto start = std::chrono::steady_clock::now();
+   while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(100)) {
+      EXPECT_LE(0, reactor.Poll(-1));
+   }
+   EXPECT_EQ(1, once);
+   EXPECT_LE(10, repeated);
+   EXPECT_GE(21, repeated);
+   EXPECT_EQ(1, reactor.GetTimerCount());
+   reactor.CancelTimer(timer);
+   EXPECT_EQ(0, reactor.GetTimerCount());
+   const int total = repeated;
+   EXPECT_EQ(0, reactor.Poll(10));
+   EXPECT_EQ(total, repeated);
+}
+
+TEST_F(ReactorTests, ManySocketsOneThread) {
+   std::string rifleLocation = GetIpcLocation();
+   Rifle rifle(rifleLocation);
+   rifle.SetOwnSocket(true);
+   ASSERT_TRUE(rifle.Aim());
+   Vampire vampire(rifleLocation);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+
+   std::string shotgunLocation = GetIpcLocation();
+   Shotgun shotgun;
+   shotgun.Aim(shotgunLocation);
+   Alien alien;
+   alien.PrepareToBeShot(shotgunLocation);
+
+   std::string headcrabLocation = GetIpcLocation();
+   Headcrab headcrab(headcrabLocation);
+   ASSERT_TRUE(headcrab.ComeToLife());
+   Crowbar crowbar(headcrab);
+   ASSERT_TRUE(crowbar.Wield());
+
+   Reactor reactor;
+   std::vector<std::string> shots;
+   std::vector<std::string> hits;
+   ASSERT_TRUE(reactor.Add(vampire, [&shots](Vampire & bitten) {
+      std::string wound;
+      while (bitten.GetShot(wound, 0)) {
+         shots.push_back(wound);
+      }
+   }));
+   ASSERT_TRUE(reactor.Add(alien, [&shots](Alien & bitten) {
+      std::vector<std::string> bullets;
+      bitten.GetShot(0, bullets);
+      shots.insert(shots.end(), bullets.begin(), bullets.end());
+   }));
+   ASSERT_TRUE(reactor.Add(headcrab, [&hits](Headcrab & hit) {
+      std::string theHit;
+      if (hit.GetHitWait(theHit, 0)) {
+         hits.push_back(theHit);
+         hit.SendSplatter("splat");
+      }
+   }));
+   EXPECT_FALSE(reactor.Add(vampire, [](Vampire&) {
+   }));
+   EXPECT_EQ(3, reactor.GetWatchCount());
+   // the subscription might not have gone through yet, keep publishing
+   const int publisher = reactor.AddTimer(10, [&shotgun]() {
+      shotgun.Fire("pub");
+   });
+
+   EXPECT_TRUE(rifle.Fire("push", 500));
+   EXPECT_TRUE(rifle.Fire("push", 500));
+   EXPECT_TRUE(crowbar.Swing("hit"));
+   for (int i = 0; i < 200 && (shots.size() < 3 || hits.empty()); i++) {
+      ASSERT_LE(0, reactor.Poll(10));
+      if (std::count(shots.begin(), shots.end(), "pub") > 0) {
+         reactor.CancelTimer(publisher);
+      }
+   }
+   EXPECT_EQ(2, std::count(shots.begin(), shots.end(), "push"));
+   EXPECT_LE(1, std::count(shots.begin(), shots.end(), "pub"));
+   ASSERT_EQ(1, hits.size());
+   EXPECT_EQ("hit", hits[0]);
+   std::string guts;
+   EXPECT_TRUE(crowbar.WaitForKill(guts, 500));
+   EXPECT_EQ("splat", guts);
+
+   reactor.Remove(alien);
+   reactor.Remove(headcrab);
+   EXPECT_EQ(1, reactor.GetWatchCount());
+}
+
+TEST_F(ReactorTests, ConflatingAlienIsCalledWhileItHoldsShots) {
+   std::string location = GetIpcLocation();
+   Shotgun shotgun;
+   shotgun.Aim(location);
+   Alien alien;
+   alien.SetConflate(true);
+   alien.PrepareToBeShot(location);
+   Reactor reactor;
+   std::vector<std::string> topics;
+   ASSERT_TRUE(reactor.Add(alien, [&topics](Alien & bitten) {
+      std::string topic;
+      std::vector<std::string> bullets;
+      // one shot per call, as a handler following the class doc would
+      bitten.GetShot(0, topic, bullets);
+      if (!bullets.empty()) {
+         topics.push_back(topic);
+      }
+   }));
+   std::vector<std::string> bullets(1, "Fire!");
+   // publish until the subscription has gone through
+   for (int i = 0; i < 200 && topics.empty(); i++) {
+      shotgun.Fire("probe", bullets);
+      reactor.Poll(10);
+   }
+   ASSERT_FALSE(topics.empty());
+   // let the probes still on their way in go through
+   while (reactor.Poll(100) > 0) {
+   }
+   topics.clear();
+   shotgun.Fire("x", bullets);
+   shotgun.Fire("y", bullets);
+   shotgun.Fire("z", bullets);
+   zclock_sleep(100);
+   // the first call takes all three off the socket, the others are held
+   EXPECT_EQ(1, reactor.Poll(1000));
+   EXPECT_TRUE(alien.HasHeld());
+   const int64_t start = zclock_time();
+   EXPECT_EQ(1, reactor.Poll(1000));
+   EXPECT_EQ(1, reactor.Poll(1000));
+   EXPECT_GT(500, zclock_time() - start);
+   EXPECT_FALSE(alien.HasHeld());
+   ASSERT_EQ(3, topics.size());
+   EXPECT_EQ("x", topics[0]);
+   EXPECT_EQ("z", topics[2]);
+}
+
+TEST_F(ReactorTests, HandlersCanRemoveAndStop) {
+   std::string location = GetIpcLocation();
+   Rifle rifle(location);
+   rifle.SetOwnSocket(true);
+   ASSERT_TRUE(rifle.Aim());
+   Vampire vampire(location);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+
+   Reactor reactor;
+   int bites = 0;
+   ASSERT_TRUE(reactor.Add(vampire, [&reactor, &bites](Vampire & bitten) {
+      std::string wound;
+      bitten.GetShot(wound, 0);
+      bites++;
+      reactor.Remove(bitten);
+      reactor.AddTimer(1, [&reactor]() {
+         reactor.Stop();
+      }, false);
+   }));
+   EXPECT_TRUE(rifle.Fire("one", 500));
+   EXPECT_TRUE(rifle.Fire("two", 500));
+   reactor.Run();
+   EXPECT_EQ(1, bites);
+   EXPECT_EQ(0, reactor.GetWatchCount());
+   std::string wound;
+   EXPECT_TRUE(vampire.GetShot(wound, 500));
+   EXPECT_EQ("two", wound);
+}
+
+TEST_F(ReactorTests, StopFromAnotherThread) {
+   Reactor reactor;
+   reactor.AddTimer(1000, []() {
+   });
+   boost::thread stopper([&reactor]() {
+      zclock_sleep(10);
+      reactor.Stop();
+   });
+   const int64_t start = zclock_time();
+   reactor.Run();
+   stopper.join();
+   // woken by the Stop, not by the timer
+   EXPECT_GT(500, zclock_time() - start);
+}
+
+TEST_F(ReactorTests, StopBeforeRun) {
+   Reactor reactor;
+   int fired = 0;
+   reactor.AddTimer(1000, [&fired]() {
+      fired++;
+   });
+   reactor.Stop();
+   reactor.Run();
+   EXPECT_EQ(0, fired);
+
+   // the stop was used up, the next Run waits for another
+   reactor.AddTimer(10, [&reactor]() {
+      reactor.Stop();
+   }, false);
+   reactor.Run();
+   EXPECT_EQ(1, reactor.GetTimerCount());
+}
+
+TEST_F(ReactorTests, OnlyZeromqSockets) {
+   Reactor reactor;
+   Vampire unprepared(GetIpcLocation());
+   EXPECT_FALSE(reactor.Add(unprepared, [](Vampire&) {
+   }));
+   std::string location("inproc://reactortest");
+   Rifle rifle(location);
+   ASSERT_TRUE(rifle.Aim());
+   Vampire vampire(location);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   EXPECT_FALSE(reactor.Add(vampire, [](Vampire&) {
+   }));
+   EXPECT_EQ(0, reactor.GetWatchCount());
+}
@@ -1,11 +1,25 @@
 
 #include <czmq.h>
 #include <boost/thread.hpp>
+#include <sys/epoll.h>
 #include "RifleVampireTests.h"
+#include <gperftools/malloc_hook.h>
 #include "Death.h"
 #include "FileIO.h"
 std::atomic<int> RifleVampireTests::mShotsDeleted;
 
+namespace {
+   // Only allocations made by the thread under test are counted
+   thread_local bool tCountAllocations = false;
+   thread_local int tAllocations = 0;
+
+   void CountAllocation(const void*, size_t) {
+      if (tCountAllocations) {
+         tAllocations++;
+      }
+   }
+}
+
 void TestDeleteString(void*, void* data) {
    std::string* theString = reinterpret_cast<std::string*> (data);
    RifleVampireTests::mShotsDeleted++; // yes this is threadsafe
@@ -60,6 +74,13 @@ std::string RifleVampireTests::GetIpcLocation() {
    return ipcLocation;
 }
 
+std::string RifleVampireTests::GetInprocLocation() {
+   int pid = getpid();
+   std::string inprocLocation("inproc://RifleVampireTests");
+   inprocLocation.append(std::to_string(pid));
+   return inprocLocation;
+}
+
 void RifleVampireTests::RifleThread(int numberOfMessages,
         std::string& location, std::string& exampleData, int hwm,
         int ioThreads, bool ownSocket) {
@@ -149,14 +170,16 @@ void RifleVampireTests::ShootZeroCopyThread(int numberOfMessages,
  * @param hwm
  * @param ioThreads
  * @param ownSocket
+ * @param creditDispatch
  */
 void RifleVampireTests::VampireThread(int numberOfMessages,
         std::string& location, std::string& exampleData, int hwm,
-        int ioThreads, bool ownSocket) {
+        int ioThreads, bool ownSocket, bool creditDispatch) {
    Vampire vampire(location);
    vampire.SetHighWater(hwm);
    vampire.SetIOThreads(ioThreads);
    vampire.SetOwnSocket(ownSocket);
+   vampire.SetCreditDispatch(creditDispatch);
    ASSERT_TRUE(vampire.PrepareToBeShot());
    for (int i=0; i < numberOfMessages && !zctx_interrupted; i++) {
       std::string bullet;
@@ -172,15 +195,60 @@ void RifleVampireTests::VampireThread(int numberOfMessages,
    }
 }
 
+/**
+ * Start a vampire thread and pull off the set number of messages in batches.
+ * @param numberOfMessages
+ * @param location
+ * @param exampleData
+ * @param hwm
+ * @param ioThreads
+ * @param batchSize
+ */
+void RifleVampireTests::BatchVampireThread(int numberOfMessages,
+        std::string& location, std::string& exampleData, int hwm,
+        int ioThreads, int batchSize) {
+   Vampire vampire(location);
+   vampire.SetHighWater(hwm);
+   vampire.SetIOThreads(ioThreads);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   std::vector<std::string> bullets;
+   int received = 0;
+   while (received < numberOfMessages && !zctx_interrupted) {
+      if (vampire.GetShots(bullets, batchSize, 2000)) {
+         for (auto it = bullets.begin(); it != bullets.end(); it++) {
+            EXPECT_EQ(*it, exampleData);
+         }
+         received += bullets.size();
+      }
+   }
+   while (!zctx_interrupted) {
+      boost::this_thread::sleep(boost::posix_time::seconds(1));
+   }
+}
+
 void RifleVampireTests::StakeAVampireThread(int numberOfMessages,
         std::string& location,
         std::vector<std::pair<void*, unsigned int> >& exampleData,
-        int hwm, int ioThreads) {
+        int hwm, int ioThreads, bool useBundles) {
    Vampire vampire(location);
    vampire.SetHighWater(hwm);
    vampire.SetIOThreads(ioThreads);
    ASSERT_TRUE(vampire.PrepareToBeShot());
    for (int i=0; i < numberOfMessages && !zctx_interrupted; i++) {
+      if (useBundles) {
+         StakeBundle* bundle = NULL;
+         if (vampire.GetStakes(bundle, 2000)) {
+            for (size_t j = 0; j < bundle->size() && !zctx_interrupted; j++) {
+               EXPECT_EQ((*bundle)[j].first, exampleData[j].first);
+               EXPECT_EQ((*bundle)[j].second, exampleData[j].second);
+            }
+            StakeBundle::Recycle(bundle);
+         } else {
+            //no shot in time try again
+            i--;
+         }
+         continue;
+      }
       std::vector<std::pair<void*, unsigned int> > data;
 
       if (vampire.GetStakes(data, 2000)) {
@@ -201,12 +269,14 @@ void RifleVampireTests::StakeAVampireThread(int numberOfMessages,
 }
 
 void RifleVampireTests::OneRifleNVampiresBenchmark(int nVampires, int nIOThreads,
-        int rifleHWM, int vampireHWM, std::string& location, int dataSize, int nShotsPerVampire, int expectedSpeed) {
+        int rifleHWM, int vampireHWM, std::string& location, int dataSize, int nShotsPerVampire, int expectedSpeed,
+        bool creditDispatch) {
    bool bRifleOwnSocket = true;
    Rifle* rifle = new Rifle(location);
    rifle->SetHighWater(rifleHWM);
    rifle->SetIOThreads(nIOThreads);
    rifle->SetOwnSocket(bRifleOwnSocket);
+   rifle->SetCreditDispatch(creditDispatch);
    EXPECT_TRUE(rifle->Aim());
 #if RIFLE_VAMPIRE_PRODUCTION == 0
    delete rifle;
@@ -218,7 +288,7 @@ void RifleVampireTests::OneRifleNVampiresBenchmark(int nVampires, int nIOThreads
    for (int i = 0; i < nVampires && !zctx_interrupted; i++) {
       boost::thread* aShooter = new boost::thread(
               &RifleVampireTests::VampireThread, this, nShotsPerVampire, location,
-              exampleData, vampireHWM, nIOThreads, !bRifleOwnSocket);
+              exampleData, vampireHWM, nIOThreads, !bRifleOwnSocket, creditDispatch);
       theVampires.push_back(aShooter);
    }
    sleep(2);
@@ -243,8 +313,58 @@ void RifleVampireTests::OneRifleNVampiresBenchmark(int nVampires, int nIOThreads
    delete rifle;
 }
 
+/**
+ * Same as OneRifleNVampiresBenchmark, but the rifle fires volleys with FireBatch
+ * and the vampires drain them with GetShots.
+ */
+void RifleVampireTests::OneRifleNVampiresBatchBenchmark(int nVampires, int nIOThreads,
+        int rifleHWM, int vampireHWM, std::string& location, int dataSize, 
+        int nShotsPerVampire, int expectedSpeed, int batchSize) {
+   Rifle* rifle = new Rifle(location);
+   rifle->SetHighWater(rifleHWM);
+   rifle->SetIOThreads(nIOThreads);
+   rifle->SetOwnSocket(true);
+   EXPECT_TRUE(rifle->Aim());
+#if RIFLE_VAMPIRE_PRODUCTION == 0
+   delete rifle;
+   return;
+#endif   
+
+   std::string exampleData(dataSize, 'a');
+   std::vector<std::string> volley(batchSize, exampleData);
+   std::vector<boost::thread*> theVampires;
+   for (int i = 0; i < nVampires && !zctx_interrupted; i++) {
+      boost::thread* aShooter = new boost::thread(
+              &RifleVampireTests::BatchVampireThread, this, nShotsPerVampire, location,
+              exampleData, vampireHWM, nIOThreads, batchSize);
+      theVampires.push_back(aShooter);
+   }
+   sleep(2);
+   //Send more then we can handle, break if we can't send any more.
+   int fullSize = (nShotsPerVampire * nVampires) + ((vampireHWM * (nVampires)) * 2) + rifleHWM;
+   fullSize -= fullSize % batchSize;
+   SetExpectedTime(fullSize, exampleData.size() * sizeof (char), expectedSpeed, 20000L);
+   StartTimedSection();
+   for (int i = 0; i < fullSize && !zctx_interrupted; i += batchSize) {
+      if (rifle->FireBatch(volley, 500) != volley.size()) {
+         std::cout << "Failed to fire... Vampires might all be dead..." << std::endl;
+         break;
+      }
+   }
+   for (auto it = theVampires.begin();
+           it != theVampires.end() && !zctx_interrupted; it++) {
+      (*it)->interrupt();
+      (*it)->join();
+      delete *it;
+   }
+   EndTimedSection();
+   EXPECT_TRUE(TimedSectionPassed());
+   delete rifle;
+}
+
 void RifleVampireTests::OneRifleNVampiresStakeBenchmark(int nVampires, int nIOThreads,
-        int rifleHWM, int vampireHWM, std::string& location, int dataSize, int nShotsPerVampire, int expectedSpeed) {
+        int rifleHWM, int vampireHWM, std::string& location, int dataSize, int nShotsPerVampire, int expectedSpeed,
+        bool useBundles) {
    Rifle* rifle = new Rifle(location);
    rifle->SetHighWater(rifleHWM);
    rifle->SetIOThreads(nIOThreads);
@@ -262,7 +382,7 @@ void RifleVampireTests::OneRifleNVampiresStakeBenchmark(int nVampires, int nIOTh
    std::vector<boost::thread*> theVampires;
    for (int i = 0; i < nVampires && !zctx_interrupted; i++) {
       boost::thread* aShooter = new boost::thread(&RifleVampireTests::StakeAVampireThread,
-              this, nShotsPerVampire, location, exampleData, vampireHWM, nIOThreads);
+              this, nShotsPerVampire, location, exampleData, vampireHWM, nIOThreads, useBundles);
       theVampires.push_back(aShooter);
    }
    sleep(2);
@@ -271,7 +391,18 @@ void RifleVampireTests::OneRifleNVampiresStakeBenchmark(int nVampires, int nIOTh
    SetExpectedTime(fullSize, exampleData.size() * sizeof (char) * SIZE_OF_STAKE_BUNDLE, expectedSpeed, 20000L);
    StartTimedSection();
    for (int i = 0; i < fullSize && !zctx_interrupted; i++) {
-      if (!rifle->FireStakes(exampleData, 1500)) {
+      bool fired;
+      if (useBundles) {
+         // filled in place, the copy of exampleData is the cost of making the stakes
+         StakeBundle* bundle = StakeBundle::Get();
+         for (auto it = exampleData.begin(); it != exampleData.end(); it++) {
+            bundle->push_back(it->first, it->second);
+         }
+         fired = rifle->FireStakes(bundle, 1500);
+      } else {
+         fired = rifle->FireStakes(exampleData, 1500);
+      }
+      if (!fired) {
          std::cout << "Failed to fire at shot " << i << " of fullSize " << fullSize << std::endl;
          std::cout << " ... Vampires might all be dead..." << std::endl;
          break;
@@ -288,6 +419,94 @@ void RifleVampireTests::OneRifleNVampiresStakeBenchmark(int nVampires, int nIOTh
    delete rifle;
 }
 
+/**
+ * The baseline for the inproc benchmarks, a bare libzmq PUSH / PULL pair over
+ * inproc with none of our wrappers involved.
+ */
+void RifleVampireTests::RawZmqInprocBenchmark(int hwm, int dataSize, int nShots, int expectedSpeed) {
+#if RIFLE_VAMPIRE_PRODUCTION == 0
+   return;
+#endif   
+   std::string location = GetInprocLocation();
+   location.append("raw");
+   void* context = zmq_ctx_new();
+   void* push = zmq_socket(context, ZMQ_PUSH);
+   zmq_setsockopt(push, ZMQ_SNDHWM, &hwm, sizeof (hwm));
+   ASSERT_EQ(0, zmq_bind(push, location.c_str()));
+   std::string exampleData(dataSize, 'a');
+   boost::thread puller([context, location, hwm, nShots]() {
+      void* pull = zmq_socket(context, ZMQ_PULL);
+      zmq_setsockopt(pull, ZMQ_RCVHWM, &hwm, sizeof (hwm));
+      zmq_connect(pull, location.c_str());
+      zmq_msg_t message;
+      zmq_msg_init(&message);
+      for (int i = 0; i < nShots; i++) {
+         zmq_msg_recv(&message, pull, 0);
+      }
+      zmq_msg_close(&message);
+      zmq_close(pull);
+   });
+   SetExpectedTime(nShots, exampleData.size(), expectedSpeed, 20000L);
+   StartTimedSection();
+   for (int i = 0; i < nShots; i++) {
+      zmq_send(push, exampleData.data(), exampleData.size(), 0);
+   }
+   puller.join();
+   EndTimedSection();
+   EXPECT_TRUE(TimedSectionPassed());
+   zmq_close(push);
+   zmq_ctx_term(context);
+}
+
+/**
+ * The baseline for the stake benchmarks, bare libzmq PUSH / PULL sending the
+ * same pointer and size pairs FireStakes sends, copied into each message.
+ * @param location
+ * @param hwm
+ * @param nStakes
+ *   Stakes per message, 1 for single stakes or SIZE_OF_STAKE_BUNDLE to 
+ * compare with the bundles
+ * @param nShots
+ * @param expectedSpeed
+ */
+void RifleVampireTests::RawZmqStakeBenchmark(std::string location, int hwm, int nStakes, int nShots,
+        int expectedSpeed) {
+#if RIFLE_VAMPIRE_PRODUCTION == 0
+   return;
+#endif   
+   location.append("raw");
+   void* context = zmq_ctx_new();
+   void* push = zmq_socket(context, ZMQ_PUSH);
+   zmq_setsockopt(push, ZMQ_SNDHWM, &hwm, sizeof (hwm));
+   ASSERT_EQ(0, zmq_bind(push, location.c_str()));
+   std::string exampleString(100, 'a');
+   std::vector<std::pair<void*, unsigned int> > stakes(nStakes, make_pair(&exampleString, 1234));
+   const size_t stakesSize = stakes.size() * sizeof (stakes[0]);
+   boost::thread puller([context, location, hwm, nShots, stakesSize]() {
+      void* pull = zmq_socket(context, ZMQ_PULL);
+      zmq_setsockopt(pull, ZMQ_RCVHWM, &hwm, sizeof (hwm));
+      zmq_connect(pull, location.c_str());
+      zmq_msg_t message;
+      zmq_msg_init(&message);
+      for (int i = 0; i < nShots; i++) {
+         zmq_msg_recv(&message, pull, 0);
+         EXPECT_EQ(stakesSize, zmq_msg_size(&message));
+      }
+      zmq_msg_close(&message);
+      zmq_close(pull);
+   });
+   SetExpectedTime(nShots, stakesSize, expectedSpeed, 20000L);
+   StartTimedSection();
+   for (int i = 0; i < nShots; i++) {
+      zmq_send(push, stakes.data(), stakesSize, 0);
+   }
+   puller.join();
+   EndTimedSection();
+   EXPECT_TRUE(TimedSectionPassed());
+   zmq_close(push);
+   zmq_ctx_term(context);
+}
+
 void RifleVampireTests::NRiflesOneVampireBenchmarkZeroCopy(int nRifles, int nIOThreads,
         int rifleHWM, int vampireHWM, std::string& location, int dataSize,
         int nShotsPerRifle, int expectedSpeed) {
@@ -338,6 +557,59 @@ void RifleVampireTests::NRiflesOneVampireBenchmarkZeroCopy(int nRifles, int nIOT
    EXPECT_EQ(nShotsPerRifle * nRifles, mShotsDeleted);
 }
 
+/**
+ * Same as NRiflesOneVampireBenchmark, but the vampire reads every shot in
+ * place through a Wound instead of copying it into a string.
+ */
+void RifleVampireTests::NRiflesOneVampireBenchmarkWound(int nRifles, int nIOThreads,
+        int rifleHWM, int vampireHWM, std::string& location, int dataSize,
+        int nShotsPerRifle, int expectedSpeed) {
+
+   bool bVampireOwnSocket = true;
+   Vampire vampire(location);
+   vampire.SetHighWater(vampireHWM);
+   vampire.SetIOThreads(nIOThreads);
+   vampire.SetOwnSocket(bVampireOwnSocket);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+#if RIFLE_VAMPIRE_PRODUCTION == 0
+   return;
+#endif   
+
+   std::string exampleData(dataSize, 'z');
+   std::vector<boost::thread*> theRifles;
+
+   for (int i = 0; i < nRifles && !zctx_interrupted; i++) {
+      boost::thread* aShooter = new boost::thread(
+              &RifleVampireTests::RifleThread, this, nShotsPerRifle, location,
+              exampleData, rifleHWM, nIOThreads, !bVampireOwnSocket);
+      theRifles.push_back(aShooter);
+   }
+
+   SetExpectedTime((nShotsPerRifle * nRifles), // numberOfPackets
+           (exampleData.size() * sizeof (char)), // packetSize
+           expectedSpeed, // RateInMbps
+           20000L); //transationsPerSection
+   StartTimedSection();
+   Wound wound;
+   for (int pktCount = 0; pktCount < (nShotsPerRifle * nRifles) && !zctx_interrupted; pktCount++) {
+      if (vampire.GetShot(wound, 500)) {
+         EXPECT_EQ(exampleData.size(), wound.size());
+         EXPECT_EQ('z', wound.data()[wound.size() - 1]);
+      } else {
+         pktCount--; // Packet not received in time, try again.
+      }
+   }
+
+   for (auto it = theRifles.begin();
+           it != theRifles.end() && !zctx_interrupted; it++) {
+      (*it)->interrupt();
+      (*it)->join();
+      delete *it;
+   }
+   EndTimedSection();
+   EXPECT_TRUE(TimedSectionPassed());
+}
+
 void RifleVampireTests::NRiflesOneVampireBenchmark(int nRifles, int nIOThreads,
         int rifleHWM, int vampireHWM, std::string& location, int dataSize,
         int nShotsPerRifle, int expectedSpeed) {
@@ -427,6 +699,78 @@ TEST_F(RifleVampireTests, RifleOwnsSocketOneRifleOneVampireIPCSmallSize) {
 
 }
 
+TEST_F(RifleVampireTests, RifleOwnsSocketOneRifleOneVampireIPCSmallSizeBatch) {
+   if (geteuid() == 0) {
+      std::string location = GetIpcLocation();
+      int nVampires = 1;
+      int nIOThreads = 1;
+      int rifleHWM = 120000;
+      int vampireHWM = 30000;
+      int dataSize = 100;
+      int nShotsPerVampire = 1000000;
+      int expectedSpeed = 50;
+      int batchSize = 100;
+      OneRifleNVampiresBatchBenchmark(nVampires, nIOThreads, rifleHWM, vampireHWM, location, dataSize, nShotsPerVampire, expectedSpeed, batchSize);
+   }
+
+}
+
+TEST_F(RifleVampireTests, RifleOwnsSocketOneRifleOneVampireInprocSmallSize) {
+   if (geteuid() == 0) {
+      std::string location = GetInprocLocation();
+      int nVampires = 1;
+      int nIOThreads = 1;
+      int rifleHWM = 120000;
+      int vampireHWM = 30000;
+      int dataSize = 100;
+      int nShotsPerVampire = 1000000;
+      int expectedSpeed = 200;
+      OneRifleNVampiresBenchmark(nVampires, nIOThreads, rifleHWM, vampireHWM, location, dataSize, nShotsPerVampire, expectedSpeed);
+   }
+
+}
+
+TEST_F(RifleVampireTests, RawZmqOneRifleOneVampireInprocSmallSize) {
+   if (geteuid() == 0) {
+      int hwm = 150000;
+      int dataSize = 100;
+      int nShots = 1000000;
+      int expectedSpeed = 50;
+      RawZmqInprocBenchmark(hwm, dataSize, nShots, expectedSpeed);
+   }
+
+}
+
+TEST_F(RifleVampireTests, RifleOwnsSocketOneRifleTwoVampiresInprocSmallSize) {
+   if (geteuid() == 0) {
+      std::string location = GetInprocLocation();
+      int nVampires = 2;
+      int nIOThreads = 1;
+      int rifleHWM = 120000;
+      int vampireHWM = 30000;
+      int dataSize = 100;
+      int nShotsPerVampire = 1000000;
+      int expectedSpeed = 200;
+      OneRifleNVampiresBenchmark(nVampires, nIOThreads, rifleHWM, vampireHWM, location, dataSize, nShotsPerVampire, expectedSpeed);
+   }
+
+}
+
+TEST_F(RifleVampireTests, OneRifleOneVampireInprocPointers) {
+   if (geteuid() == 0) {
+      std::string location = GetInprocLocation();
+      int nVampires = 1;
+      int nIOThreads = 1;
+      int rifleHWM = 120000;
+      int vampireHWM = 30000;
+      int dataSize = 100;
+      int nShotsPerVampire = 1000000;
+      int expectedSpeed = 200;
+      OneRifleNVampiresStakeBenchmark(nVampires, nIOThreads, rifleHWM, vampireHWM, location, dataSize, nShotsPerVampire, expectedSpeed);
+   }
+
+}
+
 TEST_F(RifleVampireTests, OneRifleOneVampirePointers) {
    if (geteuid() == 0) {
       std::string location = GetIpcLocation();
@@ -488,6 +832,60 @@ TEST_F(RifleVampireTests, RifleOwnsSocketOneRifleTwoVampiresIPCSmallSize) {
 
 }
 
+TEST_F(RifleVampireTests, RifleOwnsSocketOneRifleTwoVampiresIPCSmallSizeBatch) {
+   if (geteuid() == 0) {
+      std::string location = GetIpcLocation();
+      int nVampires = 2;
+      int nIOThreads = 1;
+      int rifleHWM = 120000;
+      int vampireHWM = 30000;
+      int dataSize = 100;
+      int nShotsPerVampire = 1000000;
+      int expectedSpeed = 50;
+      int batchSize = 100;
+      OneRifleNVampiresBatchBenchmark(nVampires, nIOThreads, rifleHWM, vampireHWM, location, dataSize, nShotsPerVampire, expectedSpeed, batchSize);
+   }
+
+}
+
+TEST_F(RifleVampireTests, OneRifleOneVampireStakeBundles) {
+   if (geteuid() == 0) {
+      std::string location = GetIpcLocation();
+      int nVampires = 1;
+      int nIOThreads = 1;
+      int rifleHWM = 120000;
+      int vampireHWM = 30000;
+      int dataSize = 100;
+      int nShotsPerVampire = 1000000;
+      int expectedSpeed = 50;
+      bool useBundles = true;
+      OneRifleNVampiresStakeBenchmark(nVampires, nIOThreads, rifleHWM, vampireHWM, location, dataSize, nShotsPerVampire, expectedSpeed, useBundles);
+   }
+
+}
+
+TEST_F(RifleVampireTests, RawZmqOneRifleOneVampireInprocPointers) {
+   if (geteuid() == 0) {
+      int hwm = 150000;
+      int nStakes = 1;
+      int nShots = 1000000;
+      int expectedSpeed = 50;
+      RawZmqStakeBenchmark(GetInprocLocation(), hwm, nStakes, nShots, expectedSpeed);
+   }
+
+}
+
+TEST_F(RifleVampireTests, RawZmqOneRifleOneVampireStakeBundles) {
+   if (geteuid() == 0) {
+      int hwm = 30000;
+      int nStakes = SIZE_OF_STAKE_BUNDLE;
+      int nShots = 100000;
+      int expectedSpeed = 50;
+      RawZmqStakeBenchmark(GetIpcLocation(), hwm, nStakes, nShots, expectedSpeed);
+   }
+
+}
+
 TEST_F(RifleVampireTests, OneRifleTwoVampiresPointers) {
    if (geteuid() == 0) {
       std::string location = GetIpcLocation();
@@ -576,6 +974,20 @@ TEST_F(RifleVampireTests, RifleOwnsSocketOneRifleFourVampiresIPCSmallSize) {
    }
 }
 
+TEST_F(RifleVampireTests, RifleOwnsSocketOneRifleFourVampiresIPCSmallSizeCredited) {
+   if (geteuid() == 0) {
+      std::string location = GetIpcLocation();
+      int nVampires = 4;
+      int nIOThreads = 1;
+      int rifleHWM = 120000;
+      int vampireHWM = 30000;
+      int dataSize = 100;
+      int nShotsPerVampire = 1000000;
+      int expectedSpeed = 50;
+      OneRifleNVampiresBenchmark(nVampires, nIOThreads, rifleHWM, vampireHWM, location, dataSize, nShotsPerVampire, expectedSpeed, true);
+   }
+}
+
 TEST_F(RifleVampireTests, OneRifleFourVampiresPointers) {
    if (geteuid() == 0) {
       std::string location = GetIpcLocation();
@@ -633,6 +1045,22 @@ TEST_F(RifleVampireTests, RifleOwnsSocketOneRifleOneVampireTCPSmallSize) {
 
 }
 
+TEST_F(RifleVampireTests, RifleOwnsSocketOneRifleOneVampireTCPSmallSizeBatch) {
+   if (geteuid() == 0) {
+      std::string location = GetTcpLocation();
+      int nVampires = 1;
+      int nIOThreads = 1;
+      int rifleHWM = 120000;
+      int vampireHWM = 30000;
+      int dataSize = 100;
+      int nShotsPerVampire = 3500000;
+      int expectedSpeed = 50;
+      int batchSize = 100;
+      OneRifleNVampiresBatchBenchmark(nVampires, nIOThreads, rifleHWM, vampireHWM, location, dataSize, nShotsPerVampire, expectedSpeed, batchSize);
+   }
+
+}
+
 TEST_F(RifleVampireTests, VampireOwnsSocketOneRifleOneVampireTCPSmallSize) {
    if (geteuid() == 0) {
       std::string location = GetTcpLocation();
@@ -1126,6 +1554,20 @@ TEST_F(RifleVampireTests, VampireOwnsSocketOneRifleOneVampireIPCLargeSize) {
               location, dataSize, nShotsPerRifle, expectedSpeed);
    }
 }
+TEST_F(RifleVampireTests, VampireOwnsSocketOneRifleOneVampireIPCLargeSizeWound) {
+   if (geteuid() == 0) {
+      std::string location = GetIpcLocation();
+      int nRifles = 1;
+      int nIOThreads = 1;
+      int rifleHWM = 500;
+      int vampireHWM = 1000;
+      int dataSize = 65554;
+      int nShotsPerRifle = 10000;
+      int expectedSpeed = 1000;
+      NRiflesOneVampireBenchmarkWound(nRifles, nIOThreads, rifleHWM, vampireHWM,
+              location, dataSize, nShotsPerRifle, expectedSpeed);
+   }
+}
 TEST_F(RifleVampireTests, VampireOwnsSocketOneRifleOneVampireIPCLargeSizeZeroCopy) {
    if (geteuid() == 0) {
       std::string location = GetIpcLocation();
@@ -1330,6 +1772,20 @@ TEST_F(RifleVampireTests, VampireOwnsSocketOneRifleOneVampireTCPLargeSize) {
               location, dataSize, nShotsPerRifle, expectedSpeed);
    }
 }
+TEST_F(RifleVampireTests, VampireOwnsSocketOneRifleOneVampireTCPLargeSizeWound) {
+   if (geteuid() == 0) {
+      std::string location = GetTcpLocation();
+      int nRifles = 1;
+      int nIOThreads = 1;
+      int rifleHWM = 500;
+      int vampireHWM = 1000;
+      int dataSize = 65554;
+      int nShotsPerRifle = 10000;
+      int expectedSpeed = 1000;
+      NRiflesOneVampireBenchmarkWound(nRifles, nIOThreads, rifleHWM, vampireHWM,
+              location, dataSize, nShotsPerRifle, expectedSpeed);
+   }
+}
 TEST_F(RifleVampireTests, VampireOwnsSocketOneRifleOneVampireTCPLargeSizeZeroCopy) {
    if (geteuid() == 0) {
       std::string location = GetTcpLocation();
@@ -1461,6 +1917,160 @@ TEST_F(RifleVampireTests, StopPreparingAlreadyAndJustGo) {
    EXPECT_TRUE(vampire.GetShot(bullet, 1));
 }
 
+TEST_F(RifleVampireTests, FireAVolleyAndDrainIt) {
+   std::string location = GetIpcLocation();
+   Vampire vampire(location);
+   Rifle rifle(location);
+   rifle.Aim();
+   vampire.PrepareToBeShot();
+   std::vector<std::string> bullets;
+   EXPECT_FALSE(vampire.GetShots(bullets, 10, 1));
+   EXPECT_TRUE(bullets.empty());
+   std::vector<std::string> volley;
+   for (int i = 0; i < 10; i++) {
+      volley.push_back(std::to_string(i));
+   }
+   EXPECT_EQ(volley.size(), rifle.FireBatch(volley));
+   // only take part of the volley, the rest should still be waiting
+   EXPECT_TRUE(vampire.GetShots(bullets, 4, 100));
+   ASSERT_EQ(4, bullets.size());
+   EXPECT_EQ("0", bullets[0]);
+   EXPECT_EQ("3", bullets[3]);
+   int received = bullets.size();
+   while (received < 10 && vampire.GetShots(bullets, 10, 100)) {
+      EXPECT_EQ(std::to_string(received), bullets[0]);
+      received += bullets.size();
+   }
+   EXPECT_EQ(10, received);
+
+   std::vector<std::string> blank;
+   EXPECT_EQ(0, rifle.FireBatch(blank, 1));
+   blank.push_back("woo");
+   blank.push_back("");
+   blank.push_back("woo");
+   // stops at the empty bullet
+   EXPECT_EQ(1, rifle.FireBatch(blank, 1));
+}
+
+TEST_F(RifleVampireTests, VolleyWaitsOnceForTheWholeVolley) {
+   std::string location = GetIpcLocation();
+   Vampire vampire(location);
+   vampire.SetHighWater(1);
+   Rifle rifle(location);
+   rifle.SetHighWater(1);
+   ASSERT_TRUE(rifle.Aim());
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   // big enough that the socket buffers only hold a bullet or two
+   std::vector<std::string> volley(40, std::string(1024 * 1024, 'x'));
+   std::atomic<bool> draining(true);
+   boost::thread slow([&vampire, &draining]() {
+      std::string wound;
+      while (draining) {
+         vampire.GetShot(wound, 10);
+         zclock_sleep(50);
+      }
+   });
+   const int64_t start = zclock_time();
+   const size_t fired = rifle.FireBatch(volley, 200);
+   const int64_t elapsed = zclock_time() - start;
+   draining = false;
+   slow.join();
+   // a bullet at a time the slow Vampire would have taken 2 seconds
+   EXPECT_GT(1000, elapsed);
+   EXPECT_GT(volley.size(), fired);
+}
+
+/**
+ * Once the receiving buffers are sized, receiving a shot, stake or bundle of 
+ * stakes should not allocate anything on the receiving thread.
+ */
+TEST_F(RifleVampireTests, GettingShotDoesNotAllocate) {
+   std::string location = GetIpcLocation();
+   Vampire vampire(location);
+   Rifle rifle(location);
+   ASSERT_TRUE(rifle.Aim());
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   const int shots = 100;
+   std::string msg(100, 'a');
+   std::vector<std::pair<void*, unsigned int> > bundle, gotBundle;
+   for (int i = 0; i < SIZE_OF_STAKE_BUNDLE; i++) {
+      bundle.push_back(make_pair(&msg, i));
+   }
+   std::string bullet;
+   void* stake;
+   MallocHook::AddNewHook(&CountAllocation);
+
+   for (int i = 0; i <= shots; i++) {
+      ASSERT_TRUE(rifle.Fire(msg));
+   }
+   ASSERT_TRUE(vampire.GetShot(bullet, 1000));
+   int received = 0;
+   tAllocations = 0;
+   tCountAllocations = true;
+   for (int i = 0; i < shots; i++) {
+      received += vampire.GetShot(bullet, 1000) ? 1 : 0;
+   }
+   tCountAllocations = false;
+   EXPECT_EQ(shots, received);
+   EXPECT_EQ(0, tAllocations);
+
+   for (int i = 0; i < shots; i++) {
+      ASSERT_TRUE(rifle.FireStake(&msg));
+   }
+   received = 0;
+   tAllocations = 0;
+   tCountAllocations = true;
+   for (int i = 0; i < shots; i++) {
+      received += vampire.GetStake(stake, 1000) ? 1 : 0;
+   }
+   tCountAllocations = false;
+   EXPECT_EQ(shots, received);
+   EXPECT_EQ(0, tAllocations);
+
+   for (int i = 0; i <= shots; i++) {
+      ASSERT_TRUE(rifle.FireStakes(bundle));
+   }
+   ASSERT_TRUE(vampire.GetStakes(gotBundle, 1000));
+   received = 0;
+   tAllocations = 0;
+   tCountAllocations = true;
+   for (int i = 0; i < shots; i++) {
+      received += vampire.GetStakes(gotBundle, 1000) ? 1 : 0;
+   }
+   tCountAllocations = false;
+   EXPECT_EQ(shots, received);
+   EXPECT_EQ(0, tAllocations);
+   EXPECT_EQ(bundle.size(), gotBundle.size());
+
+   MallocHook::RemoveNewHook(&CountAllocation);
+}
+
+TEST_F(RifleVampireTests, ShootVampireAndReadTheWound) {
+   std::string location = GetIpcLocation();
+   Vampire vampire(location);
+   Rifle rifle(location);
+   rifle.Aim();
+   vampire.PrepareToBeShot();
+   Wound wound;
+   EXPECT_FALSE(vampire.GetShot(wound, 1));
+   EXPECT_TRUE(wound.empty());
+   std::string msg(1000, 'w');
+   EXPECT_TRUE(rifle.Fire(msg));
+   EXPECT_TRUE(vampire.GetShot(wound, 100));
+   ASSERT_EQ(msg.size(), wound.size());
+   EXPECT_EQ(msg, std::string(wound.data(), wound.size()));
+
+   // moving hands the frame over without copying it
+   const char* held = wound.data();
+   Wound moved(std::move(wound));
+   EXPECT_TRUE(wound.empty());
+   EXPECT_EQ(held, moved.data());
+   wound = std::move(moved);
+   EXPECT_EQ(held, wound.data());
+   wound.Release();
+   EXPECT_TRUE(wound.empty());
+}
+
 TEST_F(RifleVampireTests, NoTargetToShoot) {
    std::string location = GetIpcLocation();
    Rifle rifle(location);
@@ -1474,6 +2084,133 @@ TEST_F(RifleVampireTests, NoTargetToShoot) {
    EXPECT_FALSE(rifle.FireStakes(bundle, 1));
 }
 
+TEST_F(RifleVampireTests, CreditDispatchNeedsCredit) {
+   std::string location = GetIpcLocation();
+   Rifle rifle(location);
+   rifle.SetOwnSocket(true);
+   rifle.SetCreditDispatch(true);
+   EXPECT_TRUE(rifle.GetCreditDispatch());
+   ASSERT_TRUE(rifle.Aim());
+   std::string msg("woo");
+   // nobody has granted any credit
+   EXPECT_FALSE(rifle.Fire(msg, 1));
+
+   Vampire vampire(location);
+   vampire.SetCreditDispatch(true);
+   vampire.SetHighWater(2);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   EXPECT_TRUE(rifle.Fire(msg, 500));
+   EXPECT_TRUE(rifle.Fire(msg, 500));
+   // the Vampire's high water mark is used up
+   EXPECT_FALSE(rifle.Fire(msg, 10));
+   std::string bullet;
+   EXPECT_TRUE(vampire.GetShot(bullet, 100));
+   EXPECT_EQ(msg, bullet);
+   // taking a shot granted the credit back
+   EXPECT_TRUE(rifle.Fire(msg, 500));
+   EXPECT_TRUE(vampire.GetShot(bullet, 100));
+   EXPECT_TRUE(vampire.GetShot(bullet, 100));
+   EXPECT_FALSE(vampire.GetShot(bullet, 1));
+}
+
+TEST_F(RifleVampireTests, CreditDispatchSkipsBusyVampires) {
+   std::string location = GetIpcLocation();
+   Rifle rifle(location);
+   rifle.SetOwnSocket(true);
+   rifle.SetCreditDispatch(true);
+   ASSERT_TRUE(rifle.Aim());
+   Vampire busy(location);
+   busy.SetCreditDispatch(true);
+   busy.SetHighWater(2);
+   ASSERT_TRUE(busy.PrepareToBeShot());
+   Vampire idle(location);
+   idle.SetCreditDispatch(true);
+   idle.SetHighWater(2);
+   ASSERT_TRUE(idle.PrepareToBeShot());
+
+   std::string msg("woo");
+   for (int i = 0; i < 4; i++) {
+      EXPECT_TRUE(rifle.Fire(msg, 500));
+   }
+   std::string bullet;
+   EXPECT_TRUE(idle.GetShot(bullet, 100));
+   EXPECT_TRUE(idle.GetShot(bullet, 100));
+   // only the Vampire that kept up gets more bullets
+   EXPECT_TRUE(rifle.Fire(msg, 500));
+   EXPECT_TRUE(rifle.Fire(msg, 500));
+   EXPECT_TRUE(idle.GetShot(bullet, 100));
+   EXPECT_TRUE(idle.GetShot(bullet, 100));
+   EXPECT_FALSE(idle.GetShot(bullet, 1));
+   EXPECT_TRUE(busy.GetShot(bullet, 100));
+   EXPECT_TRUE(busy.GetShot(bullet, 100));
+   EXPECT_FALSE(busy.GetShot(bullet, 1));
+}
+
+TEST_F(RifleVampireTests, TryGetShotSkipsInvalidShots) {
+   std::string location = GetIpcLocation();
+   Vampire vampire(location);
+   vampire.SetLatencyTracking(true);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   Rifle rifle(location);
+   rifle.SetOwnSocket(true);
+   ASSERT_TRUE(rifle.Aim());
+   // too short to carry a time stamp
+   ASSERT_TRUE(rifle.Fire("bad", 500));
+   rifle.SetLatencyTracking(true);
+   ASSERT_TRUE(rifle.Fire("good", 500));
+   zclock_sleep(100);
+   std::string bullet;
+   EXPECT_TRUE(vampire.TryGetShot(bullet));
+   EXPECT_EQ("good", bullet);
+   EXPECT_EQ(1, vampire.GetStats().mInvalidMessages);
+   EXPECT_FALSE(vampire.TryGetShot(bullet));
+}
+
+TEST_F(RifleVampireTests, EpollOnReadFd) {
+   std::string location = GetIpcLocation();
+   Vampire vampire(location);
+   EXPECT_EQ(-1, vampire.GetReadFd());
+   std::string bullet;
+   EXPECT_FALSE(vampire.TryGetShot(bullet));
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   const int fd = vampire.GetReadFd();
+   ASSERT_LE(0, fd);
+   int epollFd = epoll_create1(0);
+   ASSERT_LE(0, epollFd);
+   struct epoll_event event;
+   event.events = EPOLLIN | EPOLLET;
+   event.data.fd = fd;
+   ASSERT_EQ(0, epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event));
+   EXPECT_FALSE(vampire.TryGetShot(bullet));
+
+   Rifle rifle(location);
+   rifle.SetOwnSocket(true);
+   ASSERT_TRUE(rifle.Aim());
+   const int nShots = 100;
+   for (int i = 0; i < nShots; i++) {
+      ASSERT_TRUE(rifle.Fire(std::to_string(i), 500));
+   }
+   int shots = 0;
+   for (int waits = 0; waits < 100 && shots < nShots; waits++) {
+      // drain after every wake up, the fd only fires on a change
+      while (vampire.TryGetShot(bullet)) {
+         EXPECT_EQ(std::to_string(shots), bullet);
+         shots++;
+      }
+      struct epoll_event ready;
+      epoll_wait(epollFd, &ready, 1, 10);
+   }
+   EXPECT_EQ(nShots, shots);
+   Wound wound;
+   EXPECT_FALSE(vampire.TryGetShot(wound));
+   ASSERT_TRUE(rifle.Fire("wound", 500));
+   struct epoll_event ready;
+   EXPECT_EQ(1, epoll_wait(epollFd, &ready, 1, 500));
+   EXPECT_TRUE(vampire.TryGetShot(wound));
+   EXPECT_EQ("wound", std::string(wound.data(), wound.size()));
+   close(epollFd);
+}
+
 TEST_F(RifleVampireTests, ThisWillNeverWorkStopTrying) {
    std::string location = "blahblahblah";
    Vampire vampire(location);
@@ -1586,6 +2323,30 @@ TEST_F(RifleVampireTests, StakesInTheDark) {
    EXPECT_FALSE(rifle.FireStakes(bundle, 1));
 }
 
+TEST_F(RifleVampireTests, ZeroCopyInTheDark) {
+   Rifle rifle(GetIpcLocation());
+   rifle.Aim();
+   mShotsDeleted.store(0);
+   std::string* zero = new std::string("Fire!");
+   //should fail without someone to shoot, and hand the shot back to be freed.
+   EXPECT_FALSE(rifle.FireZeroCopy(zero, zero->size(), TestDeleteString, 1));
+   EXPECT_EQ(1, mShotsDeleted);
+}
+
+TEST_F(RifleVampireTests, ZeroCopyFreedWhenNotFired) {
+   mShotsDeleted.store(0);
+   Rifle unaimed(GetIpcLocation());
+   std::string* zero = new std::string("Fire!");
+   EXPECT_FALSE(unaimed.FireZeroCopy(zero, zero->size(), TestDeleteString, 1));
+   EXPECT_EQ(1, mShotsDeleted);
+
+   Rifle rifle(GetIpcLocation());
+   rifle.Aim();
+   zero = new std::string;
+   EXPECT_FALSE(rifle.FireZeroCopy(zero, 0, TestDeleteString, 1));
+   EXPECT_EQ(2, mShotsDeleted);
+}
+
 TEST_F(RifleVampireTests, LoadRifleAndThrowAway) {
    Rifle* rifle = new Rifle(GetIpcLocation());
    rifle->Aim();
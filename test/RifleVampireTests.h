@@ -28,25 +28,36 @@ public:
            std::string& binding, std::vector<std::pair<void*, unsigned int> >& exampleData, 
            bool ownSocket);
    void VampireThread(int numberOfMessages, std::string& location,
-         std::string& exampleData, int hwm, int ioThreads, bool ownSocket);
+         std::string& exampleData, int hwm, int ioThreads, bool ownSocket,
+         bool creditDispatch);
+   void BatchVampireThread(int numberOfMessages, std::string& location,
+         std::string& exampleData, int hwm, int ioThreads, int batchSize);
    void StakeAVampireThread(int numberOfMessages,
            std::string& location, std::vector<std::pair<void*, unsigned int> >& exampleData, 
-           int hwm, int ioThreads);
+           int hwm, int ioThreads, bool useBundles);
    void ShootZeroCopyThread(int numberOfMessages,
         std::string& location, std::string& exampleData,int hwm, int ioThreads, 
         bool ownSocket);
    void OneRifleNVampiresBenchmark(int nVampires, int nIOThreads,
            int rifleHWM, int vampireHWM, std::string& location, int dataSize,
-           int nShotsPerVampire, int expectedSpeed);
+           int nShotsPerVampire, int expectedSpeed, bool creditDispatch = false);
+   void OneRifleNVampiresBatchBenchmark(int nVampires, int nIOThreads,
+           int rifleHWM, int vampireHWM, std::string& location, int dataSize,
+           int nShotsPerVampire, int expectedSpeed, int batchSize);
    void OneRifleNVampiresStakeBenchmark(int nVampires, int nIOThreads,
            int rifleHWM, int vampireHWM, std::string& location, int dataSize,
-           int nShotsPerVampire, int expectedSpeed);
+           int nShotsPerVampire, int expectedSpeed, bool useBundles = false);
    void NRiflesOneVampireBenchmark(int nRifles, int nIOThreads,
            int rifleHWM, int vampireHWM, std::string& location, int dataSize,
            int nShotsPerRifle, int expectedSpeed);
+   void NRiflesOneVampireBenchmarkWound(int nRifles, int nIOThreads,
+           int rifleHWM, int vampireHWM, std::string& location, int dataSize,
+           int nShotsPerRifle, int expectedSpeed);
    void NRiflesOneVampireBenchmarkZeroCopy(int nRifles, int nIOThreads,
            int rifleHWM, int vampireHWM, std::string& location, int dataSize,
            int nShotsPerRifle, int expectedSpeed);
+   void RawZmqInprocBenchmark(int hwm, int dataSize, int nShots, int expectedSpeed);
+   void RawZmqStakeBenchmark(std::string location, int hwm, int nStakes, int nShots, int expectedSpeed);
 
    class RifleAmmo {
    public:
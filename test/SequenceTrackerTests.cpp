@@ -0,0 +1,61 @@
+#include <string>
+
+#include "SequenceTrackerTests.h"
+
+TEST_F(SequenceTrackerTests, EncodeDecode) {
+   char frame[SequenceTracker::kSequenceSize];
+   uint64_t sequence = 0;
+   SequenceTracker::Encode(0x0102030405060708ULL, frame);
+   EXPECT_EQ(1, frame[0]);
+   EXPECT_EQ(8, frame[7]);
+   EXPECT_TRUE(SequenceTracker::Decode(frame, sizeof (frame), sequence));
+   EXPECT_EQ(0x0102030405060708ULL, sequence);
+   SequenceTracker::Encode(UINT64_MAX, frame);
+   EXPECT_TRUE(SequenceTracker::Decode(frame, sizeof (frame), sequence));
+   EXPECT_EQ(UINT64_MAX, sequence);
+   EXPECT_FALSE(SequenceTracker::Decode(frame, sizeof (frame) - 1, sequence));
+}
+
+TEST_F(SequenceTrackerTests, GapsDuplicatesAndReorders) {
+   SequenceTracker tracker;
+   const std::string a("a");
+   const std::string b("b");
+   // joining late isn't a gap
+   tracker.Track(a.data(), a.size(), 10);
+   tracker.Track(a.data(), a.size(), 11);
+   tracker.Track(b.data(), b.size(), 1);
+   SequenceTracker::Snapshot snapshot = tracker.GetSnapshot();
+   EXPECT_EQ(3, snapshot.mSequenced);
+   EXPECT_EQ(2, snapshot.mTopics);
+   EXPECT_EQ(0, snapshot.mGaps);
+   EXPECT_EQ(0, snapshot.mDropped);
+
+   tracker.Track(a.data(), a.size(), 15);
+   tracker.Track(b.data(), b.size(), 3);
+   tracker.Track(b.data(), b.size(), 3);
+   tracker.Track(b.data(), b.size(), 2);
+   tracker.Track(a.data(), a.size(), 16);
+   snapshot = tracker.GetSnapshot();
+   EXPECT_EQ(8, snapshot.mSequenced);
+   EXPECT_EQ(2, snapshot.mTopics);
+   EXPECT_EQ(2, snapshot.mGaps);
+   EXPECT_EQ(4, snapshot.mDropped);
+   EXPECT_EQ(1, snapshot.mDuplicates);
+   EXPECT_EQ(1, snapshot.mReordered);
+}
+
+TEST_F(SequenceTrackerTests, RestartStartsTheTopicOver) {
+   SequenceTracker tracker;
+   const std::string a("a");
+   tracker.Track(a.data(), a.size(), 41);
+   tracker.Track(a.data(), a.size(), 42);
+   tracker.Track(a.data(), a.size(), 1);
+   tracker.Track(a.data(), a.size(), 2);
+   tracker.Track(a.data(), a.size(), 3);
+   SequenceTracker::Snapshot snapshot = tracker.GetSnapshot();
+   EXPECT_EQ(1, snapshot.mRestarts);
+   EXPECT_EQ(0, snapshot.mReordered);
+   EXPECT_EQ(0, snapshot.mGaps);
+   EXPECT_EQ(0, snapshot.mDuplicates);
+   EXPECT_EQ(1, snapshot.mTopics);
+}
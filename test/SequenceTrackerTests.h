@@ -0,0 +1,21 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include "SequenceTracker.h"
+
+class SequenceTrackerTests : public ::testing::Test {
+public:
+
+   SequenceTrackerTests() {
+   };
+
+protected:
+
+   virtual void SetUp() {
+   };
+
+   virtual void TearDown() {
+   };
+private:
+
+};
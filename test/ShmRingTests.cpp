@@ -0,0 +1,177 @@
+#include <sys/wait.h>
+#include <memory>
+#include <thread>
+
+#include "ShmRingTests.h"
+#include "Rifle.h"
+#include "Vampire.h"
+#include "Death.h"
+#include "FileIO.h"
+
+TEST_F(ShmRingTests, NotShm) {
+   EXPECT_TRUE(ShmRing::IsShm("shm://foo"));
+   EXPECT_FALSE(ShmRing::IsShm("ipc:///tmp/foo"));
+   EXPECT_EQ("/dev/shm/foo", ShmRing::GetShmFile("shm://foo"));
+   Rifle rifle("shm://no/slashes");
+   EXPECT_FALSE(rifle.Aim());
+}
+
+TEST_F(ShmRingTests, OneRifleOneVampire) {
+   std::string location = GetShmLocation();
+   Rifle rifle(location);
+   Vampire vampire(location);
+   ASSERT_TRUE(rifle.Aim());
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   EXPECT_TRUE(FileIO::DoesFileExist(ShmRing::GetShmFile(location)));
+
+   std::string bullet("bang");
+   std::string wound;
+   EXPECT_FALSE(vampire.GetShot(wound, 1));
+   EXPECT_TRUE(rifle.Fire(bullet, 100));
+   EXPECT_TRUE(vampire.GetShot(wound, 100));
+   EXPECT_EQ(bullet, wound);
+
+   EXPECT_TRUE(rifle.FireStake(&bullet, 100));
+   void* stake = NULL;
+   EXPECT_TRUE(vampire.GetStake(stake, 100));
+   EXPECT_EQ(&bullet, stake);
+
+   std::vector<std::pair<void*, unsigned int> > stakes;
+   stakes.push_back(std::make_pair(&bullet, 1));
+   stakes.push_back(std::make_pair(&wound, 2));
+   EXPECT_TRUE(rifle.FireStakes(stakes, 100));
+   std::vector<std::pair<void*, unsigned int> > gotStakes;
+   EXPECT_TRUE(vampire.GetStakes(gotStakes, 100));
+   EXPECT_EQ(stakes, gotStakes);
+
+   Wound held;
+   EXPECT_TRUE(rifle.Fire(bullet, 100));
+   EXPECT_TRUE(vampire.GetShot(held, 100));
+   EXPECT_EQ(bullet, std::string(held.data(), held.size()));
+
+   std::vector<std::string> volley(10, "volley");
+   EXPECT_EQ(volley.size(), rifle.FireBatch(volley, 100));
+   std::vector<std::string> wounds;
+   EXPECT_TRUE(vampire.GetShots(wounds, 100, 100));
+   EXPECT_EQ(volley, wounds);
+}
+
+TEST_F(ShmRingTests, HighWaterLimitsTheQueue) {
+   std::string location = GetShmLocation();
+   Rifle rifle(location);
+   rifle.SetHighWater(2);
+   Vampire vampire(location);
+   vampire.SetHighWater(2);
+   ASSERT_TRUE(rifle.Aim());
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   std::string bullet("bang");
+   for (int i = 0; i < 4; i++) {
+      EXPECT_TRUE(rifle.Fire(bullet, 0));
+   }
+   EXPECT_FALSE(rifle.Fire(bullet, 10));
+   std::string wound;
+   EXPECT_TRUE(vampire.GetShot(wound, 0));
+   EXPECT_TRUE(rifle.Fire(bullet, 0));
+}
+
+TEST_F(ShmRingTests, BulletsWrapAroundTheRing) {
+   std::string location = GetShmLocation();
+   Rifle rifle(location);
+   rifle.SetHighWater(1000);
+   Vampire vampire(location);
+   ASSERT_TRUE(rifle.Aim());
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   // odd sizes so records end up straddling the end of the ring
+   std::string wound;
+   size_t written = 0;
+   for (int i = 0; written < 3 * ShmRing::kRingBytes; i++) {
+      std::string bullet(65536 + (i % 13), 'a' + (i % 26));
+      ASSERT_TRUE(rifle.Fire(bullet, 100));
+      ASSERT_TRUE(vampire.GetShot(wound, 100));
+      ASSERT_EQ(bullet, wound);
+      written += bullet.size();
+   }
+   std::string tooBig(ShmRing::kRingBytes, 'x');
+   EXPECT_FALSE(rifle.Fire(tooBig, 0));
+}
+
+TEST_F(ShmRingTests, VampireInAnotherProcess) {
+   std::string location = GetShmLocation();
+   const int count = 100000;
+   Rifle rifle(location);
+   rifle.SetHighWater(100);
+   ASSERT_TRUE(rifle.Aim());
+   pid_t child = fork();
+   ASSERT_NE(-1, child);
+   if (child == 0) {
+      Vampire vampire(location);
+      int status = vampire.PrepareToBeShot() ? 0 : 1;
+      std::string wound;
+      for (int i = 0; i < count && status == 0; i++) {
+         if (!vampire.GetShot(wound, 5000) || wound != std::to_string(i)) {
+            status = 2;
+         }
+      }
+      _exit(status);
+   }
+   for (int i = 0; i < count; i++) {
+      ASSERT_TRUE(rifle.Fire(std::to_string(i), 5000));
+   }
+   int status = -1;
+   ASSERT_EQ(child, waitpid(child, &status, 0));
+   ASSERT_TRUE(WIFEXITED(status));
+   EXPECT_EQ(0, WEXITSTATUS(status));
+}
+
+TEST_F(ShmRingTests, OwnerRemovesTheFile) {
+   std::string location = GetShmLocation();
+   {
+      Rifle rifle(location);
+      ASSERT_TRUE(rifle.Aim());
+      ASSERT_TRUE(FileIO::DoesFileExist(ShmRing::GetShmFile(location)));
+   }
+   EXPECT_FALSE(FileIO::DoesFileExist(ShmRing::GetShmFile(location)));
+}
+
+TEST_F(ShmRingTests, VampireFollowsARestartedRifle) {
+   std::string location = GetShmLocation();
+   std::string bullet("before");
+   const char* data = NULL;
+   size_t size = 0;
+   // a crashed Rifle that didn't own the ring left a bullet behind
+   {
+      ShmRing leftover(location, true, false, 10);
+      ASSERT_TRUE(leftover.Open());
+      ASSERT_TRUE(leftover.Fire(bullet.data(), bullet.size(), 0));
+   }
+   std::unique_ptr<ShmRing> rifle(new ShmRing(location, true, true, 10));
+   ASSERT_TRUE(rifle->Open());
+   ShmRing vampire(location, false, false, 10);
+   ASSERT_TRUE(vampire.Open());
+   EXPECT_FALSE(vampire.Feed(0, data, size));
+
+   ASSERT_TRUE(rifle->Fire(bullet.data(), bullet.size(), 0));
+   ASSERT_TRUE(vampire.Feed(100, data, size));
+   EXPECT_EQ(bullet, std::string(data, size));
+   vampire.Digest();
+
+   rifle.reset(new ShmRing(location, true, true, 10));
+   ASSERT_TRUE(rifle->Open());
+   bullet = "after";
+   ASSERT_TRUE(rifle->Fire(bullet.data(), bullet.size(), 0));
+   ASSERT_TRUE(vampire.Feed(1000, data, size));
+   EXPECT_EQ(bullet, std::string(data, size));
+   vampire.Digest();
+}
+
+TEST_F(ShmRingTests, shmFilesCleanedOnFatal) {
+   std::string target("shm://rifleVampireDeath");
+   Rifle stick{target};
+   Vampire vamp{target};
+   Death::SetupExitHandler();
+   ASSERT_TRUE(stick.Aim());
+   ASSERT_TRUE(vamp.PrepareToBeShot());
+   ASSERT_TRUE(FileIO::DoesFileExist(ShmRing::GetShmFile(target)));
+   CHECK(false);
+   ASSERT_FALSE(FileIO::DoesFileExist(ShmRing::GetShmFile(target)));
+}
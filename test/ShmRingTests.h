@@ -0,0 +1,31 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include <unistd.h>
+#include <string>
+#include "ShmRing.h"
+
+class ShmRingTests : public ::testing::Test {
+public:
+
+   ShmRingTests() {
+   };
+
+   static std::string GetShmLocation() {
+      std::string location("shm://ShmRingTests");
+      location.append(std::to_string(getpid()));
+      return location;
+   }
+
+protected:
+
+   virtual void SetUp() {
+      ShmRing::DeleteShmFiles(GetShmLocation());
+   };
+
+   virtual void TearDown() {
+      ShmRing::DeleteShmFiles(GetShmLocation());
+   };
+private:
+
+};
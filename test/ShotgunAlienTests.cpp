@@ -2,11 +2,20 @@
 #include "boost/pointer_cast.hpp"
 #include <czmq.h>
 #include <thread>
+#include <map>
 #include <boost/thread.hpp>
+#include <sys/epoll.h>
 
 #include "ShotgunAlienTests.h"
 #include "Death.h"
 #include "FileIO.h"
+std::atomic<int> ShotgunAlienTests::mShotsDeleted(0);
+
+void ShotgunAlienTests::DeleteShot(void*, void* data) {
+   delete reinterpret_cast<std::string*> (data);
+   mShotsDeleted++;
+}
+
 void * ShotgunAlienTests::ShotgunThread(void * arg) {
    ShotgunAmmo* ammo = static_cast<ShotgunAmmo*> (arg);
    printf("shooting %d bullet(s) at %s\n", ammo->count, ammo->location.c_str());
@@ -180,4 +189,394 @@ TEST_F(ShotgunAlienTests, ipcFilesCleanedOnFatal) {
    ASSERT_TRUE(FileIO::DoesFileExist(addressRealPath));
    CHECK(false);
    ASSERT_FALSE(FileIO::DoesFileExist(addressRealPath));
-}
\ No newline at end of file
+}
+TEST_F(ShotgunAlienTests, EpollOnReadFd) {
+   std::string location = GetTcpLocation();
+   Shotgun shotgun;
+   shotgun.Aim(location);
+   Alien alien;
+   alien.PrepareToBeShot(location);
+   const int fd = alien.GetReadFd();
+   ASSERT_LE(0, fd);
+   int epollFd = epoll_create1(0);
+   ASSERT_LE(0, epollFd);
+   struct epoll_event event;
+   event.events = EPOLLIN | EPOLLET;
+   event.data.fd = fd;
+   ASSERT_EQ(0, epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event));
+
+   std::vector<std::string> bullets;
+   EXPECT_FALSE(alien.TryGetShot(bullets));
+   int shots = 0;
+   // publish until the subscription has gone through
+   for (int i = 0; i < 200 && shots < 10; i++) {
+      shotgun.Fire("Fire!");
+      struct epoll_event ready;
+      epoll_wait(epollFd, &ready, 1, 10);
+      while (alien.TryGetShot(bullets)) {
+         ASSERT_EQ(2, bullets.size());
+         EXPECT_EQ("Fire!", bullets[1]);
+         shots++;
+      }
+   }
+   EXPECT_EQ(10, shots);
+   close(epollFd);
+}
+
+TEST_F(ShotgunAlienTests, TopicFiltering) {
+   std::string location = GetTcpLocation();
+   Shotgun shotgun;
+   shotgun.Aim(location);
+   Alien alien;
+   EXPECT_TRUE(alien.Subscribe("prices."));
+   alien.PrepareToBeShot(location);
+   std::vector<std::string> bullets;
+   bullets.push_back("Fire!");
+   std::vector<std::string> shots;
+   std::string topic;
+   int prices = 0;
+   // publish until the subscription has gone through
+   for (int i = 0; i < 200 && prices < 10; i++) {
+      shotgun.Fire("news.today", bullets);
+      shotgun.Fire("prices.today", bullets);
+      shotgun.Fire(bullets);
+      alien.GetShot(10, topic, shots);
+      while (!shots.empty()) {
+         EXPECT_EQ("prices.today", topic);
+         ASSERT_EQ(1, shots.size());
+         EXPECT_EQ("Fire!", shots[0]);
+         prices++;
+         alien.GetShot(0, topic, shots);
+      }
+   }
+   EXPECT_EQ(10, prices);
+
+   EXPECT_TRUE(alien.Subscribe("news."));
+   EXPECT_TRUE(alien.Unsubscribe("prices."));
+   int news = 0;
+   for (int i = 0; i < 200 && news < 10; i++) {
+      shotgun.Fire("news.today", bullets);
+      shotgun.Fire(bullets);
+      alien.GetShot(10, topic, shots);
+      while (!shots.empty()) {
+         // prices shots sent before the unsubscribe may still be queued
+         if (topic != "prices.today") {
+            EXPECT_EQ("news.today", topic);
+            news++;
+         }
+         alien.GetShot(0, topic, shots);
+      }
+   }
+   EXPECT_EQ(10, news);
+   EXPECT_FALSE(shotgun.IsJammed());
+   EXPECT_EQ(0, shotgun.GetStats().mSendErrors);
+}
+
+TEST_F(ShotgunAlienTests, SubscribeAfterPrepareStopsEverything) {
+   std::string location = GetTcpLocation();
+   Shotgun shotgun;
+   shotgun.Aim(location);
+   Alien alien;
+   alien.PrepareToBeShot(location);
+   std::vector<std::string> bullets;
+   bullets.push_back("Fire!");
+   std::vector<std::string> shots;
+   std::string topic;
+   int untopical = 0;
+   for (int i = 0; i < 200 && untopical == 0; i++) {
+      shotgun.Fire(bullets);
+      alien.GetShot(10, topic, shots);
+      if (!shots.empty()) {
+         EXPECT_TRUE(topic.empty());
+         untopical++;
+      }
+   }
+   ASSERT_EQ(1, untopical);
+   EXPECT_TRUE(alien.Subscribe("prices."));
+   int prices = 0;
+   for (int i = 0; i < 200 && prices == 0; i++) {
+      shotgun.Fire(bullets);
+      shotgun.Fire("prices.today", bullets);
+      alien.GetShot(10, topic, shots);
+      if (!shots.empty() && topic == "prices.today") {
+         prices++;
+      }
+   }
+   ASSERT_EQ(1, prices);
+   // once the new subscriptions are through, nothing untopical is sent
+   shotgun.Fire(bullets);
+   shotgun.Fire("prices.today", bullets);
+   std::string last;
+   for (alien.GetShot(100, topic, shots); !shots.empty(); alien.GetShot(100, topic, shots)) {
+      last = topic;
+   }
+   EXPECT_EQ("prices.today", last);
+}
+
+TEST_F(ShotgunAlienTests, SingleBulletKeepsItsFrames) {
+   std::string location = GetTcpLocation();
+   Shotgun shotgun;
+   shotgun.Aim(location);
+   Alien alien;
+   alien.PrepareToBeShot(location);
+   std::vector<std::string> shots;
+   std::string topic;
+   for (int i = 0; i < 200 && shots.empty(); i++) {
+      shotgun.Fire("Fire!");
+      alien.GetShot(10, topic, shots);
+   }
+   EXPECT_TRUE(topic.empty());
+   ASSERT_EQ(2, shots.size());
+   EXPECT_EQ("dummy", shots[0]);
+   EXPECT_EQ("Fire!", shots[1]);
+   EXPECT_EQ(shotgun.GetStats().mBytes, shotgun.GetStats().mMessages * (5 + 5));
+}
+
+TEST_F(ShotgunAlienTests, FireZeroCopy) {
+   std::string location = GetTcpLocation();
+   Shotgun shotgun;
+   shotgun.Aim(location);
+   Alien first;
+   first.Subscribe("blob");
+   first.PrepareToBeShot(location);
+   Alien second;
+   second.Subscribe("blob");
+   second.PrepareToBeShot(location);
+   mShotsDeleted = 0;
+   const std::string blob(64 * 1024, 'z');
+   std::vector<std::string> shots;
+   std::string topic;
+   int fired = 0;
+   int firstShots = 0;
+   int secondShots = 0;
+   for (int i = 0; i < 200 && (firstShots == 0 || secondShots == 0); i++) {
+      EXPECT_TRUE(shotgun.FireZeroCopy("blob", new std::string(blob), blob.size(), DeleteShot));
+      fired++;
+      first.GetShot(10, topic, shots);
+      if (!shots.empty()) {
+         EXPECT_EQ("blob", topic);
+         ASSERT_EQ(1, shots.size());
+         EXPECT_EQ(blob, shots[0]);
+         firstShots++;
+      }
+      second.GetShot(10, topic, shots);
+      if (!shots.empty()) {
+         EXPECT_EQ(blob, shots[0]);
+         secondShots++;
+      }
+   }
+   EXPECT_LT(0, firstShots);
+   EXPECT_LT(0, secondShots);
+   // each blob is freed once, after every subscriber has had it
+   for (int i = 0; i < 100 && mShotsDeleted < fired; i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+   }
+   EXPECT_EQ(fired, mShotsDeleted);
+   EXPECT_EQ(fired * blob.size(), shotgun.GetStats().mBytes);
+}
+
+TEST_F(ShotgunAlienTests, VisitBullets) {
+   std::string location = GetTcpLocation();
+   Shotgun shotgun;
+   shotgun.Aim(location);
+   Alien alien;
+   alien.PrepareToBeShot(location);
+   std::vector<std::string> bullets;
+   bullets.push_back("Fire!");
+   bullets.push_back("");
+   bullets.push_back("again!");
+   std::vector<std::string> visited;
+   std::string topic;
+   Alien::Visitor visitor = [&](const Alien::View& shotTopic, const Alien::View& bullet) {
+      topic.assign(shotTopic.mData, shotTopic.mSize);
+      visited.push_back(std::string(bullet.mData, bullet.mSize));
+   };
+   EXPECT_FALSE(alien.GetShot(0, visitor));
+   bool shot = false;
+   for (int i = 0; i < 200 && !shot; i++) {
+      shotgun.Fire("topic", bullets);
+      shot = alien.GetShot(10, visitor);
+   }
+   ASSERT_TRUE(shot);
+   EXPECT_EQ("topic", topic);
+   EXPECT_EQ(bullets, visited);
+   EXPECT_EQ(1, alien.GetStats().mMessages);
+   EXPECT_EQ(11, alien.GetStats().mBytes);
+}
+
+TEST_F(ShotgunAlienTests, LastValueCacheForLateAliens) {
+   std::string location = GetTcpLocation();
+   std::string snapshots = GetIpcLocation();
+   Shotgun shotgun;
+   EXPECT_FALSE(shotgun.GetLastValueCache());
+   ASSERT_TRUE(shotgun.SetLastValueCache(snapshots));
+   EXPECT_TRUE(shotgun.GetLastValueCache());
+   EXPECT_FALSE(shotgun.SetLastValueCache(snapshots));
+   shotgun.Aim(location);
+   std::vector<std::string> bullets(1);
+   bullets[0] = "1";
+   shotgun.Fire("prices.a", bullets);
+   shotgun.Fire("news.a", bullets);
+   bullets[0] = "2";
+   shotgun.Fire("prices.a", bullets);
+   bullets[0] = "3";
+   shotgun.Fire("prices.b", bullets);
+
+   // nothing more is fired, the snapshot comes from the cache alone
+   Alien alien;
+   alien.Subscribe("prices.");
+   alien.PrepareToBeShot(location);
+   std::map<std::string, std::vector<std::string> > snapshot;
+   ASSERT_TRUE(alien.GetSnapshot(snapshots, "prices.", snapshot, 1000));
+   ASSERT_EQ(2, snapshot.size());
+   EXPECT_EQ(std::vector<std::string>(1, "2"), snapshot["prices.a"]);
+   EXPECT_EQ(std::vector<std::string>(1, "3"), snapshot["prices.b"]);
+   std::string topic;
+   std::vector<std::string> shots;
+   alien.GetShot(100, topic, shots);
+   EXPECT_TRUE(shots.empty());
+
+   EXPECT_TRUE(alien.GetSnapshot(snapshots, "weather.", snapshot, 1000));
+   EXPECT_TRUE(snapshot.empty());
+   EXPECT_FALSE(alien.GetSnapshot(GetInprocLocation(), "", snapshot, 100));
+}
+
+TEST_F(ShotgunAlienTests, SnapshotThenSequencedShots) {
+   std::string location = GetTcpLocation();
+   std::string snapshots = GetIpcLocation();
+   Shotgun shotgun;
+   shotgun.SetSequencing(true);
+   ASSERT_TRUE(shotgun.SetLastValueCache(snapshots));
+   shotgun.Aim(location);
+   std::vector<std::string> bullets(1, "1");
+   shotgun.Fire("a", bullets);
+   shotgun.Fire("a", bullets);
+
+   Alien alien;
+   alien.SetSequencing(true);
+   alien.Subscribe("a");
+   alien.Subscribe("probe");
+   alien.PrepareToBeShot(location);
+   std::string topic;
+   std::vector<std::string> shots;
+   // publish until the subscription has gone through
+   for (int i = 0; i < 200 && shots.empty(); i++) {
+      shotgun.Fire("probe", bullets);
+      alien.GetShot(10, topic, shots);
+   }
+   ASSERT_FALSE(shots.empty());
+   std::map<std::string, std::vector<std::string> > snapshot;
+   ASSERT_TRUE(alien.GetSnapshot(snapshots, "a", snapshot, 1000));
+   ASSERT_EQ(1, snapshot.size());
+   bullets[0] = "2";
+   shotgun.Fire("a", bullets);
+   for (int i = 0; i < 200 && topic != "a"; i++) {
+      alien.GetShot(10, topic, shots);
+   }
+   ASSERT_EQ("a", topic);
+   EXPECT_EQ(bullets, shots);
+   EXPECT_EQ(0, alien.GetSequenceStats().mGaps);
+}
+
+TEST_F(ShotgunAlienTests, ConflateToTheLatestPerTopic) {
+   std::string location = GetTcpLocation();
+   Shotgun shotgun;
+   shotgun.Aim(location);
+   Alien alien;
+   alien.SetConflate(true);
+   EXPECT_TRUE(alien.GetConflate());
+   alien.PrepareToBeShot(location);
+   std::vector<std::string> bullets(1);
+   std::vector<std::string> shots;
+   std::string topic;
+   // publish until the subscription has gone through
+   for (int i = 0; i < 200 && shots.empty(); i++) {
+      bullets[0] = "probe";
+      shotgun.Fire("probe", bullets);
+      alien.GetShot(10, topic, shots);
+   }
+   ASSERT_FALSE(shots.empty());
+   for (int i = 0; i < 1000; i++) {
+      bullets[0] = std::to_string(i);
+      shotgun.Fire("x", bullets);
+      shotgun.Fire("y", bullets);
+   }
+   std::this_thread::sleep_for(std::chrono::milliseconds(200));
+   std::map<std::string, std::vector<std::string> > seen;
+   for (alien.GetShot(0, topic, shots); !shots.empty(); alien.GetShot(0, topic, shots)) {
+      seen[topic].push_back(shots[0]);
+   }
+   ASSERT_EQ(1, seen["x"].size());
+   EXPECT_EQ("999", seen["x"][0]);
+   ASSERT_EQ(1, seen["y"].size());
+   EXPECT_EQ("999", seen["y"][0]);
+   EXPECT_GE(1, seen["probe"].size());
+   EXPECT_LE(2001, alien.GetStats().mMessages);
+}
+
+TEST_F(ShotgunAlienTests, SequenceNumbers) {
+   std::string location = GetTcpLocation();
+   Shotgun shotgun;
+   shotgun.SetSequencing(true);
+   EXPECT_TRUE(shotgun.GetSequencing());
+   shotgun.Aim(location);
+   Alien alien;
+   alien.SetSequencing(true);
+   EXPECT_TRUE(alien.GetSequencing());
+   alien.Subscribe("seen");
+   alien.PrepareToBeShot(location);
+   std::vector<std::string> bullets(1, "Fire!");
+   std::vector<std::string> shots;
+   std::string topic;
+   for (int i = 0; i < 200 && shots.empty(); i++) {
+      shotgun.Fire("seen", bullets);
+      alien.GetShot(10, topic, shots);
+   }
+   ASSERT_EQ(1, shots.size());
+   EXPECT_EQ("Fire!", shots[0]);
+   for (alien.GetShot(10, topic, shots); !shots.empty(); alien.GetShot(10, topic, shots)) {
+   }
+   // sequences are per topic, shots at topics nobody wants aren't gaps
+   shotgun.Fire("unseen", bullets);
+   shotgun.Fire("seen", bullets);
+   shotgun.Fire("seen", bullets);
+   int visited = 0;
+   for (int i = 0; i < 100 && visited < 2; i++) {
+      alien.GetShot(10, [&](const Alien::View&, const Alien::View & bullet) {
+         EXPECT_EQ("Fire!", std::string(bullet.mData, bullet.mSize));
+         visited++;
+      });
+   }
+   EXPECT_EQ(2, visited);
+   SequenceTracker::Snapshot sequences = alien.GetSequenceStats();
+   EXPECT_EQ(alien.GetStats().mMessages, sequences.mSequenced);
+   EXPECT_EQ(1, sequences.mTopics);
+   EXPECT_EQ(0, sequences.mGaps);
+   EXPECT_EQ(0, sequences.mDropped);
+   EXPECT_EQ(0, alien.GetStats().mInvalidMessages);
+
+   // a shot without bullets is thrown away, but isn't a gap
+   const uint64_t messages = alien.GetStats().mMessages;
+   shotgun.Fire("seen", std::vector<std::string>());
+   shotgun.Fire("seen", bullets);
+   for (int i = 0; i < 100 && alien.GetStats().mMessages == messages; i++) {
+      alien.GetShot(10, topic, shots);
+   }
+   EXPECT_EQ(messages + 1, alien.GetStats().mMessages);
+   EXPECT_EQ(1, alien.GetStats().mInvalidMessages);
+   EXPECT_EQ(0, alien.GetSequenceStats().mGaps);
+
+   // an Alien that expects sequence numbers throws away shots without them
+   Shotgun plain;
+   std::string plainLocation = GetTcpLocation();
+   plain.Aim(plainLocation);
+   Alien strict;
+   strict.SetSequencing(true);
+   strict.PrepareToBeShot(plainLocation);
+   for (int i = 0; i < 200 && strict.GetStats().mInvalidMessages == 0; i++) {
+      plain.Fire("Fire!");
+      strict.GetShot(10, topic, shots);
+      EXPECT_TRUE(shots.empty());
+   }
+   EXPECT_LT(0, strict.GetStats().mInvalidMessages);
+}
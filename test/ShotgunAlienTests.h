@@ -1,6 +1,7 @@
 #pragma once
 
 #include "gtest/gtest.h"
+#include <atomic>
 #include "Shotgun.h"
 #include "Alien.h"
 #include "boost/lexical_cast.hpp"
@@ -16,6 +17,8 @@ public:
    std::string mIpcLocation;
    std::string mTcpLocation;
    std::string mInprocLocation;
+   static std::atomic<int> mShotsDeleted;
+   static void DeleteShot(void*, void* data);
    static void * ShotgunThread(void *args);
    static void * Buckshothread(void *args);
    static std::string GetTcpLocation();
@@ -0,0 +1,138 @@
+#include <czmq.h>
+#include <thread>
+
+#include "SocketStatsTests.h"
+#include "Rifle.h"
+#include "Vampire.h"
+#include "Shotgun.h"
+#include "Alien.h"
+#include "Crowbar.h"
+#include "Headcrab.h"
+
+TEST_F(SocketStatsTests, Counters) {
+   SocketStats stats;
+   SocketStats::Snapshot snapshot = stats.GetSnapshot();
+   EXPECT_EQ(0, snapshot.mMessages);
+   EXPECT_EQ(0, snapshot.mBytes);
+   EXPECT_EQ(0, snapshot.mSendTimeouts);
+   EXPECT_EQ(0, snapshot.mSendErrors);
+   EXPECT_EQ(0, snapshot.mPollErrors);
+   EXPECT_EQ(0, snapshot.mInvalidMessages);
+   EXPECT_EQ(0, snapshot.mBlockedMicroseconds);
+
+   stats.AddMessage(10);
+   stats.AddMessage(20);
+   stats.AddSendTimeout();
+   stats.AddSendError();
+   stats.AddPollError();
+   stats.AddInvalidMessage();
+   stats.AddInvalidMessage();
+   stats.AddBlockedSince(std::chrono::steady_clock::now() - std::chrono::milliseconds(5));
+   snapshot = stats.GetSnapshot();
+   EXPECT_EQ(2, snapshot.mMessages);
+   EXPECT_EQ(30, snapshot.mBytes);
+   EXPECT_EQ(1, snapshot.mSendTimeouts);
+   EXPECT_EQ(1, snapshot.mSendErrors);
+   EXPECT_EQ(1, snapshot.mPollErrors);
+   EXPECT_EQ(2, snapshot.mInvalidMessages);
+   EXPECT_LE(5000, snapshot.mBlockedMicroseconds);
+}
+
+TEST_F(SocketStatsTests, ReadFromAnotherThread) {
+   SocketStats stats;
+   const uint64_t count = 100000;
+   std::thread writer([&stats, count]() {
+      for (uint64_t i = 0; i < count; i++) {
+         stats.AddMessage(1);
+      }
+   });
+   uint64_t last = 0;
+   for (;;) {
+      SocketStats::Snapshot snapshot = stats.GetSnapshot();
+      ASSERT_LE(last, snapshot.mMessages);
+      last = snapshot.mMessages;
+      if (last == count) {
+         break;
+      }
+   }
+   writer.join();
+   EXPECT_EQ(count, stats.GetSnapshot().mBytes);
+}
+
+TEST_F(SocketStatsTests, RifleAndVampire) {
+   std::string location = GetIpcLocation();
+   Rifle rifle(location);
+   rifle.SetOwnSocket(true);
+   ASSERT_TRUE(rifle.Aim());
+
+   // nobody to take the shot, it times out blocked on the high water mark
+   EXPECT_FALSE(rifle.Fire("woo", 5));
+   SocketStats::Snapshot fired = rifle.GetStats();
+   EXPECT_EQ(0, fired.mMessages);
+   EXPECT_EQ(1, fired.mSendTimeouts);
+   EXPECT_LE(5000, fired.mBlockedMicroseconds);
+
+   Vampire vampire(location);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   EXPECT_TRUE(rifle.Fire("woo", 500));
+   EXPECT_TRUE(rifle.Fire("hoo!", 500));
+   std::string bullet;
+   EXPECT_TRUE(vampire.GetShot(bullet, 500));
+   void* stake;
+   // a string isn't a stake
+   EXPECT_FALSE(vampire.GetStake(stake, 500));
+
+   fired = rifle.GetStats();
+   EXPECT_EQ(2, fired.mMessages);
+   EXPECT_EQ(7, fired.mBytes);
+   SocketStats::Snapshot shot = vampire.GetStats();
+   EXPECT_EQ(2, shot.mMessages);
+   EXPECT_EQ(7, shot.mBytes);
+   EXPECT_EQ(1, shot.mInvalidMessages);
+   EXPECT_EQ(0, shot.mPollErrors);
+}
+
+TEST_F(SocketStatsTests, ShotgunAndAlien) {
+   std::string location = GetIpcLocation();
+   Shotgun shotgun;
+   shotgun.Aim(location);
+   Alien alien;
+   alien.PrepareToBeShot(location);
+   std::vector<std::string> bullets;
+   // keep firing until the subscription has gone through
+   for (int i = 0; i < 100 && bullets.empty(); i++) {
+      shotgun.Fire("Fire!");
+      alien.GetShot(10, bullets);
+   }
+   // the bullet comes after the "dummy" frame
+   ASSERT_EQ(2, bullets.size());
+   EXPECT_LE(1, shotgun.GetStats().mMessages);
+   EXPECT_EQ(10 * shotgun.GetStats().mMessages, shotgun.GetStats().mBytes);
+   EXPECT_EQ(1, alien.GetStats().mMessages);
+   EXPECT_EQ(10, alien.GetStats().mBytes);
+}
+
+TEST_F(SocketStatsTests, CrowbarAndHeadcrab) {
+   std::string location = GetIpcLocation();
+   Headcrab headcrab(location);
+   ASSERT_TRUE(headcrab.ComeToLife());
+   Crowbar crowbar(headcrab);
+   ASSERT_TRUE(crowbar.Wield());
+
+   EXPECT_TRUE(crowbar.Swing("hit"));
+   // a request is still waiting on its reply
+   EXPECT_FALSE(crowbar.Swing("hit"));
+   std::string hit;
+   EXPECT_TRUE(headcrab.GetHitWait(hit, 500));
+   EXPECT_TRUE(headcrab.SendSplatter("splat!"));
+   std::string guts;
+   EXPECT_TRUE(crowbar.WaitForKill(guts, 500));
+
+   SocketStats::Snapshot swung = crowbar.GetStats();
+   EXPECT_EQ(2, swung.mMessages);
+   EXPECT_EQ(9, swung.mBytes);
+   EXPECT_EQ(1, swung.mSendTimeouts);
+   SocketStats::Snapshot hitBy = headcrab.GetStats();
+   EXPECT_EQ(2, hitBy.mMessages);
+   EXPECT_EQ(9, hitBy.mBytes);
+}
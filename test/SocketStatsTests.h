@@ -0,0 +1,31 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include <unistd.h>
+#include <string>
+#include "SocketStats.h"
+
+class SocketStatsTests : public ::testing::Test {
+public:
+
+   SocketStatsTests() {
+   };
+
+   static std::string GetIpcLocation() {
+      std::string location("ipc:///tmp/socketstatstest");
+      location.append(std::to_string(getpid()));
+      location.append("_");
+      location.append(std::to_string(rand()));
+      return location;
+   }
+
+protected:
+
+   virtual void SetUp() {
+   };
+
+   virtual void TearDown() {
+   };
+private:
+
+};
@@ -0,0 +1,115 @@
+#include <czmq.h>
+#include <thread>
+#include <vector>
+
+#include "StakeBundleTests.h"
+#include "MpmcQueue.h"
+#include "Rifle.h"
+#include "Vampire.h"
+
+TEST_F(StakeBundleTests, QueueFillsAndDrains) {
+   MpmcQueue<int> queue(3);
+   EXPECT_EQ(4, queue.Capacity());
+   int item = 0;
+   EXPECT_FALSE(queue.Pop(item));
+   for (int i = 0; i < 4; i++) {
+      EXPECT_TRUE(queue.Push(i));
+   }
+   EXPECT_FALSE(queue.Push(4));
+   EXPECT_EQ(4, queue.Size());
+   for (int i = 0; i < 4; i++) {
+      EXPECT_TRUE(queue.Pop(item));
+      EXPECT_EQ(i, item);
+   }
+   EXPECT_FALSE(queue.Pop(item));
+}
+
+TEST_F(StakeBundleTests, QueueManyProducersManyConsumers) {
+   MpmcQueue<int> queue(64);
+   const int perProducer = 100000;
+   const int producers = 4;
+   std::atomic<long> sum(0);
+   std::atomic<int> popped(0);
+   std::vector<std::thread> threads;
+   for (int p = 0; p < producers; p++) {
+      threads.push_back(std::thread([&queue, perProducer]() {
+         for (int i = 1; i <= perProducer; i++) {
+            while (!queue.Push(i)) {
+               std::this_thread::yield();
+            }
+         }
+      }));
+      threads.push_back(std::thread([&queue, &sum, &popped, perProducer, producers]() {
+         int item;
+         while (popped.load() < perProducer * producers) {
+            if (queue.Pop(item)) {
+               sum += item;
+               popped++;
+            } else {
+               std::this_thread::yield();
+            }
+         }
+      }));
+   }
+   for (auto it = threads.begin(); it != threads.end(); it++) {
+      it->join();
+   }
+   EXPECT_EQ(perProducer * producers, popped.load());
+   EXPECT_EQ(static_cast<long> (producers) * perProducer * (perProducer + 1) / 2, sum.load());
+}
+
+TEST_F(StakeBundleTests, BundlesAreRecycled) {
+   StakeBundle* bundle = StakeBundle::Get();
+   ASSERT_NE(nullptr, bundle);
+   EXPECT_TRUE(bundle->empty());
+   for (size_t i = 0; i < StakeBundle::kCapacity; i++) {
+      EXPECT_TRUE(bundle->push_back(bundle, i));
+   }
+   EXPECT_TRUE(bundle->full());
+   EXPECT_FALSE(bundle->push_back(bundle, 0));
+   size_t pooled = StakeBundle::GetPooledCount();
+   StakeBundle::Recycle(bundle);
+   EXPECT_EQ(pooled + 1, StakeBundle::GetPooledCount());
+   StakeBundle* again = StakeBundle::Get();
+   EXPECT_TRUE(again->empty());
+   EXPECT_EQ(pooled, StakeBundle::GetPooledCount());
+   StakeBundle::Recycle(again);
+}
+
+TEST_F(StakeBundleTests, FireAndGetBundles) {
+   std::string location = GetIpcLocation();
+   Rifle rifle(location);
+   Vampire vampire(location);
+   ASSERT_TRUE(rifle.Aim());
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   zclock_sleep(100);
+   std::string stake("stake");
+
+   StakeBundle* bundle = StakeBundle::Get();
+   bundle->push_back(&stake, 1);
+   bundle->push_back(&location, 2);
+   EXPECT_TRUE(rifle.FireStakes(bundle, 100));
+   StakeBundle* received = NULL;
+   ASSERT_TRUE(vampire.GetStakes(received, 100));
+   ASSERT_EQ(2, received->size());
+   EXPECT_EQ(&stake, (*received)[0].first);
+   EXPECT_EQ(2, (*received)[1].second);
+   StakeBundle::Recycle(received);
+
+   // same wire format as a vector of stakes, both ways
+   bundle = StakeBundle::Get();
+   bundle->push_back(&stake, 3);
+   EXPECT_TRUE(rifle.FireStakes(bundle, 100));
+   std::vector<std::pair<void*, unsigned int> > stakes;
+   ASSERT_TRUE(vampire.GetStakes(stakes, 100));
+   ASSERT_EQ(1, stakes.size());
+   EXPECT_EQ(3, stakes[0].second);
+   EXPECT_TRUE(rifle.FireStakes(stakes, 100));
+   ASSERT_TRUE(vampire.GetStakes(received, 100));
+   EXPECT_EQ(1, received->size());
+   StakeBundle::Recycle(received);
+
+   EXPECT_FALSE(vampire.GetStakes(received, 1));
+   EXPECT_EQ(nullptr, received);
+   EXPECT_FALSE(rifle.FireStakes(StakeBundle::Get(), 1));
+}
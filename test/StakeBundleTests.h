@@ -0,0 +1,30 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include <unistd.h>
+#include <string>
+#include "StakeBundle.h"
+
+class StakeBundleTests : public ::testing::Test {
+public:
+
+   StakeBundleTests() {
+   };
+
+   static std::string GetIpcLocation() {
+      std::string location("ipc:///tmp/StakeBundleTests");
+      location.append(std::to_string(getpid()));
+      location.append(".ipc");
+      return location;
+   }
+
+protected:
+
+   virtual void SetUp() {
+   };
+
+   virtual void TearDown() {
+   };
+private:
+
+};
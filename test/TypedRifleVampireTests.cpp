@@ -0,0 +1,68 @@
+#include "TypedRifleVampireTests.h"
+
+TEST_F(TypedRifleVampireTests, OneRecord) {
+   std::string location = GetIpcLocation();
+   TypedRifle<Record> rifle(location);
+   TypedVampire<Record> vampire(location);
+   ASSERT_TRUE(rifle.Aim());
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   zclock_sleep(100);
+   Record sent = MakeRecord(42);
+   Record received;
+   EXPECT_FALSE(vampire.GetShot(received, 1));
+   EXPECT_TRUE(rifle.Fire(sent, 100));
+   EXPECT_TRUE(vampire.GetShot(received, 100));
+   EXPECT_EQ(sent, received);
+}
+
+TEST_F(TypedRifleVampireTests, ArraysOfRecords) {
+   std::string location = GetInprocLocation();
+   TypedRifle<Record> rifle(location);
+   TypedVampire<Record> vampire(location);
+   ASSERT_TRUE(rifle.Aim());
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   std::vector<Record> sent;
+   for (uint64_t i = 0; i < 10; i++) {
+      sent.push_back(MakeRecord(i));
+   }
+   EXPECT_TRUE(rifle.Fire(sent, 100));
+   std::vector<Record> received;
+   EXPECT_TRUE(vampire.GetShot(received, 100));
+   EXPECT_EQ(sent, received);
+
+   EXPECT_TRUE(rifle.Fire(sent.data(), 3, 100));
+   Record span[5];
+   size_t count = 0;
+   EXPECT_TRUE(vampire.GetShot(span, 5, count, 100));
+   ASSERT_EQ(3, count);
+   EXPECT_EQ(sent[2], span[2]);
+
+   // doesn't fit
+   EXPECT_TRUE(rifle.Fire(sent, 100));
+   EXPECT_FALSE(vampire.GetShot(span, 5, count, 100));
+   EXPECT_EQ(0, count);
+   // many records aren't one record
+   EXPECT_TRUE(rifle.Fire(sent, 100));
+   Record one;
+   EXPECT_FALSE(vampire.GetShot(one, 100));
+   EXPECT_FALSE(rifle.Fire(sent.data(), 0, 100));
+}
+
+TEST_F(TypedRifleVampireTests, WrongSizedBullet) {
+   std::string location = GetInprocLocation();
+   Rifle rifle(location);
+   TypedVampire<Record> vampire(location);
+   ASSERT_TRUE(rifle.Aim());
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   EXPECT_TRUE(rifle.Fire(std::string("not a record"), 100));
+   Record record = MakeRecord(7);
+   EXPECT_FALSE(vampire.GetShot(record, 100));
+   // the bad bullet was thrown away
+   EXPECT_TRUE(rifle.Fire(std::string(reinterpret_cast<const char*> (&record), sizeof (record)), 100));
+   EXPECT_TRUE(vampire.GetShot(record, 100));
+}
+
+TEST_F(TypedRifleVampireTests, NotAimed) {
+   TypedRifle<Record> rifle(GetInprocLocation());
+   EXPECT_FALSE(rifle.Fire(MakeRecord(1), 1));
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include <unistd.h>
+#include <string>
+#include "czmq.h"
+#include "TypedRifle.h"
+#include "TypedVampire.h"
+
+class TypedRifleVampireTests : public ::testing::Test {
+public:
+
+   TypedRifleVampireTests() {
+   };
+
+   struct Record {
+      uint64_t mId;
+      double mValue;
+      char mName[16];
+
+      bool operator==(const Record& other) const {
+         return (mId == other.mId && mValue == other.mValue &&
+            strncmp(mName, other.mName, sizeof (mName)) == 0);
+      }
+   };
+
+   static Record MakeRecord(const uint64_t id) {
+      Record record;
+      memset(&record, 0, sizeof (record));
+      record.mId = id;
+      record.mValue = id * 1.5;
+      snprintf(record.mName, sizeof (record.mName), "record%lu", id);
+      return record;
+   }
+
+   static std::string GetIpcLocation() {
+      std::string location("ipc:///tmp/TypedRifleVampireTests");
+      location.append(std::to_string(getpid()));
+      location.append(".ipc");
+      return location;
+   }
+
+   static std::string GetInprocLocation() {
+      std::string location("inproc://TypedRifleVampireTests");
+      location.append(std::to_string(getpid()));
+      return location;
+   }
+
+protected:
+
+   virtual void SetUp() {
+   };
+
+   virtual void TearDown() {
+   };
+private:
+
+};
@@ -0,0 +1,162 @@
+#include <czmq.h>
+#include <atomic>
+#include <thread>
+
+#include "VampirePoolTests.h"
+#include "Rifle.h"
+
+namespace {
+   /**
+    * Keep the CPU busy without sleeping, like real work would.
+    */
+   void Burn(const std::chrono::microseconds& duration) {
+      const auto until = std::chrono::steady_clock::now() + duration;
+      while (std::chrono::steady_clock::now() < until) {
+      }
+   }
+}
+
+TEST_F(VampirePoolTests, NotStarted) {
+   VampirePool pool(GetIpcLocation(), 3, [](std::string&, const size_t) {
+   });
+   EXPECT_EQ(3, pool.GetWorkerCount());
+   VampirePool::WorkerStats stats = pool.GetWorkerStats(0);
+   EXPECT_EQ(0, stats.mShots);
+   EXPECT_EQ(0, stats.mStolen);
+   pool.Stop();
+}
+
+TEST_F(VampirePoolTests, EveryShotHandledOnce) {
+   std::string location = GetIpcLocation();
+   Rifle rifle(location);
+   rifle.SetOwnSocket(true);
+   ASSERT_TRUE(rifle.Aim());
+   const int count = 1000;
+   std::atomic<int> handled(0);
+   std::atomic<int> sum(0);
+   VampirePool pool(location, 4, [&](std::string& shot, const size_t worker) {
+      EXPECT_GT(4u, worker);
+      sum += std::stoi(shot);
+      handled++;
+   }, 2);
+   ASSERT_TRUE(pool.Start());
+   for (int i = 0; i < count; i++) {
+      ASSERT_TRUE(rifle.Fire(std::to_string(i), 1000));
+   }
+   for (int i = 0; i < 500 && handled < count; i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+   }
+   pool.Stop();
+   EXPECT_EQ(count, handled);
+   EXPECT_EQ(count * (count - 1) / 2, sum);
+   uint64_t shots = 0;
+   for (size_t i = 0; i < pool.GetWorkerCount(); i++) {
+      VampirePool::WorkerStats stats = pool.GetWorkerStats(i);
+      shots += stats.mShots;
+      EXPECT_LE(stats.mStolen, stats.mShots);
+      EXPECT_EQ(0, stats.mQueued);
+   }
+   EXPECT_EQ(count, shots);
+}
+
+TEST_F(VampirePoolTests, StopDealsTheHeldShot) {
+   std::string location = GetIpcLocation();
+   Rifle rifle(location);
+   rifle.SetOwnSocket(true);
+   ASSERT_TRUE(rifle.Aim());
+   std::atomic<bool> blocked(true);
+   std::atomic<int> handled(0);
+   VampirePool pool(location, 1, [&](std::string&, const size_t) {
+      while (blocked) {
+         std::this_thread::yield();
+      }
+      handled++;
+   });
+   pool.SetQueueSize(1);
+   ASSERT_TRUE(pool.Start());
+   // one in the handler, one queued, and one held by the receiver
+   for (int i = 0; i < 3; i++) {
+      ASSERT_TRUE(rifle.Fire(std::to_string(i), 1000));
+   }
+   std::this_thread::sleep_for(std::chrono::milliseconds(200));
+   std::thread stopper([&pool]() {
+      pool.Stop();
+   });
+   std::this_thread::sleep_for(std::chrono::milliseconds(100));
+   blocked = false;
+   stopper.join();
+   EXPECT_EQ(3, handled);
+}
+
+TEST_F(VampirePoolTests, IdleWorkersStealFromSlowOnes) {
+   std::string location = GetIpcLocation();
+   Rifle rifle(location);
+   rifle.SetOwnSocket(true);
+   ASSERT_TRUE(rifle.Aim());
+   // every 4th shot is 100 times as expensive, round robin would put them all
+   // on the same worker
+   const int count = 400;
+   std::atomic<int> handled(0);
+   VampirePool pool(location, 4, [&](std::string& shot, const size_t) {
+      Burn(std::chrono::microseconds(shot == "slow" ? 2000 : 20));
+      handled++;
+   });
+   ASSERT_TRUE(pool.Start());
+   for (int i = 0; i < count; i++) {
+      ASSERT_TRUE(rifle.Fire((i % 4 == 0) ? "slow" : "fast", 1000));
+   }
+   for (int i = 0; i < 1000 && handled < count; i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+   }
+   EXPECT_EQ(count, handled);
+   uint64_t stolen = 0;
+   for (size_t i = 0; i < pool.GetWorkerCount(); i++) {
+      VampirePool::WorkerStats stats = pool.GetWorkerStats(i);
+      stolen += stats.mStolen;
+      EXPECT_LE(0.0, stats.mUtilization);
+      EXPECT_GE(1.0, stats.mUtilization);
+   }
+   EXPECT_LT(0, stolen);
+   pool.Stop();
+}
+
+TEST_F(VampirePoolTests, BenchmarkSkewedWork) {
+   if (geteuid() != 0) {
+      return;
+   }
+#if RIFLE_VAMPIRE_PRODUCTION == 0
+   return;
+#endif
+   std::string location = GetIpcLocation();
+   Rifle rifle(location);
+   rifle.SetOwnSocket(true);
+   rifle.SetHighWater(10000);
+   ASSERT_TRUE(rifle.Aim());
+   const int count = 20000;
+   std::atomic<int> handled(0);
+   VampirePool pool(location, 8, [&](std::string& shot, const size_t) {
+      Burn(std::chrono::microseconds(shot[0] == 's' ? 500 : 5));
+      handled++;
+   }, 2);
+   pool.SetHighWater(10000);
+   ASSERT_TRUE(pool.Start());
+   std::string fast(100, 'f');
+   std::string slow(100, 's');
+   const auto start = std::chrono::steady_clock::now();
+   for (int i = 0; i < count; i++) {
+      ASSERT_TRUE(rifle.Fire((i % 64 == 0) ? slow : fast, 1000));
+   }
+   while (handled < count) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+   }
+   const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start).count();
+   std::cout << count << " skewed shots on " << pool.GetWorkerCount() << " workers took "
+      << elapsed << "ms" << std::endl;
+   for (size_t i = 0; i < pool.GetWorkerCount(); i++) {
+      VampirePool::WorkerStats stats = pool.GetWorkerStats(i);
+      std::cout << "worker " << i << ": " << stats.mShots << " shots, " << stats.mStolen
+         << " stolen, " << static_cast<int> (stats.mUtilization * 100) << "% busy" << std::endl;
+   }
+   pool.Stop();
+}
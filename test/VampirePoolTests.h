@@ -0,0 +1,32 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include <unistd.h>
+#include <string>
+#include "VampirePool.h"
+
+class VampirePoolTests : public ::testing::Test {
+public:
+
+   VampirePoolTests() {
+   };
+
+   static std::string GetIpcLocation() {
+      std::string location("ipc:///tmp/vampirepooltest");
+      location.append(std::to_string(getpid()));
+      location.append("_");
+      location.append(std::to_string(rand()));
+      return location;
+   }
+
+protected:
+
+   virtual void SetUp() {
+      zctx_interrupted = false;
+   };
+
+   virtual void TearDown() {
+   };
+private:
+
+};